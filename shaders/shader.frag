@@ -1,11 +1,15 @@
 #version 450
-layout(binding = 2) uniform sampler2D texSampler;
+#extension GL_EXT_nonuniform_qualifier : require
 
-layout(location = 0) in vec3 fragColor;
-layout(location = 1) in vec2 fragTexCoord;
+// Bindless table of every loaded texture, the draw data says which one a draw samples
+layout(binding = 2) uniform sampler2D textures[];
+
+layout(location = 0) in vec2 fragTexCoord;
+layout(location = 1) flat in uint fragTextureIndex;
 
 layout(location = 0) out vec4 outColor;
 
 void main() {
-	outColor = texture(texSampler, fragTexCoord);
-}
\ No newline at end of file
+	// Fragments of different draws can share a subgroup since one indirect call covers many of them
+	outColor = texture(textures[nonuniformEXT(fragTextureIndex)], fragTexCoord);
+}
@@ -1,4 +1,5 @@
 #version 450
+#extension GL_ARB_shader_draw_parameters : require
 
 layout(binding = 0) uniform Camera {
 	mat4 view;
@@ -7,16 +8,40 @@ layout(binding = 0) uniform Camera {
 layout(std140, binding = 1) readonly buffer InstanceData {
 	mat4 transforms[];
 } instanceData;
+// One entry per indirect draw record. The offset and scale restore object space from the packed vertex layouts, texCoordTransform
+// restores the texture coordinates from their range in xy + fetched * zw. Both are identity for full floats.
+struct DrawData {
+	vec4 offset;
+	vec4 scale;
+	vec4 texCoordTransform;
+	vec4 boundingSphere;
+	uint textureIndex;
+	uint firstTransform;
+	uint transformCount;
+	uint recordCount;
+};
+layout(std430, binding = 3) readonly buffer Draws {
+	DrawData draws[];
+} drawData;
+// Transforms of the instances that survived culling, gl_InstanceIndex counts from the draw's range in here
+layout(std430, binding = 4) readonly buffer VisibleInstances {
+	uint transformIndices[];
+} visibleInstances;
+// gl_DrawID restarts at 0 for every indirect draw, this is the record it started at
+layout(push_constant) uniform DrawRange {
+	uint firstDraw;
+} drawRange;
 
 layout(location = 0) in vec3 inPosition;
-layout(location = 1) in vec3 inColor;
-layout(location = 2) in vec2 inTexCoord;
+layout(location = 1) in vec2 inTexCoord;
 
-layout(location = 0) out vec3 fragColor;
-layout(location = 1) out vec2 fragTexCoord;
+layout(location = 0) out vec2 fragTexCoord;
+layout(location = 1) flat out uint fragTextureIndex;
 
 void main() {
-	gl_Position = camera.projection * camera.view * instanceData.transforms[gl_InstanceIndex] * vec4(inPosition, 1.0);
-	fragColor = inColor;
-	fragTexCoord = inTexCoord;
+	DrawData draw = drawData.draws[drawRange.firstDraw + gl_DrawIDARB];
+	vec3 position = draw.offset.xyz + inPosition * draw.scale.xyz;
+	gl_Position = camera.projection * camera.view * instanceData.transforms[visibleInstances.transformIndices[gl_InstanceIndex]] * vec4(position, 1.0);
+	fragTexCoord = draw.texCoordTransform.xy + inTexCoord * draw.texCoordTransform.zw;
+	fragTextureIndex = draw.textureIndex;
 }
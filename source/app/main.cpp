@@ -1,19 +1,44 @@
 
 #include <cstdlib>
 #include <iostream>
+#include <string>
 
+#include "MeshImporter.h"
 #include "renderLoop.h"
 
 void HandleEnd();
 
-int main()
+int main(int argc, char* argv[])
 {
 	const std::string windowName{ "Weird Fishes | FHE" };
 	const std::string appName{ "Weird Fishes" };
 
 	try
 	{
+		if (argc >= 3 && std::string(argv[1]) == "--bench-import")
+		{
+			MeshImporter::BenchmarkObj(argv[2]);
+			return EXIT_SUCCESS;
+		}
+		if (argc >= 2 && std::string(argv[1]) == "--bench-sharing")
+		{
+			RenderLoop::BenchmarkSharingModes(windowName, appName, argc >= 3 ? static_cast<uint32_t>(std::stoul(argv[2])) : 1000u);
+			return EXIT_SUCCESS;
+		}
+		if (argc >= 2 && std::string(argv[1]) == "--bench-recording")
+		{
+			RenderLoop::BenchmarkRecording(windowName, appName, argc >= 3 ? static_cast<uint32_t>(std::stoul(argv[2])) : 1000u);
+			return EXIT_SUCCESS;
+		}
+		if (argc >= 2 && std::string(argv[1]) == "--bench-occlusion")
+		{
+			RenderLoop::BenchmarkOcclusionCulling(windowName, appName, argc >= 3 ? static_cast<uint32_t>(std::stoul(argv[2])) : 1000u);
+			return EXIT_SUCCESS;
+		}
+
 		RenderLoop renderingLoop = RenderLoop(windowName, appName);
+		if (argc >= 3 && std::string(argv[1]) == "--msaa")
+			renderingLoop.SetMaxMsaaSamples(static_cast<uint32_t>(std::stoul(argv[2])));
 		renderingLoop.Run();
 	}
 	catch (const std::exception& e)
@@ -0,0 +1,18 @@
+#ifndef RENDERER_CULLSTATISTICS_H_
+#define RENDERER_CULLSTATISTICS_H_
+
+#include <cstdint>
+
+// Counters cull.comp accumulates over one frame, matching its CullStatistics buffer. Instances are counted once, however
+// many submesh records their model has.
+struct CullStatistics
+{
+	uint32_t testedInstances;
+	uint32_t frustumCulledInstances;
+	// Inside the frustum but behind the depth pyramid, and not drawn by the early phase either
+	uint32_t occlusionCulledInstances;
+	uint32_t earlyDrawnInstances;
+	uint32_t lateDrawnInstances;
+};
+
+#endif
@@ -0,0 +1,406 @@
+#include "DeviceMemoryAllocator.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <stdexcept>
+
+DeviceMemoryAllocator::DeviceMemoryAllocator(const VkDevice& device, const VkPhysicalDevice& physicalDevice, const bool& memoryBudgetSupported)
+{
+	_device = device;
+	_physicalDevice = physicalDevice;
+	vkGetPhysicalDeviceMemoryProperties(physicalDevice, &_memoryProperties);
+
+	_budgets.fill({});
+	_categoryUsage.fill(0);
+	_evicting = false;
+	_evictionCount = 0;
+	_memoryBudgetSupported = memoryBudgetSupported;
+	_heapReservedSize.fill(0);
+	_heapUsageAtUpdate.fill(0);
+	_heapReservedAtUpdate.fill(0);
+	for (uint32_t heapIndex = 0; heapIndex < VK_MAX_MEMORY_HEAPS; ++heapIndex)
+		_heapBudget[heapIndex] = heapIndex < _memoryProperties.memoryHeapCount ? _memoryProperties.memoryHeaps[heapIndex].size / 100 * FALLBACK_HEAP_BUDGET_PERCENT : 0;
+	UpdateHeapBudgets();
+
+	for (uint32_t memoryType = 0; memoryType < VK_MAX_MEMORY_TYPES; ++memoryType)
+	{
+		for (uint32_t kind = 0; kind < POOL_KIND_COUNT; ++kind)
+		{
+			Pool& pool = _pools[memoryType * POOL_KIND_COUNT + kind];
+			pool.memoryType = memoryType;
+			pool.kind = static_cast<PoolKind>(kind);
+		}
+	}
+}
+
+DeviceMemoryAllocator::~DeviceMemoryAllocator()
+{
+	for (auto& pool : _pools)
+	{
+		for (const auto& block : pool.blocks)
+		{
+			if (block->allocationCount > 0)
+				printf("Device memory block of type %u destroyed with %u live allocations\n", pool.memoryType, block->allocationCount);
+			vkFreeMemory(_device, block->memory, nullptr);
+		}
+		pool.blocks.clear();
+	}
+}
+
+void DeviceMemoryAllocator::AllocateBufferMemory(const VkBuffer& buffer, const VkMemoryPropertyFlags& properties, const FHEMemoryLifetime& lifetime, const FHEMemoryCategory& category, FHEAllocation& allocation)
+{
+	VkMemoryRequirements memoryRequirements;
+	vkGetBufferMemoryRequirements(_device, buffer, &memoryRequirements);
+
+	Allocate(memoryRequirements, properties, 0, lifetime == FHE_MEMORY_LIFETIME_TRANSIENT ? POOL_KIND_TRANSIENT : POOL_KIND_LINEAR, category, allocation);
+	vkBindBufferMemory(_device, buffer, allocation.memory, allocation.offset);
+}
+
+void DeviceMemoryAllocator::AllocateImageMemory(const VkImage& image, const VkImageTiling& tiling, const VkMemoryPropertyFlags& properties, const FHEMemoryCategory& category, FHEAllocation& allocation, const VkMemoryPropertyFlags& preferredProperties)
+{
+	VkMemoryRequirements memoryRequirements;
+	vkGetImageMemoryRequirements(_device, image, &memoryRequirements);
+
+	Allocate(memoryRequirements, properties, preferredProperties, tiling == VK_IMAGE_TILING_OPTIMAL ? POOL_KIND_OPTIMAL : POOL_KIND_LINEAR, category, allocation);
+	vkBindImageMemory(_device, image, allocation.memory, allocation.offset);
+}
+
+void DeviceMemoryAllocator::Free(const FHEAllocation& allocation)
+{
+	if (allocation.memory == nullptr)
+		return;
+
+	std::lock_guard lock(_mutex);
+	Pool& pool = _pools[allocation.pool];
+	const auto block = std::find_if(pool.blocks.begin(), pool.blocks.end(), [&allocation](const auto& candidate) { return candidate->memory == allocation.memory; });
+	if (block == pool.blocks.end())
+		throw std::runtime_error("Freeing device memory the allocator does not own!");
+
+	Block& owner = **block;
+	if (pool.kind != POOL_KIND_TRANSIENT)
+		owner.ranges.Free(allocation.offset);
+	owner.usedSize -= allocation.size;
+	--owner.allocationCount;
+	_categoryUsage[allocation.category] -= allocation.size;
+	if (owner.allocationCount == 0)
+	{
+		owner.head = 0;
+		// One empty block is kept per pool so a load that frees and reallocates does not go back to the driver
+		if (owner.dedicated || pool.blocks.size() > 1)
+			DestroyBlock(pool, static_cast<size_t>(block - pool.blocks.begin()));
+	}
+}
+
+void DeviceMemoryAllocator::SetBudget(const FHEMemoryCategory& category, const MemoryBudget& budget)
+{
+	std::lock_guard lock(_mutex);
+	_budgets[category] = budget;
+}
+
+void DeviceMemoryAllocator::SetEvictionCallback(const EvictionCallback& evict)
+{
+	_evict = evict;
+	_evictionThread = std::this_thread::get_id();
+}
+
+void DeviceMemoryAllocator::UpdateHeapBudgets()
+{
+	if (!_memoryBudgetSupported)
+		return;
+
+	VkPhysicalDeviceMemoryBudgetPropertiesEXT budgetProperties{};
+	budgetProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT;
+	VkPhysicalDeviceMemoryProperties2 memoryProperties{};
+	memoryProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2;
+	memoryProperties.pNext = &budgetProperties;
+	vkGetPhysicalDeviceMemoryProperties2(_physicalDevice, &memoryProperties);
+
+	std::lock_guard lock(_mutex);
+	for (uint32_t heapIndex = 0; heapIndex < _memoryProperties.memoryHeapCount; ++heapIndex)
+	{
+		_heapBudget[heapIndex] = budgetProperties.heapBudget[heapIndex];
+		_heapUsageAtUpdate[heapIndex] = budgetProperties.heapUsage[heapIndex];
+		_heapReservedAtUpdate[heapIndex] = _heapReservedSize[heapIndex];
+	}
+}
+
+bool DeviceMemoryAllocator::FitsSoftBudget(const FHEMemoryCategory& category, const VkDeviceSize& size) const
+{
+	std::lock_guard lock(_mutex);
+	if (_budgets[category].softSize != 0 && _categoryUsage[category] + size > _budgets[category].softSize)
+		return false;
+
+	for (uint32_t heapIndex = 0; heapIndex < _memoryProperties.memoryHeapCount; ++heapIndex)
+	{
+		if ((_memoryProperties.memoryHeaps[heapIndex].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) && GetHeapUsage(heapIndex) + size > _heapBudget[heapIndex])
+			return false;
+	}
+
+	return true;
+}
+
+bool DeviceMemoryAllocator::ExceedsHardBudget(const FHEMemoryCategory& category, const VkDeviceSize& size) const
+{
+	std::lock_guard lock(_mutex);
+	return _budgets[category].hardSize != 0 && _categoryUsage[category] + size > _budgets[category].hardSize;
+}
+
+VkDeviceSize DeviceMemoryAllocator::GetCategoryUsage(const FHEMemoryCategory& category) const
+{
+	std::lock_guard lock(_mutex);
+	return _categoryUsage[category];
+}
+
+std::vector<MemoryHeapStatistics> DeviceMemoryAllocator::GetHeapStatistics() const
+{
+	std::lock_guard lock(_mutex);
+	std::vector<MemoryHeapStatistics> statistics(_memoryProperties.memoryHeapCount);
+	std::vector<VkDeviceSize> freeSizes(_memoryProperties.memoryHeapCount, 0);
+	std::vector<VkDeviceSize> largestFreeSizes(_memoryProperties.memoryHeapCount, 0);
+	for (const auto& pool : _pools)
+	{
+		if (pool.blocks.empty())
+			continue;
+
+		const uint32_t heapIndex = _memoryProperties.memoryTypes[pool.memoryType].heapIndex;
+		MemoryHeapStatistics& heap = statistics[heapIndex];
+		for (const auto& block : pool.blocks)
+		{
+			++heap.blockCount;
+			heap.allocationCount += block->allocationCount;
+			heap.usedSize += block->usedSize;
+			heap.reservedSize += block->size;
+
+			// Transient blocks can only hand out what lies past their head until they rewind
+			const VkDeviceSize largestFreeSize = pool.kind == POOL_KIND_TRANSIENT ? block->size - block->head : block->ranges.GetLargestFreeRange();
+			freeSizes[heapIndex] += block->size - block->usedSize;
+			largestFreeSizes[heapIndex] = std::max(largestFreeSizes[heapIndex], largestFreeSize);
+		}
+	}
+
+	for (uint32_t heapIndex = 0; heapIndex < statistics.size(); ++heapIndex)
+	{
+		if (freeSizes[heapIndex] > 0)
+			statistics[heapIndex].fragmentation = 1.f - static_cast<float>(largestFreeSizes[heapIndex]) / static_cast<float>(freeSizes[heapIndex]);
+		statistics[heapIndex].budgetSize = _heapBudget[heapIndex];
+		statistics[heapIndex].usageSize = GetHeapUsage(heapIndex);
+	}
+
+	return statistics;
+}
+
+void DeviceMemoryAllocator::PrintStatistics() const
+{
+	const std::vector<MemoryHeapStatistics> statistics = GetHeapStatistics();
+	for (uint32_t heapIndex = 0; heapIndex < statistics.size(); ++heapIndex)
+	{
+		const MemoryHeapStatistics& heap = statistics[heapIndex];
+		const bool deviceLocal = _memoryProperties.memoryHeaps[heapIndex].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT;
+		printf("Heap %u%s: %u blocks, %u allocations, %.2f/%.2f MiB used, %.0f%% fragmented, %.2f/%.2f MiB of the %s budget\n",
+			heapIndex, deviceLocal ? " (device local)" : "", heap.blockCount, heap.allocationCount,
+			static_cast<double>(heap.usedSize) / (1024. * 1024.), static_cast<double>(heap.reservedSize) / (1024. * 1024.), heap.fragmentation * 100.f,
+			static_cast<double>(heap.usageSize) / (1024. * 1024.), static_cast<double>(heap.budgetSize) / (1024. * 1024.), _memoryBudgetSupported ? "driver" : "estimated");
+	}
+
+	printf("  %u evictions to stay within the budgets\n", _evictionCount.load());
+	const char* categoryNames[FHE_MEMORY_CATEGORY_COUNT] = { "meshes", "textures", "attachments", "staging", "other" };
+	std::lock_guard lock(_mutex);
+	for (uint32_t category = 0; category < FHE_MEMORY_CATEGORY_COUNT; ++category)
+	{
+		printf("  %-11s %8.2f MiB", categoryNames[category], static_cast<double>(_categoryUsage[category]) / (1024. * 1024.));
+		if (_budgets[category].softSize != 0 || _budgets[category].hardSize != 0)
+			printf(" (soft %.0f MiB, hard %.0f MiB)", static_cast<double>(_budgets[category].softSize) / (1024. * 1024.), static_cast<double>(_budgets[category].hardSize) / (1024. * 1024.));
+		printf("\n");
+	}
+}
+
+void DeviceMemoryAllocator::Allocate(const VkMemoryRequirements& memoryRequirements, const VkMemoryPropertyFlags& properties, const VkMemoryPropertyFlags& preferredProperties, const PoolKind& kind, const FHEMemoryCategory& category, FHEAllocation& allocation)
+{
+	const uint32_t memoryType = FindMemoryType(memoryRequirements.memoryTypeBits, properties, preferredProperties);
+	const uint32_t heapIndex = _memoryProperties.memoryTypes[memoryType].heapIndex;
+
+	// The callback frees through Free, so it runs without the lock held
+	while (ExceedsBudget(category, heapIndex, memoryRequirements.size) && Evict(category, memoryRequirements.size))
+	{
+	}
+	if (!IsEvicting() && ExceedsHardBudget(category, memoryRequirements.size))
+		throw std::runtime_error("Allocation exceeds the hard memory budget of its category and nothing is left to evict!");
+
+	while (!TryAllocateFromPool(memoryRequirements, memoryType, kind, category, allocation))
+	{
+		if (!Evict(category, memoryRequirements.size))
+			throw std::runtime_error("Failed to allocate a device memory block!");
+	}
+}
+
+bool DeviceMemoryAllocator::TryAllocateFromPool(const VkMemoryRequirements& memoryRequirements, const uint32_t& memoryType, const PoolKind& kind, const FHEMemoryCategory& category, FHEAllocation& allocation)
+{
+	const uint32_t poolIndex = memoryType * POOL_KIND_COUNT + kind;
+
+	std::lock_guard lock(_mutex);
+	Pool& pool = _pools[poolIndex];
+
+	Block* target = nullptr;
+	VkDeviceSize offset = 0;
+	const VkDeviceSize blockSize = GetBlockSize(memoryType);
+	// Lazily allocated memory is only committed for what a resource touches, a shared block would commit and count all of it
+	const bool lazilyAllocated = _memoryProperties.memoryTypes[memoryType].propertyFlags & VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT;
+	if (lazilyAllocated || memoryRequirements.size > blockSize / 2)
+	{
+		target = CreateBlock(pool, memoryRequirements.size, true);
+		if (target == nullptr)
+			return false;
+		(void)TryAllocate(*target, kind, memoryRequirements.size, memoryRequirements.alignment, offset);
+	}
+	else
+	{
+		for (const auto& block : pool.blocks)
+		{
+			if (!block->dedicated && TryAllocate(*block, kind, memoryRequirements.size, memoryRequirements.alignment, offset))
+			{
+				target = block.get();
+				break;
+			}
+		}
+
+		if (target == nullptr)
+		{
+			target = CreateBlock(pool, blockSize, false);
+			if (target == nullptr)
+				return false;
+			(void)TryAllocate(*target, kind, memoryRequirements.size, memoryRequirements.alignment, offset);
+		}
+	}
+
+	target->usedSize += memoryRequirements.size;
+	++target->allocationCount;
+	_categoryUsage[category] += memoryRequirements.size;
+
+	allocation.memory = target->memory;
+	allocation.offset = offset;
+	allocation.size = memoryRequirements.size;
+	allocation.mapped = target->mapped != nullptr ? target->mapped + offset : nullptr;
+	allocation.pool = poolIndex;
+	allocation.category = category;
+	return true;
+}
+
+bool DeviceMemoryAllocator::TryAllocate(Block& block, const PoolKind& kind, const VkDeviceSize& size, const VkDeviceSize& alignment, VkDeviceSize& offset)
+{
+	if (kind != POOL_KIND_TRANSIENT)
+		return block.ranges.Allocate(size, alignment, offset);
+
+	const VkDeviceSize alignedHead = (block.head + alignment - 1) / alignment * alignment;
+	if (alignedHead + size > block.size)
+		return false;
+
+	offset = alignedHead;
+	block.head = alignedHead + size;
+	return true;
+}
+
+bool DeviceMemoryAllocator::Evict(const FHEMemoryCategory& category, const VkDeviceSize& size)
+{
+	if (!_evict || std::this_thread::get_id() != _evictionThread || _evicting)
+		return false;
+
+	_evicting = true;
+	const bool evicted = _evict(category, size);
+	_evicting = false;
+	if (evicted)
+		++_evictionCount;
+	return evicted;
+}
+
+bool DeviceMemoryAllocator::IsEvicting() const
+{
+	// Only the eviction thread ever sets the flag, so for every other thread it reads false as it should
+	return _evicting && std::this_thread::get_id() == _evictionThread;
+}
+
+bool DeviceMemoryAllocator::ExceedsBudget(const FHEMemoryCategory& category, const uint32_t& heapIndex, const VkDeviceSize& size) const
+{
+	if (ExceedsHardBudget(category, size))
+		return true;
+
+	std::lock_guard lock(_mutex);
+	return (_memoryProperties.memoryHeaps[heapIndex].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) && GetHeapUsage(heapIndex) + size > _heapBudget[heapIndex];
+}
+
+VkDeviceSize DeviceMemoryAllocator::GetHeapUsage(const uint32_t& heapIndex) const
+{
+	if (!_memoryBudgetSupported)
+		return _heapReservedSize[heapIndex];
+
+	// Other processes and the driver can make the reported usage drop below what this allocator reserved since the update
+	const VkDeviceSize usage = _heapUsageAtUpdate[heapIndex] + _heapReservedSize[heapIndex];
+	return usage > _heapReservedAtUpdate[heapIndex] ? usage - _heapReservedAtUpdate[heapIndex] : 0;
+}
+
+DeviceMemoryAllocator::Block* DeviceMemoryAllocator::CreateBlock(Pool& pool, const VkDeviceSize& size, const bool& dedicated)
+{
+	VkMemoryAllocateInfo allocInfo{};
+	allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	allocInfo.allocationSize = size;
+	allocInfo.memoryTypeIndex = pool.memoryType;
+
+	auto block = std::make_unique<Block>();
+	const VkResult result = vkAllocateMemory(_device, &allocInfo, nullptr, &block->memory);
+	if (result == VK_ERROR_OUT_OF_DEVICE_MEMORY || result == VK_ERROR_OUT_OF_HOST_MEMORY)
+		return nullptr;
+	if (result != VK_SUCCESS)
+		throw std::runtime_error("Failed to allocate a device memory block!");
+
+	block->size = size;
+	block->mapped = nullptr;
+	block->ranges.Grow(size);
+	block->head = 0;
+	block->usedSize = 0;
+	block->allocationCount = 0;
+	block->dedicated = dedicated;
+
+	if (_memoryProperties.memoryTypes[pool.memoryType].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)
+	{
+		void* data;
+		if (vkMapMemory(_device, block->memory, 0, VK_WHOLE_SIZE, 0, &data) != VK_SUCCESS)
+			throw std::runtime_error("Failed to map a device memory block!");
+		block->mapped = static_cast<uint8_t*>(data);
+	}
+
+	_heapReservedSize[_memoryProperties.memoryTypes[pool.memoryType].heapIndex] += size;
+	pool.blocks.push_back(std::move(block));
+	return pool.blocks.back().get();
+}
+
+void DeviceMemoryAllocator::DestroyBlock(Pool& pool, const size_t& blockIndex)
+{
+	// Freeing implicitly unmaps
+	vkFreeMemory(_device, pool.blocks[blockIndex]->memory, nullptr);
+	_heapReservedSize[_memoryProperties.memoryTypes[pool.memoryType].heapIndex] -= pool.blocks[blockIndex]->size;
+	pool.blocks.erase(pool.blocks.begin() + static_cast<std::ptrdiff_t>(blockIndex));
+}
+
+uint32_t DeviceMemoryAllocator::FindMemoryType(const uint32_t& typeFilter, const VkMemoryPropertyFlags& properties, const VkMemoryPropertyFlags& preferredProperties) const
+{
+	const VkMemoryPropertyFlags allProperties = properties | preferredProperties;
+	for (uint32_t i = 0; i < _memoryProperties.memoryTypeCount; ++i)
+	{
+		if ((typeFilter & (1 << i)) && (_memoryProperties.memoryTypes[i].propertyFlags & allProperties) == allProperties)
+			return i;
+	}
+
+	for (uint32_t i = 0; i < _memoryProperties.memoryTypeCount; ++i)
+	{
+		if ((typeFilter & (1 << i)) && (_memoryProperties.memoryTypes[i].propertyFlags & properties) == properties)
+			return i;
+	}
+
+	throw std::runtime_error("Failed to find suitable memory type!");
+}
+
+VkDeviceSize DeviceMemoryAllocator::GetBlockSize(const uint32_t& memoryType) const
+{
+	const VkDeviceSize heapSize = _memoryProperties.memoryHeaps[_memoryProperties.memoryTypes[memoryType].heapIndex].size;
+	const VkDeviceSize heapBlockSize = heapSize / MIN_BLOCKS_PER_HEAP;
+	return heapBlockSize < DEFAULT_BLOCK_SIZE ? heapBlockSize : DEFAULT_BLOCK_SIZE;
+}
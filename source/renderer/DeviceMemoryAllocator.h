@@ -0,0 +1,135 @@
+#ifndef RENDERER_DEVICEMEMORYALLOCATOR_H_
+#define RENDERER_DEVICEMEMORYALLOCATOR_H_
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <vulkan/vulkan.h>
+
+#include "FHEAllocation.h"
+#include "FHEMemoryCategory.h"
+#include "FHEMemoryLifetime.h"
+#include "MemoryBudget.h"
+#include "MemoryHeapStatistics.h"
+#include "RangeAllocator.h"
+
+// Sub-allocates resources from large device memory blocks, one set of blocks per memory type, so the number of
+// vkAllocateMemory calls stays far below maxMemoryAllocationCount. Buffers and optimally tiled images never share
+// a block, which keeps bufferImageGranularity from applying between neighbours. Host visible blocks stay mapped.
+// Usage is accounted per FHEMemoryCategory and per heap. Allocations that would break a hard category budget or the
+// budget of a device local heap first ask the eviction callback to free something. Safe to call from any thread, but only
+// allocations on the thread that set the eviction callback evict, those from any other thread fail instead.
+class DeviceMemoryAllocator
+{
+public:
+	// Frees memory to make room for an allocation of the given category and size, false once there is nothing left to free
+	using EvictionCallback = std::function<bool(const FHEMemoryCategory& category, const VkDeviceSize& size)>;
+
+	DeviceMemoryAllocator(const VkDevice& device, const VkPhysicalDevice& physicalDevice, const bool& memoryBudgetSupported);
+	~DeviceMemoryAllocator();
+
+	DeviceMemoryAllocator(const DeviceMemoryAllocator&) = delete;
+	DeviceMemoryAllocator& operator=(const DeviceMemoryAllocator&) = delete;
+
+	// Allocate memory for the resource and bind it
+	void AllocateBufferMemory(const VkBuffer& buffer, const VkMemoryPropertyFlags& properties, const FHEMemoryLifetime& lifetime, const FHEMemoryCategory& category, FHEAllocation& allocation);
+	// preferredProperties are added to properties when a memory type has both, e.g. LAZILY_ALLOCATED for transient attachments
+	void AllocateImageMemory(const VkImage& image, const VkImageTiling& tiling, const VkMemoryPropertyFlags& properties, const FHEMemoryCategory& category, FHEAllocation& allocation, const VkMemoryPropertyFlags& preferredProperties = 0);
+	void Free(const FHEAllocation& allocation);
+
+	void SetBudget(const FHEMemoryCategory& category, const MemoryBudget& budget);
+	// The callback only ever runs on the calling thread, inside whichever of its allocations is over budget. It may block on the device.
+	void SetEvictionCallback(const EvictionCallback& evict);
+	// Fetches the heap budgets again, the driver only updates them every so often so once per frame is plenty
+	void UpdateHeapBudgets();
+	// Whether size more bytes stay within the soft budget of the category and the budget of every device local heap
+	[[nodiscard]] bool FitsSoftBudget(const FHEMemoryCategory& category, const VkDeviceSize& size) const;
+	[[nodiscard]] bool ExceedsHardBudget(const FHEMemoryCategory& category, const VkDeviceSize& size) const;
+	[[nodiscard]] VkDeviceSize GetCategoryUsage(const FHEMemoryCategory& category) const;
+
+	[[nodiscard]] std::vector<MemoryHeapStatistics> GetHeapStatistics() const;
+	void PrintStatistics() const;
+
+private:
+	enum PoolKind
+	{
+		POOL_KIND_LINEAR,
+		POOL_KIND_OPTIMAL,
+		POOL_KIND_TRANSIENT,
+		POOL_KIND_COUNT,
+	};
+
+	struct Block
+	{
+		VkDeviceMemory memory;
+		VkDeviceSize size;
+		uint8_t* mapped;
+		// Free list of persistent blocks
+		RangeAllocator ranges;
+		// Bump offset of transient blocks
+		VkDeviceSize head;
+		VkDeviceSize usedSize;
+		uint32_t allocationCount;
+		// Holds a single resource too large to share a block, released as soon as it is freed
+		bool dedicated;
+	};
+
+	struct Pool
+	{
+		uint32_t memoryType;
+		PoolKind kind;
+		std::vector<std::unique_ptr<Block>> blocks;
+	};
+
+	VkDevice _device;
+	VkPhysicalDevice _physicalDevice;
+	VkPhysicalDeviceMemoryProperties _memoryProperties;
+	std::array<Pool, VK_MAX_MEMORY_TYPES * POOL_KIND_COUNT> _pools;
+	mutable std::mutex _mutex;
+
+	std::array<MemoryBudget, FHE_MEMORY_CATEGORY_COUNT> _budgets;
+	std::array<VkDeviceSize, FHE_MEMORY_CATEGORY_COUNT> _categoryUsage;
+	EvictionCallback _evict;
+	std::thread::id _evictionThread;
+	// Set while the callback runs on _evictionThread, allocations it makes itself neither evict again nor fail on the budgets
+	std::atomic<bool> _evicting;
+	// Successful callbacks, reported by PrintStatistics
+	std::atomic<uint32_t> _evictionCount;
+
+	bool _memoryBudgetSupported;
+	std::array<VkDeviceSize, VK_MAX_MEMORY_HEAPS> _heapReservedSize;
+	std::array<VkDeviceSize, VK_MAX_MEMORY_HEAPS> _heapBudget;
+	// Usage reported by the driver at the last update and what this allocator had reserved then, blocks created or destroyed since are added on top
+	std::array<VkDeviceSize, VK_MAX_MEMORY_HEAPS> _heapUsageAtUpdate;
+	std::array<VkDeviceSize, VK_MAX_MEMORY_HEAPS> _heapReservedAtUpdate;
+
+	void Allocate(const VkMemoryRequirements& memoryRequirements, const VkMemoryPropertyFlags& properties, const VkMemoryPropertyFlags& preferredProperties, const PoolKind& kind, const FHEMemoryCategory& category, FHEAllocation& allocation);
+	[[nodiscard]] bool TryAllocateFromPool(const VkMemoryRequirements& memoryRequirements, const uint32_t& memoryType, const PoolKind& kind, const FHEMemoryCategory& category, FHEAllocation& allocation);
+	[[nodiscard]] static bool TryAllocate(Block& block, const PoolKind& kind, const VkDeviceSize& size, const VkDeviceSize& alignment, VkDeviceSize& offset);
+	[[nodiscard]] bool Evict(const FHEMemoryCategory& category, const VkDeviceSize& size);
+	// Whether the calling thread is inside the eviction callback
+	[[nodiscard]] bool IsEvicting() const;
+	[[nodiscard]] bool ExceedsBudget(const FHEMemoryCategory& category, const uint32_t& heapIndex, const VkDeviceSize& size) const;
+	[[nodiscard]] VkDeviceSize GetHeapUsage(const uint32_t& heapIndex) const;
+	// Null when the driver is out of memory
+	Block* CreateBlock(Pool& pool, const VkDeviceSize& size, const bool& dedicated);
+	void DestroyBlock(Pool& pool, const size_t& blockIndex);
+	[[nodiscard]] uint32_t FindMemoryType(const uint32_t& typeFilter, const VkMemoryPropertyFlags& properties, const VkMemoryPropertyFlags& preferredProperties) const;
+	[[nodiscard]] VkDeviceSize GetBlockSize(const uint32_t& memoryType) const;
+
+#pragma region Compile-Time Static Members
+	const static VkDeviceSize DEFAULT_BLOCK_SIZE = 64ull * 1024 * 1024;
+	// Heaps smaller than this many default blocks get proportionally smaller blocks
+	const static VkDeviceSize MIN_BLOCKS_PER_HEAP = 8;
+	// Share of a heap the process allows itself when the driver does not report a budget
+	const static VkDeviceSize FALLBACK_HEAP_BUDGET_PERCENT = 80;
+#pragma endregion Compile-Time Static Members
+};
+
+#endif
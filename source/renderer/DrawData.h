@@ -0,0 +1,23 @@
+#ifndef RENDERER_DRAWDATA_H_
+#define RENDERER_DRAWDATA_H_
+
+#include <cstdint>
+
+#include "VertexLayout.h"
+
+// Per-draw parameters next to every indirect draw record, shader.vert fetches them with firstDraw + gl_DrawID.
+// Matches the std430 layout of DrawData in shader.vert and cull.comp, 80 bytes with no padding.
+struct DrawData
+{
+	VertexLayout::Dequantization dequantization;
+	// Object space center in xyz and radius in w, cull.comp moves it with every instance transform
+	glm::vec4 boundingSphere;
+	uint32_t textureIndex;
+	// Instances before culling, a range of the transform buffer
+	uint32_t firstTransform;
+	uint32_t transformCount;
+	// Records of the model from this one on, only set on its first, which culls for all of them
+	uint32_t recordCount;
+};
+
+#endif
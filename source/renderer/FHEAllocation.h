@@ -0,0 +1,22 @@
+#ifndef RENDERER_FHEALLOCATION_H_
+#define RENDERER_FHEALLOCATION_H_
+
+#include <cstdint>
+
+#include <vulkan/vulkan.h>
+
+#include "FHEMemoryCategory.h"
+
+// A range of a device memory block handed out by DeviceMemoryAllocator
+struct FHEAllocation
+{
+	VkDeviceMemory memory = nullptr;
+	VkDeviceSize offset = 0;
+	VkDeviceSize size = 0;
+	// Persistently mapped address of the range, null unless the memory is host visible
+	void* mapped = nullptr;
+	uint32_t pool = 0;
+	FHEMemoryCategory category = FHE_MEMORY_CATEGORY_OTHER;
+};
+
+#endif
@@ -1,15 +1,24 @@
 #ifndef RENDERER_FHEIMAGE_H_
 #define RENDERER_FHEIMAGE_H_
 
+#include <cstdint>
+
 #include <vulkan/vulkan.h>
 
-#include "ktxvulkan.h"
+#include "FHEAllocation.h"
+#include "FHESamplerSettings.h"
 
 struct FHEImage
 {
+	VkImage image;
+	FHEAllocation allocation;
 	VkImageView view;
-	ktxVulkanTexture texture;
 	VkSampler sampler;
+	FHESamplerSettings samplerSettings;
+	VkFormat format;
+	uint32_t levelCount;
+	// Slot in the bindless texture table that shaders index with
+	uint32_t descriptorIndex;
 };
 
-#endif
\ No newline at end of file
+#endif
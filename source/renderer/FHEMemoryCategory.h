@@ -0,0 +1,17 @@
+#ifndef RENDERER_FHEMEMORYCATEGORY_H_
+#define RENDERER_FHEMEMORYCATEGORY_H_
+
+// What a device memory allocation holds. Every category is accounted and budgeted on its own.
+enum FHEMemoryCategory
+{
+	FHE_MEMORY_CATEGORY_MESH,
+	// Streamed textures are the only resources that can be evicted to get back under a budget
+	FHE_MEMORY_CATEGORY_TEXTURE,
+	FHE_MEMORY_CATEGORY_ATTACHMENT,
+	FHE_MEMORY_CATEGORY_STAGING,
+	// Uniform, transform and other small buffers
+	FHE_MEMORY_CATEGORY_OTHER,
+	FHE_MEMORY_CATEGORY_COUNT,
+};
+
+#endif
@@ -0,0 +1,13 @@
+#ifndef RENDERER_FHEMEMORYLIFETIME_H_
+#define RENDERER_FHEMEMORYLIFETIME_H_
+
+// How long a device memory allocation is expected to live, which decides the strategy it is sub-allocated with
+enum FHEMemoryLifetime
+{
+	// Free-list allocated, freed in any order
+	FHE_MEMORY_LIFETIME_PERSISTENT,
+	// Staging and other short-lived memory, bump allocated from blocks that rewind once everything in them is freed
+	FHE_MEMORY_LIFETIME_TRANSIENT,
+};
+
+#endif
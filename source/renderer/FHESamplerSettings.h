@@ -0,0 +1,18 @@
+#ifndef RENDERER_FHESAMPLERSETTINGS_H_
+#define RENDERER_FHESAMPLERSETTINGS_H_
+
+#include <vulkan/vulkan.h>
+
+// Per-texture filtering, textures with equal settings share one sampler
+struct FHESamplerSettings
+{
+	VkFilter magFilter = VK_FILTER_LINEAR;
+	VkFilter minFilter = VK_FILTER_LINEAR;
+	VkSamplerMipmapMode mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
+	VkSamplerAddressMode addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+	VkSamplerAddressMode addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+	// Clamped to the device limit, 1 disables anisotropic filtering
+	float maxAnisotropy = 16.f;
+};
+
+#endif
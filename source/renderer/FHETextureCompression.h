@@ -0,0 +1,13 @@
+#ifndef RENDERER_FHETEXTURECOMPRESSION_H_
+#define RENDERER_FHETEXTURECOMPRESSION_H_
+
+// Block-compressed format families the device can sample, combined as a bit mask
+enum FHETextureCompression
+{
+	FHE_TEXTURE_COMPRESSION_NONE = 0,
+	FHE_TEXTURE_COMPRESSION_BC = 1 << 0,
+	FHE_TEXTURE_COMPRESSION_ASTC = 1 << 1,
+	FHE_TEXTURE_COMPRESSION_ETC2 = 1 << 2,
+};
+
+#endif
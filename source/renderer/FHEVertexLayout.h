@@ -0,0 +1,15 @@
+#ifndef RENDERER_FHEVERTEXLAYOUT_H_
+#define RENDERER_FHEVERTEXLAYOUT_H_
+
+// Vertex buffer encodings, from the most precise to the most compact. Stored in the mesh cache, so only append.
+enum FHEVertexLayout
+{
+	// 20 bytes: float3 position, float2 texture coordinate
+	FHE_VERTEX_LAYOUT_FLOAT32,
+	// 12 bytes: snorm16x4 position normalized to the bounds, unorm16x2 texture coordinate normalized to the texture coordinate bounds
+	FHE_VERTEX_LAYOUT_SNORM16,
+
+	FHE_VERTEX_LAYOUT_COUNT,
+};
+
+#endif
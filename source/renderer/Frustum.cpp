@@ -0,0 +1,27 @@
+#include "Frustum.h"
+
+Frustum::Frustum(const glm::mat4& viewProjection)
+{
+	// Rows of the matrix, glm stores columns
+	const glm::mat4 rows = glm::transpose(viewProjection);
+	_planes[0] = rows[3] + rows[0];
+	_planes[1] = rows[3] - rows[0];
+	_planes[2] = rows[3] + rows[1];
+	_planes[3] = rows[3] - rows[1];
+	_planes[4] = rows[2];
+	_planes[5] = rows[3] - rows[2];
+
+	for (auto& plane : _planes)
+		plane /= glm::length(glm::vec3(plane));
+}
+
+bool Frustum::IntersectsSphere(const glm::vec3& center, const float& radius) const
+{
+	for (const auto& plane : _planes)
+	{
+		if (glm::dot(glm::vec3(plane), center) + plane.w < -radius)
+			return false;
+	}
+
+	return true;
+}
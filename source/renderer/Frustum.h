@@ -0,0 +1,21 @@
+#ifndef RENDERER_FRUSTUM_H_
+#define RENDERER_FRUSTUM_H_
+
+#include <array>
+
+#include <glm/glm.hpp>
+
+// View frustum as six inward facing planes, extracted from a view-projection matrix with a 0 to 1 depth range
+class Frustum
+{
+public:
+	explicit Frustum(const glm::mat4& viewProjection);
+
+	// Conservative, a sphere just outside a corner of the frustum still passes
+	[[nodiscard]] bool IntersectsSphere(const glm::vec3& center, const float& radius) const;
+
+private:
+	std::array<glm::vec4, 6> _planes;
+};
+
+#endif
@@ -0,0 +1,31 @@
+#ifndef RENDERER_GEOMETRYUPLOAD_H_
+#define RENDERER_GEOMETRYUPLOAD_H_
+
+#include <array>
+#include <cstdint>
+#include <string>
+
+#include <vulkan/vulkan.h>
+
+#include "MeshView.h"
+
+struct Model;
+
+// A streamed mesh on its way to the geometry arena. Loaded on a worker, staged through the staging ring a chunk at a time,
+// copied on the transfer queue and made visible to the graphics queue once timelineValue is reached.
+struct GeometryUpload
+{
+	Model* model = nullptr;
+	// Keeps the mapped mesh data alive until every byte of it has been staged
+	MeshView mesh;
+	// Why loading the mesh failed, empty on success. Failed uploads carry no mesh and are never staged.
+	std::string error;
+	// Bytes of the vertices followed by the indices already copied into the arena
+	VkDeviceSize stagedSize = 0;
+
+	uint64_t timelineValue = 0;
+	// Vertex and index range, released by the transfer family and acquired again by the graphics family
+	std::array<VkBufferMemoryBarrier, 2> ownershipBarriers{};
+};
+
+#endif
@@ -0,0 +1,19 @@
+#ifndef RENDERER_INSTANCEANIMATION_H_
+#define RENDERER_INSTANCEANIMATION_H_
+
+#include <glm/glm.hpp>
+
+// Per-instance spin, laid out like InstanceAnimation in animate.comp. Uploaded once, after that only the shader updates the angle.
+struct InstanceAnimation
+{
+	glm::mat4 restTransform;
+	// Object space, the rotation is applied before the rest transform
+	glm::vec3 axis;
+	// Radians per second
+	float angularVelocity;
+	// Phase at startup
+	float angle;
+	float padding[3];
+};
+
+#endif
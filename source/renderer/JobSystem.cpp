@@ -0,0 +1,127 @@
+#include "JobSystem.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <exception>
+
+JobSystem::JobSystem(const uint32_t& threadCount)
+{
+	_runningJobCount = 0;
+	_stopping = false;
+
+	uint32_t workerCount = threadCount;
+	if (workerCount == 0)
+		workerCount = std::max(2u, std::thread::hardware_concurrency()) - 1;
+
+	_threads.reserve(workerCount);
+	for (uint32_t i = 0; i < workerCount; ++i)
+		_threads.emplace_back(&JobSystem::WorkerLoop, this);
+}
+
+JobSystem::~JobSystem()
+{
+	{
+		std::lock_guard lock(_mutex);
+		_stopping = true;
+		// Jobs that have not started yet are dropped, running ones are finished
+		_jobs.clear();
+	}
+	_jobAvailable.notify_all();
+
+	for (auto& thread : _threads)
+		thread.join();
+}
+
+void JobSystem::Submit(std::function<void()> job)
+{
+	{
+		std::lock_guard lock(_mutex);
+		_jobs.push_back(std::move(job));
+	}
+	_jobAvailable.notify_one();
+}
+
+void JobSystem::Dispatch(const uint32_t& count, const std::function<void(uint32_t)>& job)
+{
+	std::mutex doneMutex;
+	std::condition_variable done;
+	uint32_t remaining = count;
+	std::exception_ptr firstError;
+
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		Submit([&, i]()
+			{
+				std::exception_ptr error;
+				try
+				{
+					job(i);
+				}
+				catch (...)
+				{
+					error = std::current_exception();
+				}
+
+				std::lock_guard lock(doneMutex);
+				if (error && !firstError)
+					firstError = error;
+				if (--remaining == 0)
+					done.notify_one();
+			});
+	}
+
+	std::unique_lock lock(doneMutex);
+	done.wait(lock, [&remaining]() { return remaining == 0; });
+
+	if (firstError)
+		std::rethrow_exception(firstError);
+}
+
+void JobSystem::WaitIdle()
+{
+	std::unique_lock lock(_mutex);
+	_idle.wait(lock, [this]() { return _jobs.empty() && _runningJobCount == 0; });
+}
+
+uint32_t JobSystem::GetThreadCount() const
+{
+	return static_cast<uint32_t>(_threads.size());
+}
+
+void JobSystem::WorkerLoop()
+{
+	while (true)
+	{
+		std::function<void()> job;
+		{
+			std::unique_lock lock(_mutex);
+			_jobAvailable.wait(lock, [this]() { return _stopping || !_jobs.empty(); });
+			if (_stopping)
+				return;
+
+			job = std::move(_jobs.front());
+			_jobs.pop_front();
+			++_runningJobCount;
+		}
+
+		try
+		{
+			job();
+		}
+		catch (const std::exception& e)
+		{
+			printf("Job failed: %s\n", e.what());
+		}
+		catch (...)
+		{
+			printf("Job failed with an unknown exception\n");
+		}
+
+		{
+			std::lock_guard lock(_mutex);
+			--_runningJobCount;
+			if (_jobs.empty() && _runningJobCount == 0)
+				_idle.notify_all();
+		}
+	}
+}
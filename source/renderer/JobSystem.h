@@ -0,0 +1,43 @@
+#ifndef RENDERER_JOBSYSTEM_H_
+#define RENDERER_JOBSYSTEM_H_
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed pool of worker threads consuming a FIFO of jobs. Jobs must report their own failures, anything escaping one is only logged and dropped.
+class JobSystem
+{
+public:
+	// 0 threads means one per hardware thread, minus the one driving the render loop
+	explicit JobSystem(const uint32_t& threadCount = 0);
+	~JobSystem();
+
+	JobSystem(const JobSystem&) = delete;
+	JobSystem& operator=(const JobSystem&) = delete;
+
+	void Submit(std::function<void()> job);
+	// Runs job(i) for every i in [0, count) on the workers and blocks until all returned, rethrowing the first failure. Must not be called from inside a job.
+	void Dispatch(const uint32_t& count, const std::function<void(uint32_t)>& job);
+	// Blocks until the queue is empty and no job is running
+	void WaitIdle();
+
+	[[nodiscard]] uint32_t GetThreadCount() const;
+
+private:
+	std::vector<std::thread> _threads;
+	std::deque<std::function<void()>> _jobs;
+	std::mutex _mutex;
+	std::condition_variable _jobAvailable;
+	std::condition_variable _idle;
+	uint32_t _runningJobCount;
+	bool _stopping;
+
+	void WorkerLoop();
+};
+
+#endif
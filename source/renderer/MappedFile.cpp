@@ -0,0 +1,99 @@
+#include "MappedFile.h"
+
+#include <stdexcept>
+
+#ifdef _WIN32
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+MappedFile::MappedFile(const std::string& filePath)
+{
+	_data = nullptr;
+	_size = 0;
+	_mappingHandle = nullptr;
+
+	_fileHandle = CreateFileA(filePath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (_fileHandle == INVALID_HANDLE_VALUE)
+		throw std::runtime_error("Failed to open file for mapping: " + filePath);
+
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(_fileHandle, &fileSize) || fileSize.QuadPart == 0)
+	{
+		CloseHandle(_fileHandle);
+		throw std::runtime_error("Cannot map an empty file: " + filePath);
+	}
+	_size = static_cast<size_t>(fileSize.QuadPart);
+
+	_mappingHandle = CreateFileMappingA(_fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (!_mappingHandle)
+	{
+		CloseHandle(_fileHandle);
+		throw std::runtime_error("Failed to create file mapping: " + filePath);
+	}
+
+	_data = static_cast<const uint8_t*>(MapViewOfFile(_mappingHandle, FILE_MAP_READ, 0, 0, 0));
+	if (!_data)
+	{
+		CloseHandle(_mappingHandle);
+		CloseHandle(_fileHandle);
+		throw std::runtime_error("Failed to map view of file: " + filePath);
+	}
+}
+
+MappedFile::~MappedFile()
+{
+	UnmapViewOfFile(_data);
+	CloseHandle(_mappingHandle);
+	CloseHandle(_fileHandle);
+}
+#else
+MappedFile::MappedFile(const std::string& filePath)
+{
+	_data = nullptr;
+	_size = 0;
+
+	_fileDescriptor = open(filePath.c_str(), O_RDONLY);
+	if (_fileDescriptor < 0)
+		throw std::runtime_error("Failed to open file for mapping: " + filePath);
+
+	struct stat fileStats{};
+	if (fstat(_fileDescriptor, &fileStats) != 0 || fileStats.st_size == 0)
+	{
+		close(_fileDescriptor);
+		throw std::runtime_error("Cannot map an empty file: " + filePath);
+	}
+	_size = static_cast<size_t>(fileStats.st_size);
+
+	void* data = mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, _fileDescriptor, 0);
+	if (data == MAP_FAILED)
+	{
+		close(_fileDescriptor);
+		throw std::runtime_error("Failed to map file: " + filePath);
+	}
+	_data = static_cast<const uint8_t*>(data);
+}
+
+MappedFile::~MappedFile()
+{
+	munmap(const_cast<uint8_t*>(_data), _size);
+	close(_fileDescriptor);
+}
+#endif
+
+const uint8_t* MappedFile::Data() const
+{
+	return _data;
+}
+
+size_t MappedFile::Size() const
+{
+	return _size;
+}
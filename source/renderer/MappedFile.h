@@ -0,0 +1,32 @@
+#ifndef RENDERER_MAPPEDFILE_H_
+#define RENDERER_MAPPEDFILE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Read-only memory mapping of a whole file. The mapping is released when the object is destroyed.
+class MappedFile
+{
+public:
+	explicit MappedFile(const std::string& filePath);
+	~MappedFile();
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	[[nodiscard]] const uint8_t* Data() const;
+	[[nodiscard]] size_t Size() const;
+
+private:
+	const uint8_t* _data;
+	size_t _size;
+#ifdef _WIN32
+	void* _fileHandle;
+	void* _mappingHandle;
+#else
+	int _fileDescriptor;
+#endif
+};
+
+#endif
@@ -0,0 +1,14 @@
+#ifndef RENDERER_MEMORYBUDGET_H_
+#define RENDERER_MEMORYBUDGET_H_
+
+#include <vulkan/vulkan.h>
+
+// Limits of one FHEMemoryCategory in bytes, 0 meaning unlimited. Streaming stops growing at the soft limit and evicts
+// to get back under it. An allocation that would cross the hard limit evicts right away and fails only when nothing is left to evict.
+struct MemoryBudget
+{
+	VkDeviceSize softSize = 0;
+	VkDeviceSize hardSize = 0;
+};
+
+#endif
@@ -0,0 +1,22 @@
+#ifndef RENDERER_MEMORYHEAPSTATISTICS_H_
+#define RENDERER_MEMORYHEAPSTATISTICS_H_
+
+#include <cstdint>
+
+#include <vulkan/vulkan.h>
+
+struct MemoryHeapStatistics
+{
+	uint32_t blockCount = 0;
+	uint32_t allocationCount = 0;
+	// Bytes handed out to resources, against bytes allocated from the driver
+	VkDeviceSize usedSize = 0;
+	VkDeviceSize reservedSize = 0;
+	// What the process may use of the heap and uses of it, from VK_EXT_memory_budget when available, otherwise a share of the heap against reservedSize
+	VkDeviceSize budgetSize = 0;
+	VkDeviceSize usageSize = 0;
+	// 0 when all free space is one contiguous range, towards 1 the more it is split up
+	float fragmentation = 0.f;
+};
+
+#endif
@@ -0,0 +1,229 @@
+#include "MeshCache.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+#include "MappedFile.h"
+#include "MeshImporter.h"
+#include "MeshOptimizer.h"
+#include "VertexLayout.h"
+
+MeshView MeshCache::Load(const std::string& sourcePath)
+{
+	const auto startTime = std::chrono::steady_clock::now();
+	const std::string cachePath = GetCachePath(sourcePath);
+	uint64_t sourceSize, sourceWriteTime;
+	StatSource(sourcePath, sourceSize, sourceWriteTime);
+
+	MeshView mesh{};
+	const bool warm = IsCurrent(cachePath, sourcePath, sourceSize, sourceWriteTime) && TryMap(cachePath, mesh);
+	if (!warm)
+	{
+		std::vector<Vertex> vertices;
+		std::vector<uint32_t> indices;
+		MeshImporter::ImportObj(sourcePath, vertices, indices);
+		// Optimized once here so every warm load maps the already reordered arrays
+		MeshOptimizer::Optimize(vertices, indices);
+
+		std::vector<Submesh> submeshes;
+		if (SPLIT_FOR_SHORT_INDICES)
+			MeshOptimizer::SplitForShortIndices(vertices, indices, submeshes, SHORT_INDEX_VERTEX_LIMIT);
+		else
+			submeshes.push_back(Submesh{ 0, static_cast<uint32_t>(indices.size()), 0 });
+
+		Write(cachePath, sourceSize, sourceWriteTime, HashFile(sourcePath), vertices, indices, submeshes);
+		if (!TryMap(cachePath, mesh))
+			throw std::runtime_error("Failed to map the mesh cache that was just written: " + cachePath);
+	}
+
+	const std::chrono::duration<float, std::milli> loadTime = std::chrono::steady_clock::now() - startTime;
+	printf("%s load of %s: %.2fms (%u vertices of %u bytes, %u indices of %u bytes in %zu submeshes)\n", warm ? "Warm" : "Cold", sourcePath.c_str(), loadTime.count(),
+		mesh.vertexCount, VertexLayout::GetStride(mesh.vertexLayout), mesh.indexCount, mesh.indexSize, mesh.submeshes.size());
+
+	return mesh;
+}
+
+std::string MeshCache::GetCachePath(const std::string& sourcePath)
+{
+	return sourcePath + ".fhemesh";
+}
+
+uint64_t MeshCache::HashFile(const std::string& filePath)
+{
+	const MappedFile file(filePath);
+
+	// 64-bit FNV-1a
+	uint64_t hash = 14695981039346656037ull;
+	const uint8_t* data = file.Data();
+	for (size_t i = 0; i < file.Size(); ++i)
+	{
+		hash ^= data[i];
+		hash *= 1099511628211ull;
+	}
+
+	return hash;
+}
+
+void MeshCache::StatSource(const std::string& sourcePath, uint64_t& sourceSize, uint64_t& sourceWriteTime)
+{
+	std::error_code error;
+	sourceSize = std::filesystem::file_size(sourcePath, error);
+	if (error)
+		throw std::runtime_error("Failed to open mesh source: " + sourcePath);
+	sourceWriteTime = static_cast<uint64_t>(std::filesystem::last_write_time(sourcePath, error).time_since_epoch().count());
+}
+
+bool MeshCache::IsCurrent(const std::string& cachePath, const std::string& sourcePath, const uint64_t& sourceSize, const uint64_t& sourceWriteTime)
+{
+	Header header{};
+	{
+		std::ifstream file(cachePath, std::ios::binary);
+		if (!file.is_open() || !file.read(reinterpret_cast<char*>(&header), sizeof(Header)))
+			return false;
+	}
+	if (header.magic != MAGIC || header.version != VERSION || header.sourceSize != sourceSize)
+		return false;
+	if (header.sourceWriteTime == sourceWriteTime)
+		return true;
+
+	// Touched without necessarily being edited, e.g. by a checkout
+	if (header.sourceHash != HashFile(sourcePath))
+		return false;
+
+	// Stored so the next load skips the hash again. Another load may have the cache mapped, so a patched copy is swapped in instead of
+	// writing into it, named per thread so concurrent refreshes do not share it. Failing only means the next load hashes again.
+	const std::string temporaryPath = cachePath + ".tmp" + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id()));
+	std::error_code error;
+	if (!std::filesystem::copy_file(cachePath, temporaryPath, std::filesystem::copy_options::overwrite_existing, error))
+		return true;
+
+	bool patched = false;
+	{
+		std::fstream file(temporaryPath, std::ios::binary | std::ios::in | std::ios::out);
+		if (file.is_open())
+		{
+			file.seekp(offsetof(Header, sourceWriteTime));
+			file.write(reinterpret_cast<const char*>(&sourceWriteTime), sizeof(sourceWriteTime));
+			file.close();
+			patched = !file.fail();
+		}
+	}
+	if (patched)
+		std::filesystem::rename(temporaryPath, cachePath, error);
+	if (!patched || error)
+		std::filesystem::remove(temporaryPath, error);
+	return true;
+}
+
+bool MeshCache::TryMap(const std::string& cachePath, MeshView& mesh)
+{
+	std::error_code error;
+	if (!std::filesystem::exists(cachePath, error) || std::filesystem::file_size(cachePath, error) < sizeof(Header))
+		return false;
+
+	auto file = std::make_shared<MappedFile>(cachePath);
+
+	Header header{};
+	memcpy(&header, file->Data(), sizeof(Header));
+	if (header.magic != MAGIC || header.version != VERSION || header.vertexLayout >= FHE_VERTEX_LAYOUT_COUNT)
+		return false;
+	const auto vertexLayout = static_cast<FHEVertexLayout>(header.vertexLayout);
+	if (header.vertexStride != VertexLayout::GetStride(vertexLayout) || (header.indexSize != sizeof(uint16_t) && header.indexSize != sizeof(uint32_t)) || header.submeshCount == 0)
+		return false;
+
+	const size_t submeshBytes = static_cast<size_t>(header.submeshCount) * sizeof(Submesh);
+	const size_t vertexBytes = static_cast<size_t>(header.vertexCount) * header.vertexStride;
+	const size_t indexBytes = static_cast<size_t>(header.indexCount) * header.indexSize;
+	if (file->Size() != sizeof(Header) + submeshBytes + vertexBytes + indexBytes)
+		return false;
+
+	mesh.submeshes.resize(header.submeshCount);
+	memcpy(mesh.submeshes.data(), file->Data() + sizeof(Header), submeshBytes);
+
+	mesh.vertexData = file->Data() + sizeof(Header) + submeshBytes;
+	mesh.vertexCount = header.vertexCount;
+	mesh.vertexLayout = vertexLayout;
+	mesh.indexData = file->Data() + sizeof(Header) + submeshBytes + vertexBytes;
+	mesh.indexCount = header.indexCount;
+	mesh.indexSize = header.indexSize;
+	mesh.boundsMin = header.boundsMin;
+	mesh.boundsMax = header.boundsMax;
+	mesh.texCoordMin = header.texCoordMin;
+	mesh.texCoordMax = header.texCoordMax;
+	mesh.storage = std::move(file);
+
+	return true;
+}
+
+void MeshCache::Write(const std::string& cachePath, const uint64_t& sourceSize, const uint64_t& sourceWriteTime, const uint64_t& sourceHash, const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices, const std::vector<Submesh>& submeshes)
+{
+	Header header{};
+	header.magic = MAGIC;
+	header.version = VERSION;
+	header.vertexCount = static_cast<uint32_t>(vertices.size());
+	header.indexCount = static_cast<uint32_t>(indices.size());
+	header.submeshCount = static_cast<uint32_t>(submeshes.size());
+	header.sourceSize = sourceSize;
+	header.sourceWriteTime = sourceWriteTime;
+	header.sourceHash = sourceHash;
+	ComputeBounds(vertices, header.boundsMin, header.boundsMax, header.texCoordMin, header.texCoordMax);
+
+	const FHEVertexLayout vertexLayout = VertexLayout::Choose(vertices, header.boundsMin, header.boundsMax, header.texCoordMin, header.texCoordMax);
+	header.vertexLayout = vertexLayout;
+	header.vertexStride = VertexLayout::GetStride(vertexLayout);
+	std::vector<uint8_t> packedVertices;
+	VertexLayout::Pack(vertexLayout, vertices, header.boundsMin, header.boundsMax, header.texCoordMin, header.texCoordMax, packedVertices);
+
+	// Indices are relative to their submesh's vertexOffset, so they fit 16 bits whenever every submesh does
+	const bool shortIndices = std::all_of(indices.begin(), indices.end(), [](const uint32_t& index) { return index <= UINT16_MAX; });
+	header.indexSize = shortIndices ? sizeof(uint16_t) : sizeof(uint32_t);
+	std::vector<uint16_t> packedIndices;
+	if (shortIndices)
+		packedIndices.assign(indices.begin(), indices.end());
+
+	// Written next to the final path and then swapped in, so an interrupted write never leaves a truncated cache behind
+	const std::string temporaryPath = cachePath + ".tmp";
+	{
+		std::ofstream file(temporaryPath, std::ios::binary | std::ios::trunc);
+		if (!file.is_open())
+			throw std::runtime_error("Failed to open mesh cache for writing: " + temporaryPath);
+
+		file.write(reinterpret_cast<const char*>(&header), sizeof(Header));
+		file.write(reinterpret_cast<const char*>(submeshes.data()), static_cast<std::streamsize>(submeshes.size() * sizeof(Submesh)));
+		file.write(reinterpret_cast<const char*>(packedVertices.data()), static_cast<std::streamsize>(packedVertices.size()));
+		if (shortIndices)
+			file.write(reinterpret_cast<const char*>(packedIndices.data()), static_cast<std::streamsize>(packedIndices.size() * sizeof(uint16_t)));
+		else
+			file.write(reinterpret_cast<const char*>(indices.data()), static_cast<std::streamsize>(indices.size() * sizeof(uint32_t)));
+
+		if (!file.good())
+			throw std::runtime_error("Failed to write mesh cache: " + temporaryPath);
+	}
+
+	std::filesystem::rename(temporaryPath, cachePath);
+}
+
+void MeshCache::ComputeBounds(const std::vector<Vertex>& vertices, glm::vec3& boundsMin, glm::vec3& boundsMax, glm::vec2& texCoordMin, glm::vec2& texCoordMax)
+{
+	boundsMin = vertices.empty() ? glm::vec3(0.f) : vertices[0].position;
+	boundsMax = boundsMin;
+	texCoordMin = vertices.empty() ? glm::vec2(0.f) : vertices[0].texCoord;
+	texCoordMax = texCoordMin;
+	for (const auto& vertex : vertices)
+	{
+		boundsMin = glm::min(boundsMin, vertex.position);
+		boundsMax = glm::max(boundsMax, vertex.position);
+		texCoordMin = glm::min(texCoordMin, vertex.texCoord);
+		texCoordMax = glm::max(texCoordMax, vertex.texCoord);
+	}
+}
@@ -0,0 +1,60 @@
+#ifndef RENDERER_MESHCACHE_H_
+#define RENDERER_MESHCACHE_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "MeshView.h"
+#include "Vertex.h"
+
+// Versioned binary mesh format holding the final deduplicated vertex and index arrays of a source model.
+// Loading maps the cache file and hands out pointers into it, so a warm load never parses or copies the geometry.
+// Staleness is judged by the source's size and write time, the source is only read when those disagree with the cache.
+class MeshCache
+{
+public:
+	// Maps the cache for sourcePath, importing the source and rebuilding the cache first if it is missing or stale
+	static MeshView Load(const std::string& sourcePath);
+
+	[[nodiscard]] static std::string GetCachePath(const std::string& sourcePath);
+	[[nodiscard]] static uint64_t HashFile(const std::string& filePath);
+
+private:
+	struct Header
+	{
+		uint32_t magic;
+		uint32_t version;
+		uint32_t vertexStride;
+		uint32_t vertexCount;
+		uint32_t indexCount;
+		uint32_t vertexLayout;
+		uint32_t indexSize;
+		uint32_t submeshCount;
+		uint64_t sourceSize;
+		uint64_t sourceWriteTime;
+		uint64_t sourceHash;
+		glm::vec3 boundsMin;
+		glm::vec3 boundsMax;
+		glm::vec2 texCoordMin;
+		glm::vec2 texCoordMax;
+	};
+
+	// "FHEM" in little-endian
+	const static uint32_t MAGIC = 0x4D454846;
+	// Bump whenever the layout of the file or the import, optimization and vertex packing passes change
+	const static uint32_t VERSION = 6;
+	// Meshes with more vertices than a 16-bit index can address are split into submeshes that each fit
+	const static bool SPLIT_FOR_SHORT_INDICES = true;
+	const static uint32_t SHORT_INDEX_VERTEX_LIMIT = 1u << 16;
+
+	// Size and last write time of the source, which identify it without reading it
+	static void StatSource(const std::string& sourcePath, uint64_t& sourceSize, uint64_t& sourceWriteTime);
+	// Only hashes the source when its size matches but its write time does not, and refreshes the stored write time if the content turns out unchanged
+	[[nodiscard]] static bool IsCurrent(const std::string& cachePath, const std::string& sourcePath, const uint64_t& sourceSize, const uint64_t& sourceWriteTime);
+	[[nodiscard]] static bool TryMap(const std::string& cachePath, MeshView& mesh);
+	static void Write(const std::string& cachePath, const uint64_t& sourceSize, const uint64_t& sourceWriteTime, const uint64_t& sourceHash, const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices, const std::vector<Submesh>& submeshes);
+	static void ComputeBounds(const std::vector<Vertex>& vertices, glm::vec3& boundsMin, glm::vec3& boundsMax, glm::vec2& texCoordMin, glm::vec2& texCoordMax);
+};
+
+#endif
@@ -0,0 +1,258 @@
+#include "MeshImporter.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <exception>
+#include <functional>
+#include <stdexcept>
+#include <thread>
+#include <unordered_map>
+
+#include "VertexWelder.h"
+
+#define TINYOBJLOADER_IMPLEMENTATION
+#include "tiny_obj_loader.h"
+
+namespace
+{
+	struct WeldChunk
+	{
+		const tinyobj::index_t* objIndices;
+		size_t indexCount;
+
+		std::vector<Vertex> vertices;
+		std::vector<uint32_t> indices;
+		std::vector<uint32_t> remap;
+		size_t firstIndex;
+	};
+
+	uint32_t ResolveThreadCount(const uint32_t& threadCount)
+	{
+		if (threadCount != 0)
+			return threadCount;
+		return std::max(1u, std::thread::hardware_concurrency());
+	}
+
+	// Runs body(i) for every i in [0, count) on up to threadCount threads, rethrowing the first failure
+	void ParallelFor(const size_t& count, const uint32_t& threadCount, const std::function<void(size_t)>& body)
+	{
+		const uint32_t workerCount = static_cast<uint32_t>(std::min<size_t>(threadCount, count));
+		if (workerCount <= 1)
+		{
+			for (size_t i = 0; i < count; ++i)
+				body(i);
+			return;
+		}
+
+		std::atomic<size_t> next{ 0 };
+		std::exception_ptr error;
+		std::atomic<bool> failed{ false };
+		auto worker = [&]()
+		{
+			try
+			{
+				for (size_t i = next++; i < count && !failed; i = next++)
+					body(i);
+			}
+			catch (...)
+			{
+				if (!failed.exchange(true))
+					error = std::current_exception();
+			}
+		};
+
+		std::vector<std::thread> threads;
+		threads.reserve(workerCount - 1);
+		for (uint32_t i = 1; i < workerCount; ++i)
+			threads.emplace_back(worker);
+		worker();
+		for (auto& thread : threads)
+			thread.join();
+
+		if (error)
+			std::rethrow_exception(error);
+	}
+
+	Vertex MakeVertex(const tinyobj::attrib_t& attrib, const tinyobj::index_t& index)
+	{
+		Vertex vertex{};
+		vertex.position = {
+			attrib.vertices[3 * index.vertex_index + 0],
+			attrib.vertices[3 * index.vertex_index + 1],
+			attrib.vertices[3 * index.vertex_index + 2]
+		};
+		if (index.texcoord_index >= 0)
+		{
+			vertex.texCoord = {
+				attrib.texcoords[2 * index.texcoord_index + 0],
+				1.f - attrib.texcoords[2 * index.texcoord_index + 1]
+			};
+		}
+
+		return vertex;
+	}
+
+	void ParseObj(const std::string& filePath, tinyobj::attrib_t& attrib, std::vector<tinyobj::shape_t>& shapes)
+	{
+		std::vector<tinyobj::material_t> materials;
+		std::string warn, err;
+
+		if (!LoadObj(&attrib, &shapes, &materials, &warn, &err, filePath.c_str()))
+			throw std::runtime_error(warn + err);
+	}
+
+	// Welds every chunk independently, then merges the per-chunk vertices through one global table so that
+	// vertices shared across chunk and shape boundaries still end up welded. Merging only touches each chunk's
+	// unique vertices, and the final index rewrite runs in parallel again. The output is identical for any thread count.
+	void Weld(const tinyobj::attrib_t& attrib, const std::vector<tinyobj::shape_t>& shapes, const uint32_t& threadCount, const size_t minChunkIndexCount, const uint32_t chunksPerThread, std::vector<Vertex>& vertices, std::vector<uint32_t>& indices)
+	{
+		size_t totalIndexCount = 0;
+		for (const auto& shape : shapes)
+			totalIndexCount += shape.mesh.indices.size();
+
+		size_t chunkIndexCount = totalIndexCount / (static_cast<size_t>(threadCount) * chunksPerThread);
+		chunkIndexCount = std::max(minChunkIndexCount, chunkIndexCount - chunkIndexCount % 3);
+
+		std::vector<WeldChunk> chunks;
+		size_t firstIndex = 0;
+		for (const auto& shape : shapes)
+		{
+			const auto& objIndices = shape.mesh.indices;
+			for (size_t offset = 0; offset < objIndices.size(); offset += chunkIndexCount)
+			{
+				WeldChunk chunk{};
+				chunk.objIndices = objIndices.data() + offset;
+				chunk.indexCount = std::min(chunkIndexCount, objIndices.size() - offset);
+				chunk.firstIndex = firstIndex;
+				firstIndex += chunk.indexCount;
+				chunks.push_back(std::move(chunk));
+			}
+		}
+
+		ParallelFor(chunks.size(), threadCount, [&](size_t chunkIndex)
+			{
+				WeldChunk& chunk = chunks[chunkIndex];
+				// Typical meshes share each vertex between ~6 triangles, so this rarely has to grow
+				VertexWelder welder(chunk.indexCount / 4);
+				chunk.indices.resize(chunk.indexCount);
+				for (size_t i = 0; i < chunk.indexCount; ++i)
+					chunk.indices[i] = welder.Insert(MakeVertex(attrib, chunk.objIndices[i]));
+				chunk.vertices = std::move(welder.GetVertices());
+			});
+
+		size_t localVertexCount = 0;
+		for (const auto& chunk : chunks)
+			localVertexCount += chunk.vertices.size();
+
+		VertexWelder globalWelder(localVertexCount);
+		for (auto& chunk : chunks)
+		{
+			chunk.remap.resize(chunk.vertices.size());
+			for (size_t i = 0; i < chunk.vertices.size(); ++i)
+				chunk.remap[i] = globalWelder.Insert(chunk.vertices[i]);
+			std::vector<Vertex>().swap(chunk.vertices);
+		}
+
+		indices.resize(totalIndexCount);
+		ParallelFor(chunks.size(), threadCount, [&](size_t chunkIndex)
+			{
+				const WeldChunk& chunk = chunks[chunkIndex];
+				uint32_t* output = indices.data() + chunk.firstIndex;
+				for (size_t i = 0; i < chunk.indexCount; ++i)
+					output[i] = chunk.remap[chunk.indices[i]];
+			});
+
+		vertices = std::move(globalWelder.GetVertices());
+	}
+}
+
+void MeshImporter::ImportObj(const std::string& filePath, std::vector<Vertex>& vertices, std::vector<uint32_t>& indices, const uint32_t& threadCount)
+{
+	tinyobj::attrib_t attrib;
+	std::vector<tinyobj::shape_t> shapes;
+	ParseObj(filePath, attrib, shapes);
+
+	Weld(attrib, shapes, ResolveThreadCount(threadCount), MIN_CHUNK_INDEX_COUNT, CHUNKS_PER_THREAD, vertices, indices);
+}
+
+void MeshImporter::BenchmarkObj(const std::string& filePath)
+{
+	using Clock = std::chrono::steady_clock;
+	using Milliseconds = std::chrono::duration<float, std::milli>;
+
+	tinyobj::attrib_t attrib;
+	std::vector<tinyobj::shape_t> shapes;
+	const auto parseStart = Clock::now();
+	ParseObj(filePath, attrib, shapes);
+	const Milliseconds parseTime = Clock::now() - parseStart;
+
+	size_t totalIndexCount = 0;
+	for (const auto& shape : shapes)
+		totalIndexCount += shape.mesh.indices.size();
+	printf("Import benchmark of %s: %zu shapes, %zu triangles, parsed in %.2fms\n", filePath.c_str(), shapes.size(), totalIndexCount / 3, parseTime.count());
+
+	// Reference: the single-threaded std::unordered_map weld the importer used to do
+	std::vector<Vertex> referenceVertices;
+	std::vector<uint32_t> referenceIndices;
+	float referenceTime = 0.f;
+	for (uint32_t repeat = 0; repeat < BENCHMARK_REPEATS; ++repeat)
+	{
+		referenceVertices.clear();
+		referenceIndices.clear();
+		const auto startTime = Clock::now();
+		std::unordered_map<Vertex, uint32_t> uniqueVertices{};
+		for (const auto& shape : shapes)
+		{
+			for (const auto& index : shape.mesh.indices)
+			{
+				const Vertex vertex = MakeVertex(attrib, index);
+				if (uniqueVertices.count(vertex) == 0)
+				{
+					uniqueVertices[vertex] = static_cast<uint32_t>(referenceVertices.size());
+					referenceVertices.push_back(vertex);
+				}
+				referenceIndices.push_back(uniqueVertices[vertex]);
+			}
+		}
+		const Milliseconds elapsed = Clock::now() - startTime;
+		referenceTime = repeat == 0 ? elapsed.count() : std::min(referenceTime, elapsed.count());
+	}
+	printf("  unordered_map reference: %9.2fms (%zu vertices)\n", referenceTime, referenceVertices.size());
+
+	const uint32_t hardwareThreads = ResolveThreadCount(0);
+	std::vector<uint32_t> threadCounts;
+	for (uint32_t threadCount = 1; threadCount < hardwareThreads; threadCount *= 2)
+		threadCounts.push_back(threadCount);
+	threadCounts.push_back(hardwareThreads);
+
+	std::vector<Vertex> firstVertices;
+	std::vector<uint32_t> firstIndices;
+	float singleThreadTime = 0.f;
+	for (const uint32_t& threadCount : threadCounts)
+	{
+		std::vector<Vertex> vertices;
+		std::vector<uint32_t> indices;
+		float bestTime = 0.f;
+		for (uint32_t repeat = 0; repeat < BENCHMARK_REPEATS; ++repeat)
+		{
+			const auto startTime = Clock::now();
+			Weld(attrib, shapes, threadCount, MIN_CHUNK_INDEX_COUNT, CHUNKS_PER_THREAD, vertices, indices);
+			const Milliseconds elapsed = Clock::now() - startTime;
+			bestTime = repeat == 0 ? elapsed.count() : std::min(bestTime, elapsed.count());
+		}
+
+		if (threadCount == threadCounts.front())
+		{
+			singleThreadTime = bestTime;
+			firstVertices = vertices;
+			firstIndices = indices;
+		}
+		const bool matches = vertices.size() == firstVertices.size() && indices == firstIndices;
+
+		printf("  %3u thread(s):           %9.2fms (%zu vertices) %5.2fx vs 1 thread, %5.2fx vs reference, %.1fM tris/s%s\n",
+			threadCount, bestTime, vertices.size(), singleThreadTime / bestTime, referenceTime / bestTime,
+			static_cast<float>(totalIndexCount / 3) / (bestTime * 1000.f), matches ? "" : " OUTPUT MISMATCH");
+	}
+}
@@ -0,0 +1,35 @@
+#ifndef RENDERER_MESHIMPORTER_H_
+#define RENDERER_MESHIMPORTER_H_
+
+#ifndef RENDERER_DLL
+#define RENDERER_MESHIMPORTER_API __declspec(dllexport)
+#else
+#define RENDERER_MESHIMPORTER_API __declspec(dllimport)
+#endif
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "Vertex.h"
+
+class MeshImporter
+{
+public:
+	// Parses an OBJ file and welds identical vertices into an indexed triangle list.
+	// Welding is split across threadCount workers, 0 meaning one per hardware thread.
+	static void ImportObj(const std::string& filePath, std::vector<Vertex>& vertices, std::vector<uint32_t>& indices, const uint32_t& threadCount = 0);
+
+	// Parses an OBJ file once, then times the weld at increasing thread counts and prints the scaling
+	RENDERER_MESHIMPORTER_API static void BenchmarkObj(const std::string& filePath);
+
+private:
+#pragma region Compile-Time Static Members
+	// Shapes are cut into chunks of whole triangles so a single huge shape still spreads over every worker
+	const static size_t MIN_CHUNK_INDEX_COUNT = 3 * 16384;
+	const static uint32_t CHUNKS_PER_THREAD = 4;
+	const static uint32_t BENCHMARK_REPEATS = 3;
+#pragma endregion Compile-Time Static Members
+};
+
+#endif
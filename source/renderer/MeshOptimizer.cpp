@@ -0,0 +1,318 @@
+#include "MeshOptimizer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+
+namespace
+{
+	const uint32_t INVALID_INDEX = UINT32_MAX;
+
+	// Fixed-size FIFO that reports whether a vertex had to be transformed
+	class FifoCache
+	{
+	public:
+		FifoCache(const size_t vertexCount, const uint32_t cacheSize) : _timestamps(vertexCount, 0), _cacheSize(cacheSize), _time(cacheSize + 1) {}
+
+		bool Access(const uint32_t& vertex)
+		{
+			if (_time - _timestamps[vertex] <= _cacheSize)
+				return false;
+
+			_timestamps[vertex] = _time++;
+			return true;
+		}
+
+		void Clear()
+		{
+			_time += _cacheSize + 1;
+		}
+
+	private:
+		std::vector<uint32_t> _timestamps;
+		uint32_t _cacheSize;
+		uint32_t _time;
+	};
+}
+
+void MeshOptimizer::Optimize(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices)
+{
+	const auto startTime = std::chrono::steady_clock::now();
+	const CacheStatistics before = AnalyzeVertexCache(indices, vertices.size());
+
+	OptimizeVertexCache(indices, vertices.size());
+	if (OPTIMIZE_OVERDRAW)
+		OptimizeOverdraw(indices, vertices, OVERDRAW_THRESHOLD);
+	OptimizeVertexFetch(vertices, indices);
+
+	const CacheStatistics after = AnalyzeVertexCache(indices, vertices.size());
+	const std::chrono::duration<float, std::milli> optimizeTime = std::chrono::steady_clock::now() - startTime;
+	printf("Mesh optimization (%u entry FIFO): ACMR %.3f -> %.3f, ATVR %.3f -> %.3f in %.2fms\n",
+		VERTEX_CACHE_SIZE, before.acmr, after.acmr, before.atvr, after.atvr, optimizeTime.count());
+}
+
+void MeshOptimizer::OptimizeVertexCache(std::vector<uint32_t>& indices, const size_t& vertexCount)
+{
+	// Tipsify, Sander et al. 2007: fan around a vertex, then pick the next fanning vertex among those just
+	// emitted that will still be in the cache, preferring the oldest; fall back to a dead-end stack on misses
+	const size_t triangleCount = indices.size() / 3;
+	if (triangleCount == 0 || vertexCount == 0)
+		return;
+
+	std::vector<uint32_t> liveTriangles(vertexCount, 0);
+	for (const auto& index : indices)
+		++liveTriangles[index];
+
+	std::vector<uint32_t> adjacencyOffsets(vertexCount + 1, 0);
+	for (size_t vertex = 0; vertex < vertexCount; ++vertex)
+		adjacencyOffsets[vertex + 1] = adjacencyOffsets[vertex] + liveTriangles[vertex];
+
+	std::vector<uint32_t> adjacency(indices.size());
+	{
+		std::vector<uint32_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+		for (size_t i = 0; i < indices.size(); ++i)
+			adjacency[fill[indices[i]]++] = static_cast<uint32_t>(i / 3);
+	}
+
+	std::vector<uint32_t> cacheTimestamps(vertexCount, 0);
+	std::vector<bool> emitted(triangleCount, false);
+	std::vector<uint32_t> deadEnd;
+	std::vector<uint32_t> candidates;
+	std::vector<uint32_t> output;
+	output.reserve(indices.size());
+
+	uint32_t time = VERTEX_CACHE_SIZE + 1;
+	uint32_t cursor = 0;
+	uint32_t fanningVertex = 0;
+	while (fanningVertex != INVALID_INDEX)
+	{
+		candidates.clear();
+		for (uint32_t i = adjacencyOffsets[fanningVertex]; i < adjacencyOffsets[fanningVertex + 1]; ++i)
+		{
+			const uint32_t triangle = adjacency[i];
+			if (emitted[triangle])
+				continue;
+
+			for (uint32_t corner = 0; corner < 3; ++corner)
+			{
+				const uint32_t vertex = indices[triangle * 3 + corner];
+				output.push_back(vertex);
+				deadEnd.push_back(vertex);
+				candidates.push_back(vertex);
+				--liveTriangles[vertex];
+				if (time - cacheTimestamps[vertex] > VERTEX_CACHE_SIZE)
+					cacheTimestamps[vertex] = time++;
+			}
+			emitted[triangle] = true;
+		}
+
+		// Prefer the candidate that entered the cache earliest, as long as fanning it will not push it out
+		fanningVertex = INVALID_INDEX;
+		int64_t bestPriority = -1;
+		for (const auto& vertex : candidates)
+		{
+			if (liveTriangles[vertex] == 0)
+				continue;
+
+			int64_t priority = 0;
+			if (time - cacheTimestamps[vertex] + 2 * liveTriangles[vertex] <= VERTEX_CACHE_SIZE)
+				priority = time - cacheTimestamps[vertex];
+			if (priority > bestPriority)
+			{
+				bestPriority = priority;
+				fanningVertex = vertex;
+			}
+		}
+
+		while (fanningVertex == INVALID_INDEX && !deadEnd.empty())
+		{
+			const uint32_t vertex = deadEnd.back();
+			deadEnd.pop_back();
+			if (liveTriangles[vertex] > 0)
+				fanningVertex = vertex;
+		}
+
+		while (fanningVertex == INVALID_INDEX && cursor < vertexCount)
+		{
+			if (liveTriangles[cursor] > 0)
+				fanningVertex = cursor;
+			++cursor;
+		}
+	}
+
+	indices.swap(output);
+}
+
+void MeshOptimizer::OptimizeOverdraw(std::vector<uint32_t>& indices, const std::vector<Vertex>& vertices, const float& threshold)
+{
+	const size_t triangleCount = indices.size() / 3;
+	if (triangleCount == 0)
+		return;
+
+	const float targetAcmr = AnalyzeVertexCache(indices, vertices.size()).acmr * threshold;
+
+	// Cut the list into clusters that start with a cold cache. A cluster ends as soon as its own ACMR is within
+	// the threshold of the whole mesh, so drawing the clusters in any order costs at most that much extra.
+	std::vector<size_t> clusterStarts;
+	FifoCache cache(vertices.size(), VERTEX_CACHE_SIZE);
+	size_t clusterStart = 0;
+	uint32_t clusterMisses = 0;
+	for (size_t triangle = 0; triangle < triangleCount; ++triangle)
+	{
+		if (triangle == clusterStart)
+		{
+			clusterStarts.push_back(clusterStart);
+			cache.Clear();
+			clusterMisses = 0;
+		}
+
+		for (uint32_t corner = 0; corner < 3; ++corner)
+			clusterMisses += cache.Access(indices[triangle * 3 + corner]) ? 1 : 0;
+
+		if (static_cast<float>(clusterMisses) / static_cast<float>(triangle + 1 - clusterStart) <= targetAcmr)
+			clusterStart = triangle + 1;
+	}
+	clusterStarts.push_back(triangleCount);
+
+	glm::vec3 meshCentroid{ 0.f };
+	float meshArea = 0.f;
+	std::vector<float> clusterSortKeys(clusterStarts.size() - 1);
+	std::vector<glm::vec3> clusterCentroids(clusterStarts.size() - 1);
+	std::vector<glm::vec3> clusterNormals(clusterStarts.size() - 1);
+	for (size_t cluster = 0; cluster + 1 < clusterStarts.size(); ++cluster)
+	{
+		glm::vec3 centroid{ 0.f };
+		glm::vec3 normal{ 0.f };
+		float area = 0.f;
+		for (size_t triangle = clusterStarts[cluster]; triangle < clusterStarts[cluster + 1]; ++triangle)
+		{
+			const glm::vec3& a = vertices[indices[triangle * 3 + 0]].position;
+			const glm::vec3& b = vertices[indices[triangle * 3 + 1]].position;
+			const glm::vec3& c = vertices[indices[triangle * 3 + 2]].position;
+			const glm::vec3 scaledNormal = glm::cross(b - a, c - a);
+			const float triangleArea = glm::length(scaledNormal);
+
+			centroid += (a + b + c) * (triangleArea / 3.f);
+			normal += scaledNormal;
+			area += triangleArea;
+		}
+
+		meshCentroid += centroid;
+		meshArea += area;
+		clusterCentroids[cluster] = area > 0.f ? centroid / area : vertices[indices[clusterStarts[cluster] * 3]].position;
+		clusterNormals[cluster] = glm::length(normal) > 0.f ? glm::normalize(normal) : glm::vec3(0.f);
+	}
+	if (meshArea > 0.f)
+		meshCentroid /= meshArea;
+
+	// Clusters far out along their own normal are the likeliest occluders, so they are drawn first
+	for (size_t cluster = 0; cluster < clusterSortKeys.size(); ++cluster)
+		clusterSortKeys[cluster] = glm::dot(clusterCentroids[cluster] - meshCentroid, clusterNormals[cluster]);
+
+	std::vector<size_t> clusterOrder(clusterSortKeys.size());
+	for (size_t cluster = 0; cluster < clusterOrder.size(); ++cluster)
+		clusterOrder[cluster] = cluster;
+	std::stable_sort(clusterOrder.begin(), clusterOrder.end(), [&clusterSortKeys](const size_t& lhs, const size_t& rhs)
+		{
+			return clusterSortKeys[lhs] > clusterSortKeys[rhs];
+		});
+
+	std::vector<uint32_t> output;
+	output.reserve(indices.size());
+	for (const auto& cluster : clusterOrder)
+		output.insert(output.end(), indices.begin() + clusterStarts[cluster] * 3, indices.begin() + clusterStarts[cluster + 1] * 3);
+
+	indices.swap(output);
+}
+
+void MeshOptimizer::OptimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices)
+{
+	std::vector<uint32_t> remap(vertices.size(), INVALID_INDEX);
+	std::vector<Vertex> output;
+	output.reserve(vertices.size());
+
+	for (auto& index : indices)
+	{
+		if (remap[index] == INVALID_INDEX)
+		{
+			remap[index] = static_cast<uint32_t>(output.size());
+			output.push_back(vertices[index]);
+		}
+		index = remap[index];
+	}
+
+	vertices.swap(output);
+}
+
+void MeshOptimizer::SplitForShortIndices(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices, std::vector<Submesh>& submeshes, const uint32_t maxVertexCount)
+{
+	submeshes.clear();
+	if (vertices.size() <= maxVertexCount)
+	{
+		submeshes.push_back(Submesh{ 0, static_cast<uint32_t>(indices.size()), 0 });
+		return;
+	}
+
+	std::vector<uint32_t> localIndices(vertices.size(), INVALID_INDEX);
+	std::vector<uint32_t> submeshVertices;
+	std::vector<Vertex> outputVertices;
+	outputVertices.reserve(vertices.size());
+	std::vector<uint32_t> outputIndices;
+	outputIndices.reserve(indices.size());
+
+	Submesh submesh{ 0, 0, 0 };
+	for (size_t triangle = 0; triangle < indices.size() / 3; ++triangle)
+	{
+		// A triangle adds at most three vertices, so cutting on that bound never overflows the submesh
+		if (submeshVertices.size() + 3 > maxVertexCount)
+		{
+			submesh.indexCount = static_cast<uint32_t>(outputIndices.size()) - submesh.firstIndex;
+			submeshes.push_back(submesh);
+
+			for (const auto& vertex : submeshVertices)
+				localIndices[vertex] = INVALID_INDEX;
+			submeshVertices.clear();
+			submesh = Submesh{ static_cast<uint32_t>(outputIndices.size()), 0, static_cast<int32_t>(outputVertices.size()) };
+		}
+
+		for (uint32_t corner = 0; corner < 3; ++corner)
+		{
+			const uint32_t vertex = indices[triangle * 3 + corner];
+			if (localIndices[vertex] == INVALID_INDEX)
+			{
+				localIndices[vertex] = static_cast<uint32_t>(submeshVertices.size());
+				submeshVertices.push_back(vertex);
+				outputVertices.push_back(vertices[vertex]);
+			}
+			outputIndices.push_back(localIndices[vertex]);
+		}
+	}
+	submesh.indexCount = static_cast<uint32_t>(outputIndices.size()) - submesh.firstIndex;
+	submeshes.push_back(submesh);
+
+	vertices.swap(outputVertices);
+	indices.swap(outputIndices);
+}
+
+MeshOptimizer::CacheStatistics MeshOptimizer::AnalyzeVertexCache(const std::vector<uint32_t>& indices, const size_t& vertexCount)
+{
+	FifoCache cache(vertexCount, VERTEX_CACHE_SIZE);
+	std::vector<bool> referenced(vertexCount, false);
+	size_t misses = 0;
+	size_t uniqueVertices = 0;
+	for (const auto& index : indices)
+	{
+		misses += cache.Access(index) ? 1 : 0;
+		if (!referenced[index])
+		{
+			referenced[index] = true;
+			++uniqueVertices;
+		}
+	}
+
+	CacheStatistics statistics{};
+	statistics.acmr = indices.empty() ? 0.f : static_cast<float>(misses) / static_cast<float>(indices.size() / 3);
+	statistics.atvr = uniqueVertices == 0 ? 0.f : static_cast<float>(misses) / static_cast<float>(uniqueVertices);
+
+	return statistics;
+}
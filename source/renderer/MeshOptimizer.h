@@ -0,0 +1,49 @@
+#ifndef RENDERER_MESHOPTIMIZER_H_
+#define RENDERER_MESHOPTIMIZER_H_
+
+#include <cstdint>
+#include <vector>
+
+#include "Submesh.h"
+#include "Vertex.h"
+
+// Reorders an indexed triangle list for the GPU: triangles for the post-transform vertex cache (Tipsify),
+// optionally clusters of those triangles for overdraw, and finally vertices into the order they are fetched.
+// None of the passes change the rendered result, only the order work reaches the GPU in.
+class MeshOptimizer
+{
+public:
+	struct CacheStatistics
+	{
+		// Average cache miss ratio: transformed vertices per triangle, 0.5 is the lower bound for a regular grid
+		float acmr;
+		// Average transform to vertex ratio: transformed vertices per unique vertex, 1.0 is ideal
+		float atvr;
+	};
+
+	// Runs every pass in order and prints the cache statistics before and after
+	static void Optimize(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices);
+
+	static void OptimizeVertexCache(std::vector<uint32_t>& indices, const size_t& vertexCount);
+	// Must run after OptimizeVertexCache, clusters are cut where the reordered list still hits the cache well
+	static void OptimizeOverdraw(std::vector<uint32_t>& indices, const std::vector<Vertex>& vertices, const float& threshold);
+	// Renumbers vertices in first-use order and drops unreferenced ones
+	static void OptimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices);
+
+	// Cuts the triangle list, in its current order, into submeshes that each reference at most maxVertexCount vertices
+	// starting at their own vertexOffset. Vertices shared across a cut are duplicated and indices become submesh-relative.
+	static void SplitForShortIndices(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices, std::vector<Submesh>& submeshes, const uint32_t maxVertexCount);
+
+	[[nodiscard]] static CacheStatistics AnalyzeVertexCache(const std::vector<uint32_t>& indices, const size_t& vertexCount);
+
+private:
+#pragma region Compile-Time Static Members
+	// FIFO size the passes optimize for and the statistics are measured with
+	const static uint32_t VERTEX_CACHE_SIZE = 16;
+	const static bool OPTIMIZE_OVERDRAW = true;
+	// Overdraw clusters may cost at most this factor of the cache-optimized ACMR
+	constexpr static float OVERDRAW_THRESHOLD = 1.05f;
+#pragma endregion Compile-Time Static Members
+};
+
+#endif
@@ -0,0 +1,36 @@
+#ifndef RENDERER_MESHVIEW_H_
+#define RENDERER_MESHVIEW_H_
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "FHEVertexLayout.h"
+#include "Submesh.h"
+
+// Read-only geometry ready to be uploaded. The arrays normally point straight into a memory-mapped mesh cache, which storage keeps alive.
+struct MeshView
+{
+	// Packed in vertexLayout, see VertexLayout for the stride and the dequantization from the bounds
+	const uint8_t* vertexData = nullptr;
+	uint32_t vertexCount = 0;
+	FHEVertexLayout vertexLayout = FHE_VERTEX_LAYOUT_FLOAT32;
+	// Either uint16_t or uint32_t indices, as given by indexSize
+	const uint8_t* indexData = nullptr;
+	uint32_t indexCount = 0;
+	uint32_t indexSize = sizeof(uint32_t);
+	// Always at least one, several when a large mesh was split so that every part fits 16-bit indices
+	std::vector<Submesh> submeshes;
+
+	glm::vec3 boundsMin{};
+	glm::vec3 boundsMax{};
+	// Range the packed texture coordinates are normalized to
+	glm::vec2 texCoordMin{};
+	glm::vec2 texCoordMax{};
+
+	std::shared_ptr<const void> storage;
+};
+
+#endif
@@ -1,15 +1,29 @@
 #ifndef RENDERER_MODEL_H_
 #define RENDERER_MODEL_H_
+#include <vector>
+
 #include "FHEImage.h"
-#include "Vertex.h"
+#include "MeshView.h"
 
 struct Model
 {
-	std::vector<Vertex> vertices;
-	std::vector<uint32_t> indices;
+	MeshView mesh;
 	std::vector<FHEImage> textures;
+	// Matches mesh.indexSize, UINT16 whenever every submesh addresses fewer than 65,536 vertices
+	VkIndexType indexType;
+
+	// Placement inside the shared geometry arena, in bytes for freeing and in elements for drawing
+	VkDeviceSize vertexArenaOffset;
+	VkDeviceSize indexArenaOffset;
+	int32_t vertexOffset;
+	uint32_t firstIndex;
 
 	uint32_t transformIndex;
+
+	// Set once the streamed geometry has been acquired by the graphics queue, until then the model is skipped
+	bool resident;
+	// Set when loading the streamed geometry threw, the model then never becomes resident
+	bool geometryFailed;
 };
 
 #endif
\ No newline at end of file
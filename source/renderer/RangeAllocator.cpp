@@ -0,0 +1,126 @@
+#include "RangeAllocator.h"
+
+#include <algorithm>
+#include <iterator>
+#include <stdexcept>
+
+RangeAllocator::RangeAllocator(const uint64_t& size)
+{
+	_size = 0;
+	_usedSize = 0;
+	Grow(size);
+}
+
+bool RangeAllocator::Allocate(const uint64_t& size, const uint64_t& alignment, uint64_t& offset)
+{
+	if (size == 0 || alignment == 0)
+		throw std::runtime_error("Range allocations need a non-zero size and alignment!");
+
+	for (auto it = _freeRanges.begin(); it != _freeRanges.end(); ++it)
+	{
+		const uint64_t rangeOffset = it->first;
+		const uint64_t rangeSize = it->second;
+		const uint64_t alignedOffset = AlignUp(rangeOffset, alignment);
+		if (alignedOffset + size > rangeOffset + rangeSize)
+			continue;
+
+		// Split into the alignment padding, the allocation and the remainder, returning both ends to the free list
+		_freeRanges.erase(it);
+		if (alignedOffset > rangeOffset)
+			_freeRanges[rangeOffset] = alignedOffset - rangeOffset;
+		if (alignedOffset + size < rangeOffset + rangeSize)
+			_freeRanges[alignedOffset + size] = rangeOffset + rangeSize - alignedOffset - size;
+
+		_allocations[alignedOffset] = size;
+		_usedSize += size;
+		offset = alignedOffset;
+		return true;
+	}
+
+	return false;
+}
+
+void RangeAllocator::Free(const uint64_t& offset)
+{
+	const auto allocation = _allocations.find(offset);
+	if (allocation == _allocations.end())
+		throw std::runtime_error("Freeing a range that was not allocated!");
+
+	_usedSize -= allocation->second;
+	AddFreeRange(offset, allocation->second);
+	_allocations.erase(allocation);
+}
+
+void RangeAllocator::Grow(const uint64_t& newSize)
+{
+	if (newSize <= _size)
+		return;
+
+	const uint64_t oldSize = _size;
+	_size = newSize;
+	AddFreeRange(oldSize, newSize - oldSize);
+}
+
+uint64_t RangeAllocator::GetRequiredSize(const uint64_t& size, const uint64_t& alignment) const
+{
+	uint64_t tailOffset = _size;
+	if (!_freeRanges.empty())
+	{
+		const auto& lastRange = *_freeRanges.rbegin();
+		if (lastRange.first + lastRange.second == _size)
+			tailOffset = lastRange.first;
+	}
+
+	return AlignUp(tailOffset, alignment) + size;
+}
+
+uint64_t RangeAllocator::GetSize() const
+{
+	return _size;
+}
+
+uint64_t RangeAllocator::GetUsedSize() const
+{
+	return _usedSize;
+}
+
+uint64_t RangeAllocator::GetLargestFreeRange() const
+{
+	uint64_t largestSize = 0;
+	for (const auto& [offset, size] : _freeRanges)
+		largestSize = std::max(largestSize, size);
+	return largestSize;
+}
+
+uint64_t RangeAllocator::AlignUp(const uint64_t& value, const uint64_t& alignment)
+{
+	return (value + alignment - 1) / alignment * alignment;
+}
+
+void RangeAllocator::AddFreeRange(const uint64_t& offset, const uint64_t& size)
+{
+	if (size == 0)
+		return;
+
+	uint64_t rangeOffset = offset;
+	uint64_t rangeSize = size;
+
+	const auto next = _freeRanges.lower_bound(offset);
+	if (next != _freeRanges.begin())
+	{
+		const auto previous = std::prev(next);
+		if (previous->first + previous->second == rangeOffset)
+		{
+			rangeOffset = previous->first;
+			rangeSize += previous->second;
+			_freeRanges.erase(previous);
+		}
+	}
+	if (next != _freeRanges.end() && offset + size == next->first)
+	{
+		rangeSize += next->second;
+		_freeRanges.erase(next);
+	}
+
+	_freeRanges[rangeOffset] = rangeSize;
+}
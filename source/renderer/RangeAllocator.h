@@ -0,0 +1,38 @@
+#ifndef RENDERER_RANGEALLOCATOR_H_
+#define RENDERER_RANGEALLOCATOR_H_
+
+#include <cstdint>
+#include <map>
+#include <unordered_map>
+
+// First-fit sub-allocator for a linear range such as a buffer. It only does the bookkeeping, the owner of the
+// memory grows it when Allocate fails. Freed ranges are coalesced with their free neighbours.
+class RangeAllocator
+{
+public:
+	explicit RangeAllocator(const uint64_t& size = 0);
+
+	// Alignment does not need to be a power of two, so vertex ranges can be aligned to their stride
+	[[nodiscard]] bool Allocate(const uint64_t& size, const uint64_t& alignment, uint64_t& offset);
+	void Free(const uint64_t& offset);
+	// Appends [GetSize(), newSize) to the free space
+	void Grow(const uint64_t& newSize);
+
+	// Smallest total size that would let Allocate succeed by placing the range at the end
+	[[nodiscard]] uint64_t GetRequiredSize(const uint64_t& size, const uint64_t& alignment) const;
+	[[nodiscard]] uint64_t GetSize() const;
+	[[nodiscard]] uint64_t GetUsedSize() const;
+	[[nodiscard]] uint64_t GetLargestFreeRange() const;
+
+private:
+	uint64_t _size;
+	uint64_t _usedSize;
+	// Offset to size, ordered so neighbours can be found when coalescing
+	std::map<uint64_t, uint64_t> _freeRanges;
+	std::unordered_map<uint64_t, uint64_t> _allocations;
+
+	[[nodiscard]] static uint64_t AlignUp(const uint64_t& value, const uint64_t& alignment);
+	void AddFreeRange(const uint64_t& offset, const uint64_t& size);
+};
+
+#endif
@@ -0,0 +1,106 @@
+#include "SamplerCache.h"
+
+#include <functional>
+#include <stdexcept>
+
+namespace
+{
+	template<typename T>
+	void HashCombine(size_t& seed, const T& value)
+	{
+		seed ^= std::hash<T>()(value) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+	}
+}
+
+bool SamplerCache::Key::operator==(const Key& other) const
+{
+	const VkSamplerCreateInfo& a = createInfo;
+	const VkSamplerCreateInfo& b = other.createInfo;
+	return a.flags == b.flags && a.magFilter == b.magFilter && a.minFilter == b.minFilter && a.mipmapMode == b.mipmapMode
+		&& a.addressModeU == b.addressModeU && a.addressModeV == b.addressModeV && a.addressModeW == b.addressModeW
+		&& a.mipLodBias == b.mipLodBias && a.anisotropyEnable == b.anisotropyEnable && a.maxAnisotropy == b.maxAnisotropy
+		&& a.compareEnable == b.compareEnable && a.compareOp == b.compareOp && a.minLod == b.minLod && a.maxLod == b.maxLod
+		&& a.borderColor == b.borderColor && a.unnormalizedCoordinates == b.unnormalizedCoordinates;
+}
+
+size_t SamplerCache::KeyHash::operator()(const Key& key) const
+{
+	const VkSamplerCreateInfo& info = key.createInfo;
+	size_t seed = 0;
+	HashCombine(seed, static_cast<uint32_t>(info.flags));
+	HashCombine(seed, static_cast<uint32_t>(info.magFilter));
+	HashCombine(seed, static_cast<uint32_t>(info.minFilter));
+	HashCombine(seed, static_cast<uint32_t>(info.mipmapMode));
+	HashCombine(seed, static_cast<uint32_t>(info.addressModeU));
+	HashCombine(seed, static_cast<uint32_t>(info.addressModeV));
+	HashCombine(seed, static_cast<uint32_t>(info.addressModeW));
+	HashCombine(seed, info.mipLodBias);
+	HashCombine(seed, static_cast<uint32_t>(info.anisotropyEnable));
+	HashCombine(seed, info.maxAnisotropy);
+	HashCombine(seed, static_cast<uint32_t>(info.compareEnable));
+	HashCombine(seed, static_cast<uint32_t>(info.compareOp));
+	HashCombine(seed, info.minLod);
+	HashCombine(seed, info.maxLod);
+	HashCombine(seed, static_cast<uint32_t>(info.borderColor));
+	HashCombine(seed, static_cast<uint32_t>(info.unnormalizedCoordinates));
+	return seed;
+}
+
+SamplerCache::SamplerCache(const VkDevice& device)
+{
+	_device = device;
+}
+
+SamplerCache::~SamplerCache()
+{
+	Clear();
+}
+
+VkSampler SamplerCache::Acquire(const VkSamplerCreateInfo& createInfo)
+{
+	if (createInfo.pNext != nullptr)
+		throw std::runtime_error("Cached samplers cannot chain create info structures!");
+
+	Key key{ createInfo };
+	if (const auto cached = _samplers.find(key); cached != _samplers.end())
+	{
+		++cached->second.referenceCount;
+		return cached->second.sampler;
+	}
+
+	VkSampler sampler;
+	if (vkCreateSampler(_device, &createInfo, nullptr, &sampler) != VK_SUCCESS)
+		throw std::runtime_error("Failed to create texture sampler!");
+
+	_samplers.emplace(key, Entry{ sampler, 1 });
+	_keys.emplace(sampler, key);
+	return sampler;
+}
+
+void SamplerCache::Release(const VkSampler& sampler)
+{
+	const auto key = _keys.find(sampler);
+	if (key == _keys.end())
+		throw std::runtime_error("Released a sampler the cache does not own!");
+
+	const auto entry = _samplers.find(key->second);
+	if (--entry->second.referenceCount > 0)
+		return;
+
+	vkDestroySampler(_device, sampler, nullptr);
+	_samplers.erase(entry);
+	_keys.erase(key);
+}
+
+void SamplerCache::Clear()
+{
+	for (const auto& [key, entry] : _samplers)
+		vkDestroySampler(_device, entry.sampler, nullptr);
+	_samplers.clear();
+	_keys.clear();
+}
+
+size_t SamplerCache::GetSamplerCount() const
+{
+	return _samplers.size();
+}
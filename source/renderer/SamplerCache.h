@@ -0,0 +1,52 @@
+#ifndef RENDERER_SAMPLERCACHE_H_
+#define RENDERER_SAMPLERCACHE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+
+#include <vulkan/vulkan.h>
+
+// Shares one VkSampler between every user of identical sampler state. Samplers are reference counted and
+// destroyed when the last user releases them. Chained pNext structures are not part of the key and must be null.
+class SamplerCache
+{
+public:
+	explicit SamplerCache(const VkDevice& device);
+	~SamplerCache();
+
+	SamplerCache(const SamplerCache&) = delete;
+	SamplerCache& operator=(const SamplerCache&) = delete;
+
+	[[nodiscard]] VkSampler Acquire(const VkSamplerCreateInfo& createInfo);
+	void Release(const VkSampler& sampler);
+	// Destroys every sampler regardless of its users, for device teardown
+	void Clear();
+
+	[[nodiscard]] size_t GetSamplerCount() const;
+
+private:
+	struct Key
+	{
+		VkSamplerCreateInfo createInfo;
+
+		bool operator==(const Key& other) const;
+	};
+
+	struct KeyHash
+	{
+		size_t operator()(const Key& key) const;
+	};
+
+	struct Entry
+	{
+		VkSampler sampler;
+		uint32_t referenceCount;
+	};
+
+	VkDevice _device;
+	std::unordered_map<Key, Entry, KeyHash> _samplers;
+	std::unordered_map<VkSampler, Key> _keys;
+};
+
+#endif
@@ -0,0 +1,124 @@
+#include "StagingRing.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+StagingRing::StagingRing(const uint64_t& size)
+{
+	_size = size;
+	_head = 0;
+	_tail = 0;
+	_usedSize = 0;
+	_openBatchSize = 0;
+	_nextBatch = 1;
+	_stagedSize = 0;
+	_sampleTime = std::chrono::steady_clock::now();
+}
+
+bool StagingRing::Allocate(const uint64_t& size, const uint64_t& alignment, uint64_t& offset)
+{
+	if (size == 0 || alignment == 0)
+		throw std::runtime_error("Staging allocations need a non-zero size and alignment!");
+
+	// Nothing in flight, start over at the beginning for the largest contiguous space
+	if (_usedSize == 0)
+	{
+		_head = 0;
+		_tail = 0;
+	}
+
+	uint64_t newHead;
+	if (_head > _tail || _usedSize == 0)
+	{
+		// Free space is [head, size) followed by [0, tail)
+		offset = AlignUp(_head, alignment);
+		if (offset + size <= _size)
+			newHead = offset + size;
+		else if (size <= _tail)
+		{
+			// The end of the ring is skipped and counted as used until this batch is released
+			offset = 0;
+			newHead = size;
+		}
+		else
+			return false;
+	}
+	else
+	{
+		// Free space is [head, tail), none at all when the ring is full
+		offset = AlignUp(_head, alignment);
+		if (_head == _tail || offset + size > _tail)
+			return false;
+		newHead = offset + size;
+	}
+
+	const uint64_t consumedSize = newHead > _head ? newHead - _head : _size - _head + newHead;
+	_usedSize += consumedSize;
+	_openBatchSize += consumedSize;
+	_head = newHead;
+	_stagedSize += size;
+	return true;
+}
+
+uint64_t StagingRing::GetAvailableSize(const uint64_t& alignment) const
+{
+	if (_usedSize == 0)
+		return _size;
+
+	if (_head > _tail)
+	{
+		const uint64_t alignedHead = AlignUp(_head, alignment);
+		return std::max(alignedHead < _size ? _size - alignedHead : 0, _tail);
+	}
+
+	const uint64_t alignedHead = AlignUp(_head, alignment);
+	return alignedHead < _tail ? _tail - alignedHead : 0;
+}
+
+uint64_t StagingRing::Submit()
+{
+	const uint64_t batch = _nextBatch++;
+	_batches.push_back({ batch, _head, _openBatchSize, false });
+	_openBatchSize = 0;
+	return batch;
+}
+
+void StagingRing::Release(const uint64_t& batch)
+{
+	const auto released = std::find_if(_batches.begin(), _batches.end(), [&batch](const Batch& candidate) { return candidate.id == batch; });
+	if (released == _batches.end())
+		throw std::runtime_error("Releasing a staging batch that was not submitted!");
+	released->released = true;
+
+	while (!_batches.empty() && _batches.front().released)
+	{
+		// An empty batch may predate the ring starting over, its end no longer says anything about the tail
+		if (_batches.front().size != 0)
+			_tail = _batches.front().end;
+		_usedSize -= _batches.front().size;
+		_batches.pop_front();
+	}
+}
+
+uint64_t StagingRing::GetSize() const
+{
+	return _size;
+}
+
+bool StagingRing::SampleThroughput(const float& intervalSeconds, float& megabytesPerSecond)
+{
+	const auto now = std::chrono::steady_clock::now();
+	const float elapsed = std::chrono::duration<float>(now - _sampleTime).count();
+	if (elapsed < intervalSeconds)
+		return false;
+
+	megabytesPerSecond = static_cast<float>(_stagedSize) / (1000.f * 1000.f) / elapsed;
+	_stagedSize = 0;
+	_sampleTime = now;
+	return true;
+}
+
+uint64_t StagingRing::AlignUp(const uint64_t& value, const uint64_t& alignment)
+{
+	return (value + alignment - 1) / alignment * alignment;
+}
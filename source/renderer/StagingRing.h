@@ -0,0 +1,51 @@
+#ifndef RENDERER_STAGINGRING_H_
+#define RENDERER_STAGINGRING_H_
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+
+// Bookkeeping for a persistently mapped ring buffer that every upload is staged through. Allocations go into the
+// open batch. Submit closes it once the copies reading it have been submitted, and Release hands its space back once
+// those copies have completed. Space is reclaimed in submission order, so a batch released early waits for older ones.
+class StagingRing
+{
+public:
+	explicit StagingRing(const uint64_t& size = 0);
+
+	[[nodiscard]] bool Allocate(const uint64_t& size, const uint64_t& alignment, uint64_t& offset);
+	// Largest size Allocate would currently succeed with
+	[[nodiscard]] uint64_t GetAvailableSize(const uint64_t& alignment) const;
+	[[nodiscard]] uint64_t Submit();
+	void Release(const uint64_t& batch);
+
+	[[nodiscard]] uint64_t GetSize() const;
+	// Megabytes staged per second since the previous sample, false until intervalSeconds have passed
+	[[nodiscard]] bool SampleThroughput(const float& intervalSeconds, float& megabytesPerSecond);
+
+private:
+	struct Batch
+	{
+		uint64_t id;
+		// Head once the batch was closed, the tail moves there when the batch is reclaimed
+		uint64_t end;
+		// Bytes the batch holds including alignment padding and space skipped when wrapping
+		uint64_t size;
+		bool released;
+	};
+
+	uint64_t _size;
+	uint64_t _head;
+	uint64_t _tail;
+	uint64_t _usedSize;
+	uint64_t _openBatchSize;
+	uint64_t _nextBatch;
+	std::deque<Batch> _batches;
+
+	uint64_t _stagedSize;
+	std::chrono::steady_clock::time_point _sampleTime;
+
+	[[nodiscard]] static uint64_t AlignUp(const uint64_t& value, const uint64_t& alignment);
+};
+
+#endif
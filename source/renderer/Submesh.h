@@ -0,0 +1,14 @@
+#ifndef RENDERER_SUBMESH_H_
+#define RENDERER_SUBMESH_H_
+
+#include <cstdint>
+
+// Range of a mesh's index buffer drawn with one vkCmdDrawIndexed. Indices are relative to vertexOffset.
+struct Submesh
+{
+	uint32_t firstIndex;
+	uint32_t indexCount;
+	int32_t vertexOffset;
+};
+
+#endif
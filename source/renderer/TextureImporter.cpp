@@ -0,0 +1,48 @@
+#include "TextureImporter.h"
+
+#include <filesystem>
+#include <stdexcept>
+
+ktxTexture* TextureImporter::Load(std::string filePath, const uint32_t& supportedCompression)
+{
+	if (filePath.find('.') == std::string::npos)
+		throw std::runtime_error("Could not load a texture, because the filePath was invalid!");
+
+	filePath = filePath.substr(0, filePath.find_last_of('.'));
+	filePath.append(std::filesystem::exists(filePath + ".ktx2") ? ".ktx2" : ".ktx");
+
+	ktxTexture* texture;
+	if (ktxTexture_CreateFromNamedFile(filePath.c_str(), KTX_TEXTURE_CREATE_LOAD_IMAGE_DATA_BIT, &texture) != KTX_error_code::KTX_SUCCESS)
+		throw std::runtime_error("Failed to create the texture from given file path!");
+
+	if (texture->classId != ktxTexture2_c)
+		return texture;
+
+	// BasisLZ and UASTC only carry an intermediate representation, every level of the stored mip chain is transcoded in place
+	const auto texture2 = reinterpret_cast<ktxTexture2*>(texture);
+	if (!ktxTexture2_NeedsTranscoding(texture2))
+		return texture;
+
+	const bool hasAlpha = ktxTexture2_GetNumComponents(texture2) == 2 || ktxTexture2_GetNumComponents(texture2) == 4;
+	if (const KTX_error_code result = ktxTexture2_TranscodeBasis(texture2, ChooseTranscodeFormat(supportedCompression, hasAlpha), 0); result != KTX_error_code::KTX_SUCCESS)
+	{
+		ktxTexture_Destroy(texture);
+		throw std::runtime_error("Failed to transcode " + filePath + ": " + ktxErrorString(result));
+	}
+
+	return texture;
+}
+
+ktx_transcode_fmt_e TextureImporter::ChooseTranscodeFormat(const uint32_t& supportedCompression, const bool& hasAlpha)
+{
+	// Desktop families first, BC1 and ETC1 halve the size of opaque textures
+	if (supportedCompression & FHE_TEXTURE_COMPRESSION_BC)
+		return hasAlpha ? KTX_TTF_BC7_RGBA : KTX_TTF_BC1_RGB;
+	if (supportedCompression & FHE_TEXTURE_COMPRESSION_ASTC)
+		return KTX_TTF_ASTC_4x4_RGBA;
+	if (supportedCompression & FHE_TEXTURE_COMPRESSION_ETC2)
+		return hasAlpha ? KTX_TTF_ETC2_RGBA : KTX_TTF_ETC1_RGB;
+
+	// Software rasterizers like lavapipe sample no block-compressed format at all
+	return KTX_TTF_RGBA32;
+}
@@ -0,0 +1,22 @@
+#ifndef RENDERER_TEXTUREIMPORTER_H_
+#define RENDERER_TEXTUREIMPORTER_H_
+
+#include <cstdint>
+#include <string>
+
+#include <ktx.h>
+
+#include "FHETextureCompression.h"
+
+class TextureImporter
+{
+public:
+	// Reads the KTX2 file next to filePath, or the KTX file when there is none, whatever the extension of filePath.
+	// Basis Universal payloads are transcoded to the best family in supportedCompression, to RGBA8 without any.
+	// The caller owns the texture and releases it with ktxTexture_Destroy.
+	[[nodiscard]] static ktxTexture* Load(std::string filePath, const uint32_t& supportedCompression);
+
+	[[nodiscard]] static ktx_transcode_fmt_e ChooseTranscodeFormat(const uint32_t& supportedCompression, const bool& hasAlpha);
+};
+
+#endif
@@ -0,0 +1,21 @@
+#ifndef RENDERER_TEXTURERESIDENCYCHANGE_H_
+#define RENDERER_TEXTURERESIDENCYCHANGE_H_
+
+#include <cstdint>
+
+#include <vulkan/vulkan.h>
+
+#include "FHEImage.h"
+
+// A texture being reallocated with more or fewer resident levels. The replacement is swapped into target once the upload timeline reaches uploadValue.
+struct TextureResidencyChange
+{
+	FHEImage* target = nullptr;
+	FHEImage replacement{};
+	uint32_t residentLevel = 0;
+	VkDeviceSize residentSize = 0;
+
+	uint64_t uploadValue = 0;
+};
+
+#endif
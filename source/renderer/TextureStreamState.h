@@ -0,0 +1,24 @@
+#ifndef RENDERER_TEXTURESTREAMSTATE_H_
+#define RENDERER_TEXTURESTREAMSTATE_H_
+
+#include <cstdint>
+
+#include <ktx.h>
+#include <vulkan/vulkan.h>
+
+// Mip residency of a texture whose file stores a full chain. The image only holds the file levels from residentLevel down, file level residentLevel being mip 0 of the image.
+struct TextureStreamState
+{
+	// Decoded file kept on the host, finer levels are uploaded from it on demand
+	ktxTexture* source = nullptr;
+	uint32_t residentLevel = 0;
+	// Finest level the current view needs, from the screen-space estimate
+	uint32_t desiredLevel = 0;
+	VkDeviceSize residentSize = 0;
+	// Last frame a model using the texture was in view, the least recently used textures are evicted first
+	uint64_t lastUsedFrame = 0;
+	// Set while a residency change of this texture is in flight
+	bool changing = false;
+};
+
+#endif
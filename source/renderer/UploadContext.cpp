@@ -0,0 +1,131 @@
+#include "UploadContext.h"
+
+#include <stdexcept>
+
+UploadContext::UploadContext(const VkDevice& device, const VkQueue& queue, const uint32_t& queueFamily)
+{
+	_device = device;
+	_queue = queue;
+	_submittedValue = 0;
+	_recording = nullptr;
+
+	VkCommandPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT | VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+	poolInfo.queueFamilyIndex = queueFamily;
+	if (vkCreateCommandPool(_device, &poolInfo, nullptr, &_commandPool) != VK_SUCCESS)
+		throw std::runtime_error("Failed to create the upload command pool!");
+
+	VkSemaphoreTypeCreateInfo timelineInfo{};
+	timelineInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+	timelineInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+	timelineInfo.initialValue = 0;
+
+	VkSemaphoreCreateInfo semaphoreInfo{};
+	semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+	semaphoreInfo.pNext = &timelineInfo;
+	if (vkCreateSemaphore(_device, &semaphoreInfo, nullptr, &_timeline) != VK_SUCCESS)
+		throw std::runtime_error("Failed to create the upload timeline semaphore!");
+}
+
+UploadContext::~UploadContext()
+{
+	// Destroying the pool frees every command buffer allocated from it
+	vkDestroyCommandPool(_device, _commandPool, nullptr);
+	vkDestroySemaphore(_device, _timeline, nullptr);
+}
+
+VkCommandBuffer UploadContext::GetCommandBuffer()
+{
+	if (_recording != nullptr)
+		return _recording;
+
+	if (!_submitted.empty() && _submitted.front().first <= GetCompletedValue())
+	{
+		_recording = _submitted.front().second;
+		_submitted.pop_front();
+		vkResetCommandBuffer(_recording, 0);
+	}
+	else
+	{
+		VkCommandBufferAllocateInfo allocInfo{};
+		allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+		allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+		allocInfo.commandPool = _commandPool;
+		allocInfo.commandBufferCount = 1;
+		if (vkAllocateCommandBuffers(_device, &allocInfo, &_recording) != VK_SUCCESS)
+			throw std::runtime_error("Failed to allocate an upload command buffer!");
+	}
+
+	VkCommandBufferBeginInfo beginInfo{};
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+	vkBeginCommandBuffer(_recording, &beginInfo);
+
+	return _recording;
+}
+
+uint64_t UploadContext::Submit()
+{
+	if (_recording == nullptr)
+		return _submittedValue;
+
+	if (vkEndCommandBuffer(_recording) != VK_SUCCESS)
+		throw std::runtime_error("Failed to record upload command buffer!");
+
+	const uint64_t value = _submittedValue + 1;
+	VkTimelineSemaphoreSubmitInfo timelineInfo{};
+	timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+	timelineInfo.signalSemaphoreValueCount = 1;
+	timelineInfo.pSignalSemaphoreValues = &value;
+
+	VkSubmitInfo submitInfo{};
+	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submitInfo.pNext = &timelineInfo;
+	submitInfo.commandBufferCount = 1;
+	submitInfo.pCommandBuffers = &_recording;
+	submitInfo.signalSemaphoreCount = 1;
+	submitInfo.pSignalSemaphores = &_timeline;
+	if (vkQueueSubmit(_queue, 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS)
+		throw std::runtime_error("Failed to submit uploads!");
+
+	_submitted.emplace_back(value, _recording);
+	_recording = nullptr;
+	_submittedValue = value;
+	return value;
+}
+
+void UploadContext::Wait(const uint64_t& value) const
+{
+	if (value == 0)
+		return;
+
+	VkSemaphoreWaitInfo waitInfo{};
+	waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+	waitInfo.semaphoreCount = 1;
+	waitInfo.pSemaphores = &_timeline;
+	waitInfo.pValues = &value;
+	vkWaitSemaphores(_device, &waitInfo, UINT64_MAX);
+}
+
+uint64_t UploadContext::GetRecordingValue() const
+{
+	return _submittedValue + 1;
+}
+
+uint64_t UploadContext::GetSubmittedValue() const
+{
+	return _submittedValue;
+}
+
+uint64_t UploadContext::GetCompletedValue() const
+{
+	uint64_t completedValue;
+	vkGetSemaphoreCounterValue(_device, _timeline, &completedValue);
+	return completedValue;
+}
+
+VkSemaphore UploadContext::GetTimeline() const
+{
+	return _timeline;
+}
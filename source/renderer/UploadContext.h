@@ -0,0 +1,46 @@
+#ifndef RENDERER_UPLOADCONTEXT_H_
+#define RENDERER_UPLOADCONTEXT_H_
+
+#include <cstdint>
+#include <deque>
+#include <utility>
+
+#include <vulkan/vulkan.h>
+
+// Batches one-time commands (copies, layout transitions, blits) into a single command buffer that is submitted once
+// and signals a timeline semaphore. Callers that need the results wait on the value Submit returned instead of the queue.
+class UploadContext
+{
+public:
+	UploadContext(const VkDevice& device, const VkQueue& queue, const uint32_t& queueFamily);
+	// The device must be idle
+	~UploadContext();
+
+	UploadContext(const UploadContext&) = delete;
+	UploadContext& operator=(const UploadContext&) = delete;
+
+	// The command buffer of the open batch, begun on first use. It stays the same until Submit.
+	[[nodiscard]] VkCommandBuffer GetCommandBuffer();
+	// Submits the open batch and returns the timeline value it signals. Without an open batch this is the value of the last submission.
+	[[nodiscard]] uint64_t Submit();
+	void Wait(const uint64_t& value) const;
+
+	// Value the open batch will signal once submitted
+	[[nodiscard]] uint64_t GetRecordingValue() const;
+	[[nodiscard]] uint64_t GetSubmittedValue() const;
+	[[nodiscard]] uint64_t GetCompletedValue() const;
+	[[nodiscard]] VkSemaphore GetTimeline() const;
+
+private:
+	VkDevice _device;
+	VkQueue _queue;
+	VkCommandPool _commandPool;
+	VkSemaphore _timeline;
+	uint64_t _submittedValue;
+
+	VkCommandBuffer _recording;
+	// Submitted command buffers, reset and reused once the timeline reached their value
+	std::deque<std::pair<uint64_t, VkCommandBuffer>> _submitted;
+};
+
+#endif
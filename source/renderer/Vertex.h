@@ -4,50 +4,16 @@
 #include <glm/glm.hpp>
 #define GLM_ENABLE_EXPERIMENTAL
 #include <glm/gtx/hash.hpp>
-#include <vulkan/vulkan.h>
-#include <array>
 
+// Full-precision vertex the importer and optimizer work on. What reaches the GPU is packed from this by VertexLayout.
 struct Vertex
 {
 	glm::vec3 position;
-	glm::vec3 color;
 	glm::vec2 texCoord;
 
 	bool operator==(const Vertex& other) const
 	{
-		return position == other.position && color == other.color && texCoord == other.texCoord;
-	}
-
-	static VkVertexInputBindingDescription GetBindingDescription()
-	{
-		VkVertexInputBindingDescription bindingDescription{};
-		bindingDescription.binding = 0;
-		bindingDescription.stride = sizeof(Vertex);
-		bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
-
-		return bindingDescription;
-	}
-
-	static std::array<VkVertexInputAttributeDescription, 3> GetAttributeDescription()
-	{
-		std::array<VkVertexInputAttributeDescription, 3> attributeDescriptions{};
-
-		attributeDescriptions[0].binding = 0;
-		attributeDescriptions[0].location = 0;
-		attributeDescriptions[0].format = VK_FORMAT_R32G32B32_SFLOAT;
-		attributeDescriptions[0].offset = offsetof(Vertex, position);
-
-		attributeDescriptions[1].binding = 0;
-		attributeDescriptions[1].location = 1;
-		attributeDescriptions[1].format = VK_FORMAT_R32G32B32_SFLOAT;
-		attributeDescriptions[1].offset = offsetof(Vertex, color);
-
-		attributeDescriptions[2].binding = 0;
-		attributeDescriptions[2].location = 2;
-		attributeDescriptions[2].format = VK_FORMAT_R32G32_SFLOAT;
-		attributeDescriptions[2].offset = offsetof(Vertex, texCoord);
-
-		return attributeDescriptions;
+		return position == other.position && texCoord == other.texCoord;
 	}
 };
 
@@ -55,10 +21,9 @@ template<> struct std::hash<Vertex>
 {
 	size_t operator()(Vertex const& vertex) const noexcept
 	{
-		return ((std::hash<glm::vec3>()(vertex.position) ^
-			(std::hash<glm::vec3>()(vertex.color) << 1)) >> 1) ^
+		return (std::hash<glm::vec3>()(vertex.position) >> 1) ^
 			(std::hash<glm::vec2>()(vertex.texCoord) << 1);
 	}
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,183 @@
+#include "VertexLayout.h"
+
+#include <cstring>
+#include <stdexcept>
+
+#include <glm/gtc/packing.hpp>
+
+uint32_t VertexLayout::GetStride(const FHEVertexLayout& layout)
+{
+	switch (layout)
+	{
+	case FHE_VERTEX_LAYOUT_FLOAT32:
+		return sizeof(Vertex);
+	case FHE_VERTEX_LAYOUT_SNORM16:
+		return sizeof(PackedSnorm16);
+	default:
+		throw std::runtime_error("Unknown vertex layout!");
+	}
+}
+
+VkVertexInputBindingDescription VertexLayout::GetBindingDescription(const FHEVertexLayout& layout)
+{
+	VkVertexInputBindingDescription bindingDescription{};
+	bindingDescription.binding = 0;
+	bindingDescription.stride = GetStride(layout);
+	bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+
+	return bindingDescription;
+}
+
+std::array<VkVertexInputAttributeDescription, 2> VertexLayout::GetAttributeDescriptions(const FHEVertexLayout& layout)
+{
+	std::array<VkVertexInputAttributeDescription, 2> attributeDescriptions{};
+
+	attributeDescriptions[0].binding = 0;
+	attributeDescriptions[0].location = 0;
+	attributeDescriptions[1].binding = 0;
+	attributeDescriptions[1].location = 1;
+
+	// Three-component 16-bit formats are rarely supported for vertex fetch, so 16-bit positions are padded to four.
+	// Every format used here is in the mandatory VK_FORMAT_FEATURE_VERTEX_BUFFER_BIT set.
+	switch (layout)
+	{
+	case FHE_VERTEX_LAYOUT_FLOAT32:
+		attributeDescriptions[0].format = VK_FORMAT_R32G32B32_SFLOAT;
+		attributeDescriptions[0].offset = offsetof(Vertex, position);
+		attributeDescriptions[1].format = VK_FORMAT_R32G32_SFLOAT;
+		attributeDescriptions[1].offset = offsetof(Vertex, texCoord);
+		break;
+	case FHE_VERTEX_LAYOUT_SNORM16:
+		attributeDescriptions[0].format = VK_FORMAT_R16G16B16A16_SNORM;
+		attributeDescriptions[0].offset = offsetof(PackedSnorm16, position);
+		attributeDescriptions[1].format = VK_FORMAT_R16G16_UNORM;
+		attributeDescriptions[1].offset = offsetof(PackedSnorm16, texCoord);
+		break;
+	default:
+		throw std::runtime_error("Unknown vertex layout!");
+	}
+
+	return attributeDescriptions;
+}
+
+VertexLayout::Dequantization VertexLayout::GetDequantization(const FHEVertexLayout& layout, const glm::vec3& boundsMin, const glm::vec3& boundsMax, const glm::vec2& texCoordMin, const glm::vec2& texCoordMax)
+{
+	const glm::vec3 centre = (boundsMin + boundsMax) * 0.5f;
+	// Degenerate axes still need a non-zero scale so quantizing them does not divide by zero
+	const glm::vec3 halfExtent = glm::max((boundsMax - boundsMin) * 0.5f, glm::vec3(1e-20f));
+	const glm::vec2 texCoordExtent = glm::max(texCoordMax - texCoordMin, glm::vec2(1e-20f));
+
+	Dequantization dequantization{};
+	switch (layout)
+	{
+	case FHE_VERTEX_LAYOUT_FLOAT32:
+		dequantization.offset = glm::vec4(0.f);
+		dequantization.scale = glm::vec4(1.f);
+		dequantization.texCoordTransform = glm::vec4(0.f, 0.f, 1.f, 1.f);
+		break;
+	case FHE_VERTEX_LAYOUT_SNORM16:
+		dequantization.offset = glm::vec4(centre, 0.f);
+		dequantization.scale = glm::vec4(halfExtent, 1.f);
+		// Wrapping coordinates outside [0, 1] fit unorm as well once they are relative to their own range
+		dequantization.texCoordTransform = glm::vec4(texCoordMin, texCoordExtent);
+		break;
+	default:
+		throw std::runtime_error("Unknown vertex layout!");
+	}
+
+	return dequantization;
+}
+
+FHEVertexLayout VertexLayout::Choose(const std::vector<Vertex>& vertices, const glm::vec3& boundsMin, const glm::vec3& boundsMax, const glm::vec2& texCoordMin, const glm::vec2& texCoordMax, const float& positionTolerance, const float& texCoordTolerance)
+{
+	const float maxPositionError = glm::length(boundsMax - boundsMin) * positionTolerance;
+
+	// Ordered from the most compact layout. Rounding to 16 bits errs by at most 1 / 65534 of the half extent and 1 / 131070 of the
+	// texture coordinate range, so with the default tolerances only texture coordinates spanning more than about 8 fall back to floats.
+	const FHEVertexLayout candidates[] = { FHE_VERTEX_LAYOUT_SNORM16 };
+	for (const auto& layout : candidates)
+	{
+		std::vector<uint8_t> packed;
+		Pack(layout, vertices, boundsMin, boundsMax, texCoordMin, texCoordMax, packed);
+
+		const Dequantization dequantization = GetDequantization(layout, boundsMin, boundsMax, texCoordMin, texCoordMax);
+		const uint32_t stride = GetStride(layout);
+		bool withinTolerance = true;
+		for (size_t i = 0; i < vertices.size() && withinTolerance; ++i)
+		{
+			const Vertex unpacked = Unpack(layout, packed.data() + i * stride, dequantization);
+			const glm::vec3 positionError = glm::abs(unpacked.position - vertices[i].position);
+			const glm::vec2 texCoordError = glm::abs(unpacked.texCoord - vertices[i].texCoord);
+			withinTolerance = glm::all(glm::lessThanEqual(positionError, glm::vec3(maxPositionError))) &&
+				glm::all(glm::lessThanEqual(texCoordError, glm::vec2(texCoordTolerance)));
+		}
+
+		if (withinTolerance)
+			return layout;
+	}
+
+	return FHE_VERTEX_LAYOUT_FLOAT32;
+}
+
+void VertexLayout::Pack(const FHEVertexLayout& layout, const std::vector<Vertex>& vertices, const glm::vec3& boundsMin, const glm::vec3& boundsMax, const glm::vec2& texCoordMin, const glm::vec2& texCoordMax, std::vector<uint8_t>& output)
+{
+	const uint32_t stride = GetStride(layout);
+	const Dequantization dequantization = GetDequantization(layout, boundsMin, boundsMax, texCoordMin, texCoordMax);
+	const glm::vec3 offset = glm::vec3(dequantization.offset);
+	const glm::vec3 inverseScale = 1.f / glm::vec3(dequantization.scale);
+	const glm::vec2 texCoordOffset = glm::vec2(dequantization.texCoordTransform);
+	const glm::vec2 texCoordInverseScale = 1.f / glm::vec2(dequantization.texCoordTransform.z, dequantization.texCoordTransform.w);
+
+	output.resize(vertices.size() * stride);
+	for (size_t i = 0; i < vertices.size(); ++i)
+	{
+		uint8_t* destination = output.data() + i * stride;
+		const glm::vec3 position = (vertices[i].position - offset) * inverseScale;
+		const glm::vec2 texCoord = (vertices[i].texCoord - texCoordOffset) * texCoordInverseScale;
+		switch (layout)
+		{
+		case FHE_VERTEX_LAYOUT_FLOAT32:
+			memcpy(destination, &vertices[i], sizeof(Vertex));
+			break;
+		case FHE_VERTEX_LAYOUT_SNORM16:
+		{
+			PackedSnorm16 packed{};
+			for (glm::length_t axis = 0; axis < 3; ++axis)
+				packed.position[axis] = static_cast<int16_t>(glm::packSnorm1x16(position[axis]));
+			packed.texCoord[0] = glm::packUnorm1x16(texCoord.x);
+			packed.texCoord[1] = glm::packUnorm1x16(texCoord.y);
+			memcpy(destination, &packed, sizeof(PackedSnorm16));
+			break;
+		}
+		default:
+			throw std::runtime_error("Unknown vertex layout!");
+		}
+	}
+}
+
+Vertex VertexLayout::Unpack(const FHEVertexLayout& layout, const uint8_t* packedVertex, const Dequantization& dequantization)
+{
+	Vertex vertex{};
+	glm::vec3 position{};
+	switch (layout)
+	{
+	case FHE_VERTEX_LAYOUT_FLOAT32:
+		memcpy(&vertex, packedVertex, sizeof(Vertex));
+		return vertex;
+	case FHE_VERTEX_LAYOUT_SNORM16:
+	{
+		PackedSnorm16 packed{};
+		memcpy(&packed, packedVertex, sizeof(PackedSnorm16));
+		for (glm::length_t axis = 0; axis < 3; ++axis)
+			position[axis] = glm::unpackSnorm1x16(static_cast<uint16_t>(packed.position[axis]));
+		vertex.texCoord = { glm::unpackUnorm1x16(packed.texCoord[0]), glm::unpackUnorm1x16(packed.texCoord[1]) };
+		break;
+	}
+	default:
+		throw std::runtime_error("Unknown vertex layout!");
+	}
+
+	vertex.position = glm::vec3(dequantization.offset) + position * glm::vec3(dequantization.scale);
+	vertex.texCoord = glm::vec2(dequantization.texCoordTransform) + vertex.texCoord * glm::vec2(dequantization.texCoordTransform.z, dequantization.texCoordTransform.w);
+	return vertex;
+}
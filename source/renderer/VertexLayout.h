@@ -0,0 +1,53 @@
+#ifndef RENDERER_VERTEXLAYOUT_H_
+#define RENDERER_VERTEXLAYOUT_H_
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <vulkan/vulkan.h>
+
+#include "FHEVertexLayout.h"
+#include "Vertex.h"
+
+// Describes and produces the packed vertex buffer encodings. Every layout feeds the same vertex shader inputs,
+// the fixed-function fetch converts the formats to floats and the Dequantization in each draw's DrawData restores object space and texture coordinates.
+class VertexLayout
+{
+public:
+	// Layout shared with DrawData in shader.vert: position = offset + fetchedPosition * scale,
+	// texCoord = texCoordTransform.xy + fetchedTexCoord * texCoordTransform.zw
+	struct Dequantization
+	{
+		glm::vec4 offset;
+		glm::vec4 scale;
+		glm::vec4 texCoordTransform;
+	};
+
+	[[nodiscard]] static uint32_t GetStride(const FHEVertexLayout& layout);
+	[[nodiscard]] static VkVertexInputBindingDescription GetBindingDescription(const FHEVertexLayout& layout);
+	[[nodiscard]] static std::array<VkVertexInputAttributeDescription, 2> GetAttributeDescriptions(const FHEVertexLayout& layout);
+	[[nodiscard]] static Dequantization GetDequantization(const FHEVertexLayout& layout, const glm::vec3& boundsMin, const glm::vec3& boundsMax, const glm::vec2& texCoordMin, const glm::vec2& texCoordMax);
+
+	// Picks the most compact layout whose round trip stays within the tolerances. positionTolerance is a fraction
+	// of the bounds diagonal, texCoordTolerance is in texture coordinate units.
+	[[nodiscard]] static FHEVertexLayout Choose(const std::vector<Vertex>& vertices, const glm::vec3& boundsMin, const glm::vec3& boundsMax, const glm::vec2& texCoordMin, const glm::vec2& texCoordMax,
+		const float& positionTolerance = POSITION_TOLERANCE, const float& texCoordTolerance = TEXCOORD_TOLERANCE);
+	static void Pack(const FHEVertexLayout& layout, const std::vector<Vertex>& vertices, const glm::vec3& boundsMin, const glm::vec3& boundsMax, const glm::vec2& texCoordMin, const glm::vec2& texCoordMax, std::vector<uint8_t>& output);
+	[[nodiscard]] static Vertex Unpack(const FHEVertexLayout& layout, const uint8_t* packedVertex, const Dequantization& dequantization);
+
+#pragma region Compile-Time Static Members
+	constexpr static float POSITION_TOLERANCE = 1.f / 16384.f;
+	constexpr static float TEXCOORD_TOLERANCE = 1.f / 16384.f;
+#pragma endregion Compile-Time Static Members
+
+private:
+	struct PackedSnorm16
+	{
+		int16_t position[4];
+		uint16_t texCoord[2];
+	};
+};
+
+#endif
@@ -0,0 +1,95 @@
+#include "VertexWelder.h"
+
+#include <cstring>
+
+static_assert(sizeof(Vertex) % sizeof(uint32_t) == 0, "Vertex must be made of whole 32-bit words to be hashed by its bytes");
+
+VertexWelder::VertexWelder(const size_t& expectedVertexCount)
+{
+	size_t capacity = 16;
+	while (capacity * MAX_LOAD_NUMERATOR < expectedVertexCount * MAX_LOAD_DENOMINATOR)
+		capacity <<= 1;
+
+	_slots.assign(capacity, Slot{ EMPTY_SLOT, 0 });
+	_slotMask = capacity - 1;
+	_vertices.reserve(expectedVertexCount);
+}
+
+uint32_t VertexWelder::Insert(const Vertex& vertex)
+{
+	if ((_vertices.size() + 1) * MAX_LOAD_DENOMINATOR > _slots.size() * MAX_LOAD_NUMERATOR)
+		Grow();
+
+	const uint64_t hash = Hash(vertex);
+	const uint32_t hashTag = static_cast<uint32_t>(hash >> 32);
+	size_t slotIndex = static_cast<size_t>(hash) & _slotMask;
+	while (true)
+	{
+		Slot& slot = _slots[slotIndex];
+		if (slot.vertexIndex == EMPTY_SLOT)
+		{
+			slot.vertexIndex = static_cast<uint32_t>(_vertices.size());
+			slot.hashTag = hashTag;
+			_vertices.push_back(vertex);
+			return slot.vertexIndex;
+		}
+		if (slot.hashTag == hashTag && memcmp(&_vertices[slot.vertexIndex], &vertex, sizeof(Vertex)) == 0)
+			return slot.vertexIndex;
+
+		slotIndex = (slotIndex + 1) & _slotMask;
+	}
+}
+
+const std::vector<Vertex>& VertexWelder::GetVertices() const
+{
+	return _vertices;
+}
+
+std::vector<Vertex>& VertexWelder::GetVertices()
+{
+	return _vertices;
+}
+
+uint64_t VertexWelder::Hash(const Vertex& vertex)
+{
+	uint32_t words[sizeof(Vertex) / sizeof(uint32_t)];
+	memcpy(words, &vertex, sizeof(Vertex));
+
+	// Multiply-xorshift over every 32-bit word, finished with the splitmix64 avalanche so that the
+	// low bits used for the slot index depend on every input bit
+	uint64_t hash = 0x9E3779B97F4A7C15ull ^ sizeof(Vertex);
+	for (const uint32_t& word : words)
+	{
+		hash ^= word;
+		hash *= 0xBF58476D1CE4E5B9ull;
+		hash ^= hash >> 31;
+	}
+
+	hash ^= hash >> 30;
+	hash *= 0xBF58476D1CE4E5B9ull;
+	hash ^= hash >> 27;
+	hash *= 0x94D049BB133111EBull;
+	hash ^= hash >> 31;
+
+	return hash;
+}
+
+void VertexWelder::Grow()
+{
+	std::vector<Slot> oldSlots;
+	oldSlots.swap(_slots);
+
+	_slots.assign(oldSlots.size() * 2, Slot{ EMPTY_SLOT, 0 });
+	_slotMask = _slots.size() - 1;
+
+	for (const auto& oldSlot : oldSlots)
+	{
+		if (oldSlot.vertexIndex == EMPTY_SLOT)
+			continue;
+
+		size_t slotIndex = static_cast<size_t>(Hash(_vertices[oldSlot.vertexIndex])) & _slotMask;
+		while (_slots[slotIndex].vertexIndex != EMPTY_SLOT)
+			slotIndex = (slotIndex + 1) & _slotMask;
+		_slots[slotIndex] = oldSlot;
+	}
+}
@@ -0,0 +1,46 @@
+#ifndef RENDERER_VERTEXWELDER_H_
+#define RENDERER_VERTEXWELDER_H_
+
+#include <cstdint>
+#include <vector>
+
+#include "Vertex.h"
+
+// Deduplicates vertices by their packed bytes using a flat open-addressing table.
+// Each slot holds an index into the welded vertex array plus the 32 high bits of its hash, so
+// most probes are rejected without touching the vertex data and there is exactly one lookup per insert.
+class VertexWelder
+{
+public:
+	explicit VertexWelder(const size_t& expectedVertexCount);
+
+	// Returns the welded index of vertex, appending it to the vertex array if it has not been seen before
+	uint32_t Insert(const Vertex& vertex);
+
+	[[nodiscard]] const std::vector<Vertex>& GetVertices() const;
+	[[nodiscard]] std::vector<Vertex>& GetVertices();
+
+	[[nodiscard]] static uint64_t Hash(const Vertex& vertex);
+
+private:
+	struct Slot
+	{
+		uint32_t vertexIndex;
+		uint32_t hashTag;
+	};
+
+#pragma region Compile-Time Static Members
+	const static uint32_t EMPTY_SLOT = UINT32_MAX;
+	// Grow once the table is more than MAX_LOAD_NUMERATOR / MAX_LOAD_DENOMINATOR full
+	const static size_t MAX_LOAD_NUMERATOR = 1;
+	const static size_t MAX_LOAD_DENOMINATOR = 2;
+#pragma endregion Compile-Time Static Members
+
+	std::vector<Slot> _slots;
+	size_t _slotMask;
+	std::vector<Vertex> _vertices;
+
+	void Grow();
+};
+
+#endif
@@ -3,24 +3,30 @@
 
 #include <algorithm>
 #include <chrono>
+#include <cmath>
 #include <fstream>
 #include <iostream>
 #include <limits>
 #include <map>
+#include <numeric>
 #include <set>
 
+#include <ktxvulkan.h>
+
 #define GLM_FORCE_RADIANS
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 
+#include "Frustum.h"
+#include "MeshCache.h"
 #include "QueueFamilyIndices.h"
 #include "SwapChainSupportDetails.h"
-#define TINYOBJLOADER_IMPLEMENTATION
+#include "TextureImporter.h"
+#include "VertexLayout.h"
 #include <memory>
 #include <unordered_map>
 
-#include "tiny_obj_loader.h"
 #include "../input/InputManager.h"
 #include "../logger/Logger.h"
 
@@ -30,6 +36,18 @@ const std::vector<const char*> RenderLoop::VALIDATION_LAYERS = {
 const std::vector<const char*> RenderLoop::DEVICE_EXTENSIONS = {
 		VK_KHR_SWAPCHAIN_EXTENSION_NAME,
 };
+const std::array<MemoryBudget, FHE_MEMORY_CATEGORY_COUNT> RenderLoop::MEMORY_BUDGETS = { {
+		// Meshes
+		{ 0, 0 },
+		// Textures
+		{ 256ull * 1024 * 1024, 512ull * 1024 * 1024 },
+		// Attachments
+		{ 0, 0 },
+		// Staging
+		{ 0, 256ull * 1024 * 1024 },
+		// Other
+		{ 0, 0 },
+	} };
 const std::string RenderLoop::SHADER_PATH = "shaders";
 const std::string RenderLoop::MODEL_PATH = "models/trout_rainbow.obj";
 const std::string RenderLoop::TEXTURE_PATH = "textures/trout_rainbow.png";
@@ -73,6 +91,14 @@ RenderLoop::RenderLoop(const std::string& windowName, const std::string& appName
 	_graphicsQueue = nullptr;
 	_presentationQueue = nullptr;
 	_transferQueue = nullptr;
+	_graphicsQueueFamily = 0;
+	_transferQueueFamily = 0;
+	_presentQueueFamily = 0;
+	_defaultSharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	_textureCompression = FHE_TEXTURE_COMPRESSION_NONE;
+	_maxSamplerAnisotropy = 1.f;
+	_maxMsaaSamples = DEFAULT_MAX_MSAA_SAMPLES;
+	_memoryBudgetSupported = false;
 
 	_swapChain = nullptr;
 	_swapChainImageFormat = {};
@@ -81,33 +107,94 @@ RenderLoop::RenderLoop(const std::string& windowName, const std::string& appName
 	_descriptorSetLayout = nullptr;
 	_descriptorPool = nullptr;
 
+	_earlyRenderPass = nullptr;
 	_renderPass = nullptr;
+	_singleRenderPass = nullptr;
 	_pipelineLayout = nullptr;
-	_graphicsPipeline = nullptr;
+	_graphicsPipelines.fill(nullptr);
+	_cullPipelineLayout = nullptr;
+	_cullPipeline = nullptr;
+	_animationPipelineLayout = nullptr;
+	_animationPipeline = nullptr;
 
 	_commandPool = nullptr;
 	_transferCommandPool = nullptr;
+	_presentCommandPool = nullptr;
 
 	_vertexBuffer = nullptr;
-	_vertexBufferMemory = nullptr;
+	_vertexBufferAllocation = {};
 	_indexBuffer = nullptr;
-	_indexBufferMemory = nullptr;
+	_indexBufferAllocation = {};
+
+	_jobSystem = std::make_unique<JobSystem>();
+	_recordingJobSystem = std::make_unique<JobSystem>();
+	_recordingSliceCount = 0;
+	_sceneRevision = 1;
+	_commandBufferCaching = true;
+	_recordingSliceLimit = 0;
+	_recordingTime = {};
+	_transferTimeline = nullptr;
+	_stagingRingBuffer = nullptr;
+	_stagingRingAllocation = {};
+	_transferTimelineValue = 0;
+	_frameTransferWaitValue = 0;
+	_textureSlotCount = 0;
+	_defaultTexture = {};
+	_frameNumber = 0;
 
-	_transformStagingData = nullptr;
 	_transformBufferSize = 0;
-	_transformStagingBuffer = nullptr;
-	_transformStagingBufferMemory = nullptr;
+	_transformRegionSize = 0;
 	_transformBuffer = nullptr;
-	_transformBufferMemory = nullptr;
+	_transformBufferAllocation = {};
+	_animationBuffer = nullptr;
+	_animationBufferAllocation = {};
+	_animationClockRegionSize = 0;
+	_animationClockBuffer = nullptr;
+	_animationClockBufferAllocation = {};
+
+	_drawStagingData = nullptr;
+	_drawRegionSize = 0;
+	_drawCommandOffset = 0;
+	_lateDrawCommandOffset = 0;
+	_drawDataOffset = 0;
+	_drawStagingBuffer = nullptr;
+	_drawStagingBufferAllocation = {};
+	_drawBuffer = nullptr;
+	_drawBufferAllocation = {};
+	_visibleInstanceRegionSize = 0;
+	_visibleInstanceBuffer = nullptr;
+	_visibleInstanceBufferAllocation = {};
+	_instanceCount = 0;
+	_instanceVisibilityBuffer = nullptr;
+	_instanceVisibilityBufferAllocation = {};
+	_cullStatisticsRegionSize = 0;
+	_cullStatisticsBuffer = nullptr;
+	_cullStatisticsBufferAllocation = {};
+	_cullStatistics = {};
+	_occlusionCulling = true;
 
 	_depthImage = nullptr;
-	_depthImageMemory = nullptr;
+	_depthImageAllocation = {};
 	_depthImageView = nullptr;
 
 	_colorImage = nullptr;
-	_colorImageMemory = nullptr;
+	_colorImageAllocation = {};
 	_colorImageView = nullptr;
 
+	_depthResolveImage = nullptr;
+	_depthResolveImageAllocation = {};
+	_depthResolveImageView = nullptr;
+
+	_depthPyramid = nullptr;
+	_depthPyramidAllocation = {};
+	_depthPyramidView = nullptr;
+	_depthPyramidExtent = {};
+	_depthPyramidSampler = nullptr;
+	_depthPyramidSetLayout = nullptr;
+	_depthPyramidDescriptorPool = nullptr;
+	_depthPyramidPipelineLayout = nullptr;
+	_depthPyramidPipeline = nullptr;
+
 	_debugMessenger = nullptr;
 
 	_deltaTime = std::chrono::duration<float, std::chrono::seconds::period>(0);
@@ -130,6 +217,180 @@ void RenderLoop::Run()
 	Cleanup();
 }
 
+void RenderLoop::SetMaxMsaaSamples(const uint32_t& sampleCount)
+{
+	if (sampleCount == 0 || sampleCount > VK_SAMPLE_COUNT_64_BIT || (sampleCount & (sampleCount - 1)) != 0)
+		throw std::invalid_argument("MSAA sample count must be a power of two between 1 and 64!");
+
+	_maxMsaaSamples = static_cast<VkSampleCountFlagBits>(sampleCount);
+}
+
+void RenderLoop::BenchmarkSharingModes(const std::string& windowName, const std::string& appName, const uint32_t& frameCount)
+{
+	using Clock = std::chrono::steady_clock;
+	using Milliseconds = std::chrono::duration<float, std::milli>;
+
+	printf("Sharing mode benchmark: %u frames after %u warm-up frames\n", frameCount, BENCHMARK_WARMUP_FRAMES);
+
+	const std::array<VkSharingMode, 2> sharingModes = { VK_SHARING_MODE_CONCURRENT, VK_SHARING_MODE_EXCLUSIVE };
+	std::array<float, 2> frameTimes{};
+	for (size_t i = 0; i < sharingModes.size(); ++i)
+	{
+		RenderLoop renderLoop(windowName, appName);
+		renderLoop._defaultSharingMode = sharingModes[i];
+		renderLoop.InitWindow();
+		renderLoop.InitVulkan();
+
+		auto startTime = Clock::now();
+		uint32_t frame = 0;
+		for (; frame < BENCHMARK_WARMUP_FRAMES + frameCount && !glfwWindowShouldClose(renderLoop._window); ++frame)
+		{
+			if (frame == BENCHMARK_WARMUP_FRAMES)
+			{
+				vkDeviceWaitIdle(renderLoop._device);
+				startTime = Clock::now();
+			}
+			glfwPollEvents();
+			renderLoop.DrawFrame();
+		}
+		vkDeviceWaitIdle(renderLoop._device);
+		const Milliseconds elapsed = Clock::now() - startTime;
+		const uint32_t timedFrames = frame > BENCHMARK_WARMUP_FRAMES ? frame - BENCHMARK_WARMUP_FRAMES : 0;
+		frameTimes[i] = timedFrames > 0 ? elapsed.count() / static_cast<float>(timedFrames) : 0.f;
+
+		renderLoop.StopStreaming();
+		renderLoop.Cleanup();
+
+		printf("  %s: %8.3fms per frame over %u frames%s\n", sharingModes[i] == VK_SHARING_MODE_CONCURRENT ? "concurrent" : "exclusive ",
+			frameTimes[i], timedFrames, renderLoop._graphicsQueueFamily != renderLoop._presentQueueFamily ? " (separate present family)" : "");
+	}
+
+	if (frameTimes[0] > 0.f && frameTimes[1] > 0.f)
+		printf("  exclusive is %5.2fx the speed of concurrent\n", frameTimes[0] / frameTimes[1]);
+}
+
+void RenderLoop::BenchmarkRecording(const std::string& windowName, const std::string& appName, const uint32_t& frameCount)
+{
+	printf("Recording benchmark: %u frames per thread count after %u warm-up frames\n", frameCount, BENCHMARK_WARMUP_FRAMES);
+
+	RenderLoop renderLoop(windowName, appName);
+	renderLoop.InitWindow();
+	renderLoop.InitVulkan();
+
+	// Streaming has to settle first, otherwise later thread counts would record more draws than earlier ones
+	for (uint32_t frame = 0; frame < BENCHMARK_WARMUP_FRAMES && !glfwWindowShouldClose(renderLoop._window); ++frame)
+	{
+		glfwPollEvents();
+		renderLoop.DrawFrame();
+	}
+
+	std::vector<uint32_t> threadCounts;
+	for (uint32_t threadCount = 1; threadCount < renderLoop._recordingSliceCount; threadCount *= 2)
+		threadCounts.push_back(threadCount);
+	threadCounts.push_back(renderLoop._recordingSliceCount);
+
+	// Recording every frame, as the cache would otherwise hide it
+	renderLoop._commandBufferCaching = false;
+	float singleThreadTime = 0.f;
+	for (const uint32_t& threadCount : threadCounts)
+	{
+		renderLoop._recordingSliceLimit = threadCount;
+		renderLoop._recordingTime = {};
+		uint32_t frame = 0;
+		for (; frame < frameCount && !glfwWindowShouldClose(renderLoop._window); ++frame)
+		{
+			glfwPollEvents();
+			renderLoop.DrawFrame();
+		}
+
+		const float recordingTime = frame > 0 ? renderLoop._recordingTime.count() / static_cast<float>(frame) : 0.f;
+		if (threadCount == threadCounts.front())
+			singleThreadTime = recordingTime;
+		printf("  %3u thread(s): %8.3fms recording per frame, %5.2fx vs 1 thread\n", threadCount, recordingTime, recordingTime > 0.f ? singleThreadTime / recordingTime : 0.f);
+	}
+
+	renderLoop._commandBufferCaching = true;
+	renderLoop._recordingSliceLimit = 0;
+	// Slots recorded with another slice count laid their draw records out differently
+	++renderLoop._sceneRevision;
+	renderLoop._recordingTime = {};
+	uint32_t cachedFrames = 0;
+	for (; cachedFrames < frameCount && !glfwWindowShouldClose(renderLoop._window); ++cachedFrames)
+	{
+		glfwPollEvents();
+		renderLoop.DrawFrame();
+	}
+	const float cachedTime = cachedFrames > 0 ? renderLoop._recordingTime.count() / static_cast<float>(cachedFrames) : 0.f;
+	printf("  cached:        %8.3fms recording per frame\n", cachedTime);
+
+	vkDeviceWaitIdle(renderLoop._device);
+	renderLoop.StopStreaming();
+	renderLoop.Cleanup();
+}
+
+void RenderLoop::BenchmarkOcclusionCulling(const std::string& windowName, const std::string& appName, const uint32_t& frameCount)
+{
+	using Clock = std::chrono::steady_clock;
+	using Milliseconds = std::chrono::duration<float, std::milli>;
+
+	printf("Occlusion culling benchmark: %u frames per mode after %u warm-up frames\n", frameCount, BENCHMARK_WARMUP_FRAMES);
+
+	RenderLoop renderLoop(windowName, appName);
+	renderLoop.InitWindow();
+	renderLoop.InitVulkan();
+
+	// Level with the school and looking down its rows, so every fish hides most of the ones behind it
+	const float schoolCenterX = -static_cast<float>(FISH_DEPTH_COUNT - 1);
+	const float schoolEndZ = 2.f * static_cast<float>(FISH_WIDTH_COUNT - 1);
+	renderLoop._camera.view = lookAt(glm::vec3(schoolCenterX, 0.5f, -3.f), glm::vec3(schoolCenterX, 0.f, schoolEndZ), glm::vec3(0.f, 1.f, 0.f));
+
+	const std::array<bool, 2> occlusionCulling = { false, true };
+	std::array<float, 2> frameTimes{};
+	for (size_t i = 0; i < occlusionCulling.size(); ++i)
+	{
+		renderLoop.SetOcclusionCulling(occlusionCulling[i]);
+
+		// Streaming settles during the first warm-up, later ones let the visibility of the new mode settle
+		auto startTime = Clock::now();
+		CullStatistics totals{};
+		uint32_t frame = 0;
+		for (; frame < BENCHMARK_WARMUP_FRAMES + frameCount && !glfwWindowShouldClose(renderLoop._window); ++frame)
+		{
+			if (frame == BENCHMARK_WARMUP_FRAMES)
+			{
+				vkDeviceWaitIdle(renderLoop._device);
+				startTime = Clock::now();
+			}
+			glfwPollEvents();
+			renderLoop.DrawFrame();
+			if (frame >= BENCHMARK_WARMUP_FRAMES)
+			{
+				totals.testedInstances += renderLoop._cullStatistics.testedInstances;
+				totals.frustumCulledInstances += renderLoop._cullStatistics.frustumCulledInstances;
+				totals.occlusionCulledInstances += renderLoop._cullStatistics.occlusionCulledInstances;
+				totals.earlyDrawnInstances += renderLoop._cullStatistics.earlyDrawnInstances;
+				totals.lateDrawnInstances += renderLoop._cullStatistics.lateDrawnInstances;
+			}
+		}
+		vkDeviceWaitIdle(renderLoop._device);
+		const Milliseconds elapsed = Clock::now() - startTime;
+		const uint32_t timedFrames = frame > BENCHMARK_WARMUP_FRAMES ? frame - BENCHMARK_WARMUP_FRAMES : 0;
+		frameTimes[i] = timedFrames > 0 ? elapsed.count() / static_cast<float>(timedFrames) : 0.f;
+
+		const float frames = static_cast<float>(std::max(1u, timedFrames));
+		printf("  %s: %8.3fms per frame over %u frames, per frame %.1f instances tested, %.1f frustum culled, %.1f occlusion culled, %.1f drawn early, %.1f drawn late\n",
+			occlusionCulling[i] ? "frustum + occlusion" : "frustum only       ", frameTimes[i], timedFrames,
+			static_cast<float>(totals.testedInstances) / frames, static_cast<float>(totals.frustumCulledInstances) / frames, static_cast<float>(totals.occlusionCulledInstances) / frames,
+			static_cast<float>(totals.earlyDrawnInstances) / frames, static_cast<float>(totals.lateDrawnInstances) / frames);
+	}
+
+	if (frameTimes[0] > 0.f && frameTimes[1] > 0.f)
+		printf("  occlusion culling saves %8.3fms per frame, %5.2fx the speed of frustum culling alone\n", frameTimes[0] - frameTimes[1], frameTimes[0] / frameTimes[1]);
+
+	renderLoop.StopStreaming();
+	renderLoop.Cleanup();
+}
+
 void RenderLoop::InitWindow()
 {
 	glfwInit();
@@ -154,25 +415,33 @@ void RenderLoop::InitVulkan()
 	SelectPhysicalDevice();
 	const QueueFamilyIndices queueFamilyIndices = FindQueueFamilies(_physicalDevice);
 	CreateLogicalDevice(queueFamilyIndices);
-	CreateSwapChain(queueFamilyIndices);
+	CreateSwapChain();
 	CreateImageViews();
 	CreateRenderPass();
 	CreateDescriptorSetLayout();
 	CreateGraphicsPipeline();
+	CreateCullPipeline();
+	CreateDepthPyramidPipeline();
+	CreateAnimationPipeline();
 	CreateCommandPool(queueFamilyIndices);
+	CreateStagingRing();
 	CreateDepthResources();
 	CreateColorResources();
+	CreateDepthResolveResources();
+	CreateDepthPyramid();
 	CreateFrameBuffers();
 	CreateTextures();
 	LoadModels();
 	SetupCamera();
-	CreateVertexBuffer();
-	CreateIndexBuffer();
+	CreateGeometryArena();
 	CreateTransformBuffer();
+	CreateDrawBuffer();
 	CreateUniformBuffers();
 	CreateDescriptorPool();
 	CreateDescriptorSets();
 	CreateCommandBuffers();
+	CreateRecordingCommandBuffers();
+	CreatePresentAcquireCommandBuffers();
 	CreateSyncObjects();
 }
 
@@ -274,17 +543,62 @@ void RenderLoop::CreateLogicalDevice(const QueueFamilyIndices& indices)
 		queueCreateInfos.push_back(queueCreateInfo);
 	}
 
+	VkPhysicalDeviceFeatures supportedFeatures;
+	vkGetPhysicalDeviceFeatures(_physicalDevice, &supportedFeatures);
+	_textureCompression = GetSupportedTextureCompression(supportedFeatures);
+
 	VkPhysicalDeviceFeatures deviceFeatures{};
 	deviceFeatures.samplerAnisotropy = VK_TRUE;
 	deviceFeatures.sampleRateShading = VK_TRUE;
+	// Indirect draws carry several records each and start at the model's first transform
+	deviceFeatures.multiDrawIndirect = VK_TRUE;
+	deviceFeatures.drawIndirectFirstInstance = VK_TRUE;
+	// Block-compressed formats may only be used with their feature enabled
+	deviceFeatures.textureCompressionBC = (_textureCompression & FHE_TEXTURE_COMPRESSION_BC) ? VK_TRUE : VK_FALSE;
+	deviceFeatures.textureCompressionASTC_LDR = (_textureCompression & FHE_TEXTURE_COMPRESSION_ASTC) ? VK_TRUE : VK_FALSE;
+	deviceFeatures.textureCompressionETC2 = (_textureCompression & FHE_TEXTURE_COMPRESSION_ETC2) ? VK_TRUE : VK_FALSE;
 
 	VkDeviceCreateInfo deviceCreateInfo{};
 	deviceCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
 	deviceCreateInfo.pQueueCreateInfos = queueCreateInfos.data();
 	deviceCreateInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());
 	deviceCreateInfo.pEnabledFeatures = &deviceFeatures;
-	deviceCreateInfo.enabledExtensionCount = static_cast<uint32_t>(DEVICE_EXTENSIONS.size());
-	deviceCreateInfo.ppEnabledExtensionNames = DEVICE_EXTENSIONS.data();
+	// Heap budgets are optional, without them the allocator estimates from its own reservations
+	std::vector<const char*> deviceExtensions = DEVICE_EXTENSIONS;
+	uint32_t extensionCount;
+	vkEnumerateDeviceExtensionProperties(_physicalDevice, nullptr, &extensionCount, nullptr);
+	std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+	vkEnumerateDeviceExtensionProperties(_physicalDevice, nullptr, &extensionCount, availableExtensions.data());
+	for (const auto& extension : availableExtensions)
+	{
+		if (std::string(extension.extensionName) == VK_EXT_MEMORY_BUDGET_EXTENSION_NAME)
+		{
+			deviceExtensions.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+			_memoryBudgetSupported = true;
+		}
+	}
+
+	deviceCreateInfo.enabledExtensionCount = static_cast<uint32_t>(deviceExtensions.size());
+	deviceCreateInfo.ppEnabledExtensionNames = deviceExtensions.data();
+
+	// Streamed uploads signal a timeline semaphore that both frames and the host check
+	VkPhysicalDeviceVulkan12Features vulkan12Features{};
+	vulkan12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+	vulkan12Features.timelineSemaphore = VK_TRUE;
+	// The bindless texture table is a partially written array that grows while frames are recorded
+	vulkan12Features.runtimeDescriptorArray = VK_TRUE;
+	vulkan12Features.descriptorBindingPartiallyBound = VK_TRUE;
+	vulkan12Features.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+	vulkan12Features.descriptorBindingUpdateUnusedWhilePending = VK_TRUE;
+	// One indirect draw covers many records, so the texture index can differ between fragments of a subgroup
+	vulkan12Features.shaderSampledImageArrayNonUniformIndexing = VK_TRUE;
+	vulkan12Features.drawIndirectCount = VK_TRUE;
+	// gl_DrawID selects the DrawData of a record
+	VkPhysicalDeviceVulkan11Features vulkan11Features{};
+	vulkan11Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_1_FEATURES;
+	vulkan11Features.shaderDrawParameters = VK_TRUE;
+	vulkan12Features.pNext = &vulkan11Features;
+	deviceCreateInfo.pNext = &vulkan12Features;
 
 	if (VALIDATION_LAYERS_ENABLED)
 	{
@@ -305,9 +619,19 @@ void RenderLoop::CreateLogicalDevice(const QueueFamilyIndices& indices)
 	vkGetDeviceQueue(_device, indices.graphicsFamily.value(), 0, &_graphicsQueue);
 	vkGetDeviceQueue(_device, indices.presentFamily.value(), 0, &_presentationQueue);
 	vkGetDeviceQueue(_device, indices.transferFamily.value(), 0, &_transferQueue);
+	_graphicsQueueFamily = indices.graphicsFamily.value();
+	_transferQueueFamily = indices.transferFamily.value();
+	_presentQueueFamily = indices.presentFamily.value();
+	GetUniqueQueueFamilyIndices(indices, _concurrentQueueFamilies);
+
+	_samplerCache = std::make_unique<SamplerCache>(_device);
+	_memoryAllocator = std::make_unique<DeviceMemoryAllocator>(_device, _physicalDevice, _memoryBudgetSupported);
+	for (uint32_t category = 0; category < FHE_MEMORY_CATEGORY_COUNT; ++category)
+		_memoryAllocator->SetBudget(static_cast<FHEMemoryCategory>(category), MEMORY_BUDGETS[category]);
+	_memoryAllocator->SetEvictionCallback([this](const FHEMemoryCategory& category, const VkDeviceSize& size) { return EvictMemory(category, size); });
 }
 
-void RenderLoop::CreateSwapChain(const QueueFamilyIndices& indices)
+void RenderLoop::CreateSwapChain()
 {
 	const SwapChainSupportDetails swapChainSupport = QuerySwapChainSupport(_physicalDevice);
 
@@ -329,11 +653,16 @@ void RenderLoop::CreateSwapChain(const QueueFamilyIndices& indices)
 	createInfo.imageArrayLayers = 1;
 	createInfo.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
 
-	std::vector<uint32_t> queueFamilyIndices;
-	GetUniqueQueueFamilyIndices(indices, queueFamilyIndices);
-	createInfo.imageSharingMode = VK_SHARING_MODE_CONCURRENT;
-	createInfo.queueFamilyIndexCount = static_cast<uint32_t>(queueFamilyIndices.size());
-	createInfo.pQueueFamilyIndices = queueFamilyIndices.data();
+	// Only rendering and presentation ever touch the images. Exclusive images are handed to the present family by RecordCommandBuffer.
+	const uint32_t queueFamilyIndices[] = { _graphicsQueueFamily, _presentQueueFamily };
+	if (_defaultSharingMode == VK_SHARING_MODE_CONCURRENT && _graphicsQueueFamily != _presentQueueFamily)
+	{
+		createInfo.imageSharingMode = VK_SHARING_MODE_CONCURRENT;
+		createInfo.queueFamilyIndexCount = 2;
+		createInfo.pQueueFamilyIndices = queueFamilyIndices;
+	}
+	else
+		createInfo.imageSharingMode = VK_SHARING_MODE_EXCLUSIVE;
 
 	createInfo.preTransform = swapChainSupport.capabilities.currentTransform;
 	// Allows for using alpha to blend with other windows in the window system??? May have to mess with this in a spike project some time.
@@ -387,75 +716,140 @@ void RenderLoop::CreateImageViews()
 
 void RenderLoop::CreateRenderPass()
 {
-	VkAttachmentDescription colorAttachment{};
-	colorAttachment.format = _swapChainImageFormat;
-	colorAttachment.samples = _msaaSamples;
-	colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-	colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
-	colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-	colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-	colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-	colorAttachment.finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
-
-	VkAttachmentReference colorAttachmentRef{};
+	const VkFormat depthFormat = FindDepthFormat();
+
+	// Sample zero is always supported, the farthest sample keeps the depth pyramid conservative along edges
+	VkPhysicalDeviceDepthStencilResolveProperties resolveProperties{};
+	resolveProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DEPTH_STENCIL_RESOLVE_PROPERTIES;
+	VkPhysicalDeviceProperties2 deviceProperties2{};
+	deviceProperties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+	deviceProperties2.pNext = &resolveProperties;
+	vkGetPhysicalDeviceProperties2(_physicalDevice, &deviceProperties2);
+	VkResolveModeFlagBits depthResolveMode = resolveProperties.supportedDepthResolveModes & VK_RESOLVE_MODE_MAX_BIT ? VK_RESOLVE_MODE_MAX_BIT : VK_RESOLVE_MODE_SAMPLE_ZERO_BIT;
+	VkResolveModeFlagBits stencilResolveMode = VK_RESOLVE_MODE_NONE;
+	// Stencil is never read, but without independent resolves it has to be resolved the same way as depth
+	if (HasStencilComponent(depthFormat) && !resolveProperties.independentResolveNone)
+	{
+		depthResolveMode = VK_RESOLVE_MODE_SAMPLE_ZERO_BIT;
+		stencilResolveMode = VK_RESOLVE_MODE_SAMPLE_ZERO_BIT;
+	}
+
+	// Both passes share the attachments of CreateFrameBuffers. The early pass clears and keeps the multisampled attachments and resolves
+	// depth for the depth pyramid, the late pass loads them, draws on top and resolves color for presentation.
+	std::array<VkAttachmentDescription2, 4> attachments{};
+	attachments[0].sType = VK_STRUCTURE_TYPE_ATTACHMENT_DESCRIPTION_2;
+	attachments[0].format = _swapChainImageFormat;
+	attachments[0].samples = _msaaSamples;
+	attachments[0].stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+	attachments[0].stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+	attachments[0].finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+	attachments[1] = attachments[0];
+	attachments[1].format = depthFormat;
+	attachments[1].finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+	attachments[2] = attachments[0];
+	attachments[2].samples = VK_SAMPLE_COUNT_1_BIT;
+	attachments[2].loadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+	attachments[2].initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	attachments[3] = attachments[2];
+	attachments[3].format = depthFormat;
+	attachments[3].finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+
+	VkAttachmentReference2 colorAttachmentRef{};
+	colorAttachmentRef.sType = VK_STRUCTURE_TYPE_ATTACHMENT_REFERENCE_2;
 	colorAttachmentRef.attachment = 0;
 	colorAttachmentRef.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
-
-	VkAttachmentDescription depthAttachment{};
-	depthAttachment.format = FindDepthFormat();
-	depthAttachment.samples = _msaaSamples;
-	depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-	depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-	depthAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-	depthAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-	depthAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-	depthAttachment.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
-
-	VkAttachmentReference depthAttachmentRef{};
+	colorAttachmentRef.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	VkAttachmentReference2 depthAttachmentRef = colorAttachmentRef;
 	depthAttachmentRef.attachment = 1;
 	depthAttachmentRef.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
-
-	VkAttachmentDescription colorAttachmentResolve{};
-	colorAttachmentResolve.format = _swapChainImageFormat;
-	colorAttachmentResolve.samples = VK_SAMPLE_COUNT_1_BIT;
-	colorAttachmentResolve.loadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-	colorAttachmentResolve.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
-	colorAttachmentResolve.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-	colorAttachmentResolve.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-	colorAttachmentResolve.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-	colorAttachmentResolve.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
-
-	VkAttachmentReference colorAttachmentResolveRef{};
+	depthAttachmentRef.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
+	VkAttachmentReference2 colorAttachmentResolveRef = colorAttachmentRef;
 	colorAttachmentResolveRef.attachment = 2;
-	colorAttachmentResolveRef.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+	VkAttachmentReference2 depthAttachmentResolveRef = depthAttachmentRef;
+	depthAttachmentResolveRef.attachment = 3;
 
-	VkSubpassDependency dependency{};
-	dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
-	dependency.dstSubpass = 0;
-	dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
-	dependency.srcAccessMask = 0;
-	dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
-	dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+	VkSubpassDescriptionDepthStencilResolve depthResolve{};
+	depthResolve.sType = VK_STRUCTURE_TYPE_SUBPASS_DESCRIPTION_DEPTH_STENCIL_RESOLVE;
+	depthResolve.depthResolveMode = depthResolveMode;
+	depthResolve.stencilResolveMode = stencilResolveMode;
+	depthResolve.pDepthStencilResolveAttachment = &depthAttachmentResolveRef;
 
-	VkSubpassDescription subpass{};
+	VkSubpassDescription2 subpass{};
+	subpass.sType = VK_STRUCTURE_TYPE_SUBPASS_DESCRIPTION_2;
 	subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
 	subpass.colorAttachmentCount = 1;
 	subpass.pColorAttachments = &colorAttachmentRef;
 	subpass.pDepthStencilAttachment = &depthAttachmentRef;
-	subpass.pResolveAttachments = &colorAttachmentResolveRef;
 
-	std::array<VkAttachmentDescription, 3> attachments = { colorAttachment, depthAttachment, colorAttachmentResolve };
-	VkRenderPassCreateInfo renderPassInfo{};
-	renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+	// Waits for the previous pass on the attachments and for culling, which read the resolved depth through the depth pyramid
+	std::array<VkSubpassDependency2, 2> dependencies{};
+	dependencies[0].sType = VK_STRUCTURE_TYPE_SUBPASS_DEPENDENCY_2;
+	dependencies[0].srcSubpass = VK_SUBPASS_EXTERNAL;
+	dependencies[0].dstSubpass = 0;
+	dependencies[0].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+	dependencies[0].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+	dependencies[0].dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+	dependencies[0].dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+	// Resolves count as color attachment writes, even for depth
+	dependencies[1].sType = VK_STRUCTURE_TYPE_SUBPASS_DEPENDENCY_2;
+	dependencies[1].srcSubpass = 0;
+	dependencies[1].dstSubpass = VK_SUBPASS_EXTERNAL;
+	dependencies[1].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+	dependencies[1].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+	dependencies[1].dstStageMask = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+	dependencies[1].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+	VkRenderPassCreateInfo2 renderPassInfo{};
+	renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO_2;
 	renderPassInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
 	renderPassInfo.pAttachments = attachments.data();
 	renderPassInfo.subpassCount = 1;
 	renderPassInfo.pSubpasses = &subpass;
+
+	attachments[0].loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+	attachments[0].storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+	attachments[0].initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	attachments[1].loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+	attachments[1].storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+	attachments[1].initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	// Never written by the early pass, the late pass resolves into it without loading it
+	attachments[2].storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+	attachments[2].finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+	attachments[3].storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+	subpass.pNext = &depthResolve;
+	renderPassInfo.dependencyCount = 2;
+	renderPassInfo.pDependencies = dependencies.data();
+
+	if (vkCreateRenderPass2(_device, &renderPassInfo, nullptr, &_earlyRenderPass) != VK_SUCCESS)
+		throw std::runtime_error("Failed to create early render pass!");
+
+	// Single subpass passes stay compatible with differing resolve attachments, so the early pass's framebuffers and pipelines work here too
+	attachments[0].loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+	// Only the resolved image is kept, so the multisampled one never has to leave tile memory again
+	attachments[0].storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+	attachments[0].initialLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+	attachments[1].loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+	attachments[1].storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+	attachments[1].initialLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+	attachments[2].storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+	attachments[2].finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+	attachments[3].storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+	subpass.pNext = nullptr;
+	subpass.pResolveAttachments = &colorAttachmentResolveRef;
 	renderPassInfo.dependencyCount = 1;
-	renderPassInfo.pDependencies = &dependency;
 
-	if (vkCreateRenderPass(_device, &renderPassInfo, nullptr, &_renderPass) != VK_SUCCESS)
+	if (vkCreateRenderPass2(_device, &renderPassInfo, nullptr, &_renderPass) != VK_SUCCESS)
 		throw std::runtime_error("Failed to create render pass!");
+
+	// Without occlusion culling nothing reads the attachments after the draws, so one pass clears them, resolves color and discards
+	// the rest without the multisampled images ever leaving tile memory. The resolved depth stays unused.
+	attachments[0].loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+	attachments[0].initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	attachments[1].loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+	attachments[1].initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+	if (vkCreateRenderPass2(_device, &renderPassInfo, nullptr, &_singleRenderPass) != VK_SUCCESS)
+		throw std::runtime_error("Failed to create single render pass!");
 }
 
 void RenderLoop::CreateDescriptorSetLayout()
@@ -464,26 +858,93 @@ void RenderLoop::CreateDescriptorSetLayout()
 	cameraBinding.binding = 0;
 	cameraBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
 	cameraBinding.descriptorCount = 1;
-	cameraBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+	cameraBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_COMPUTE_BIT;
 	cameraBinding.pImmutableSamplers = nullptr;
 
 	VkDescriptorSetLayoutBinding transformBinding{};
 	transformBinding.binding = 1;
 	transformBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
 	transformBinding.descriptorCount = 1;
-	transformBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+	transformBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_COMPUTE_BIT;
 	transformBinding.pImmutableSamplers = nullptr;
 
+	// Bindless table of every texture, draws pick theirs by index so one set serves all models
 	VkDescriptorSetLayoutBinding samplerBinding{};
 	samplerBinding.binding = 2;
 	samplerBinding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-	samplerBinding.descriptorCount = 1;
+	samplerBinding.descriptorCount = MAX_BINDLESS_TEXTURES;
 	samplerBinding.pImmutableSamplers = nullptr;
 	samplerBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
 
-	const std::array<VkDescriptorSetLayoutBinding, 3> bindings = { cameraBinding, transformBinding, samplerBinding };
+	VkDescriptorSetLayoutBinding drawDataBinding{};
+	drawDataBinding.binding = 3;
+	drawDataBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	drawDataBinding.descriptorCount = 1;
+	drawDataBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_COMPUTE_BIT;
+	drawDataBinding.pImmutableSamplers = nullptr;
+
+	VkDescriptorSetLayoutBinding visibleInstanceBinding{};
+	visibleInstanceBinding.binding = 4;
+	visibleInstanceBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	visibleInstanceBinding.descriptorCount = 1;
+	visibleInstanceBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_COMPUTE_BIT;
+	visibleInstanceBinding.pImmutableSamplers = nullptr;
+
+	// The indirect draw records, only written by culling
+	VkDescriptorSetLayoutBinding drawCommandBinding{};
+	drawCommandBinding.binding = 5;
+	drawCommandBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	drawCommandBinding.descriptorCount = 1;
+	drawCommandBinding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	drawCommandBinding.pImmutableSamplers = nullptr;
+
+	VkDescriptorSetLayoutBinding depthPyramidBinding{};
+	depthPyramidBinding.binding = 6;
+	depthPyramidBinding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	depthPyramidBinding.descriptorCount = 1;
+	depthPyramidBinding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	depthPyramidBinding.pImmutableSamplers = nullptr;
+
+	VkDescriptorSetLayoutBinding instanceVisibilityBinding{};
+	instanceVisibilityBinding.binding = 7;
+	instanceVisibilityBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	instanceVisibilityBinding.descriptorCount = 1;
+	instanceVisibilityBinding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	instanceVisibilityBinding.pImmutableSamplers = nullptr;
+
+	VkDescriptorSetLayoutBinding cullStatisticsBinding{};
+	cullStatisticsBinding.binding = 8;
+	cullStatisticsBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	cullStatisticsBinding.descriptorCount = 1;
+	cullStatisticsBinding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	cullStatisticsBinding.pImmutableSamplers = nullptr;
+
+	VkDescriptorSetLayoutBinding animationBinding{};
+	animationBinding.binding = 9;
+	animationBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	animationBinding.descriptorCount = 1;
+	animationBinding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	animationBinding.pImmutableSamplers = nullptr;
+
+	VkDescriptorSetLayoutBinding animationClockBinding{};
+	animationClockBinding.binding = 10;
+	animationClockBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+	animationClockBinding.descriptorCount = 1;
+	animationClockBinding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	animationClockBinding.pImmutableSamplers = nullptr;
+
+	const std::array<VkDescriptorSetLayoutBinding, 11> bindings = { cameraBinding, transformBinding, samplerBinding, drawDataBinding, visibleInstanceBinding, drawCommandBinding, depthPyramidBinding, instanceVisibilityBinding, cullStatisticsBinding, animationBinding, animationClockBinding };
+	// Slots are written as textures get registered, those no draw indexes may be left empty or rewritten while a frame is in flight
+	const std::array<VkDescriptorBindingFlags, 11> bindingFlags = { 0, 0, VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT | VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT | VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT, 0, 0, 0, 0, 0, 0, 0, 0 };
+	VkDescriptorSetLayoutBindingFlagsCreateInfo bindingFlagsInfo{};
+	bindingFlagsInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
+	bindingFlagsInfo.bindingCount = static_cast<uint32_t>(bindingFlags.size());
+	bindingFlagsInfo.pBindingFlags = bindingFlags.data();
+
 	VkDescriptorSetLayoutCreateInfo layoutInfo{};
 	layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	layoutInfo.pNext = &bindingFlagsInfo;
+	layoutInfo.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT;
 	layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
 	layoutInfo.pBindings = bindings.data();
 
@@ -523,14 +984,20 @@ void RenderLoop::CreateGraphicsPipeline()
 	dynamicStateInfo.dynamicStateCount = static_cast<uint32_t>(dynamicStates.size());
 	dynamicStateInfo.pDynamicStates = dynamicStates.data();
 
-	auto bindingDescription = Vertex::GetBindingDescription();
-	auto attributeDescriptions = Vertex::GetAttributeDescription();
-	VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
-	vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-	vertexInputInfo.vertexBindingDescriptionCount = 1;
-	vertexInputInfo.pVertexBindingDescriptions = &bindingDescription;
-	vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(attributeDescriptions.size());
-	vertexInputInfo.pVertexAttributeDescriptions = attributeDescriptions.data();
+	std::array<VkVertexInputBindingDescription, FHE_VERTEX_LAYOUT_COUNT> bindingDescriptions{};
+	std::array<std::array<VkVertexInputAttributeDescription, 2>, FHE_VERTEX_LAYOUT_COUNT> attributeDescriptions{};
+	std::array<VkPipelineVertexInputStateCreateInfo, FHE_VERTEX_LAYOUT_COUNT> vertexInputInfos{};
+	for (uint32_t layout = 0; layout < FHE_VERTEX_LAYOUT_COUNT; ++layout)
+	{
+		bindingDescriptions[layout] = VertexLayout::GetBindingDescription(static_cast<FHEVertexLayout>(layout));
+		attributeDescriptions[layout] = VertexLayout::GetAttributeDescriptions(static_cast<FHEVertexLayout>(layout));
+
+		vertexInputInfos[layout].sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+		vertexInputInfos[layout].vertexBindingDescriptionCount = 1;
+		vertexInputInfos[layout].pVertexBindingDescriptions = &bindingDescriptions[layout];
+		vertexInputInfos[layout].vertexAttributeDescriptionCount = static_cast<uint32_t>(attributeDescriptions[layout].size());
+		vertexInputInfos[layout].pVertexAttributeDescriptions = attributeDescriptions[layout].data();
+	}
 
 	VkPipelineInputAssemblyStateCreateInfo inputAssemblyInfo{};
 	inputAssemblyInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
@@ -615,8 +1082,13 @@ void RenderLoop::CreateGraphicsPipeline()
 	pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
 	pipelineLayoutInfo.setLayoutCount = 1;
 	pipelineLayoutInfo.pSetLayouts = &_descriptorSetLayout;
-	pipelineLayoutInfo.pushConstantRangeCount = 0;
-	pipelineLayoutInfo.pPushConstantRanges = nullptr;
+	// First record of the indirect draw, everything else per draw comes from its DrawData
+	VkPushConstantRange pushConstantRange{};
+	pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+	pushConstantRange.offset = 0;
+	pushConstantRange.size = sizeof(uint32_t);
+	pipelineLayoutInfo.pushConstantRangeCount = 1;
+	pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
 
 	if (vkCreatePipelineLayout(_device, &pipelineLayoutInfo, nullptr, &_pipelineLayout) != VK_SUCCESS)
 		throw std::runtime_error("Failed to create pipeline layout!");
@@ -626,7 +1098,6 @@ void RenderLoop::CreateGraphicsPipeline()
 	pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
 	pipelineInfo.stageCount = static_cast<uint32_t>(shaderStages.size());
 	pipelineInfo.pStages = shaderStages.data();
-	pipelineInfo.pVertexInputState = &vertexInputInfo;
 	pipelineInfo.pInputAssemblyState = &inputAssemblyInfo;
 	pipelineInfo.pViewportState = &viewportStateInfo;
 	pipelineInfo.pRasterizationState = &rasterizerInfo;
@@ -641,7 +1112,14 @@ void RenderLoop::CreateGraphicsPipeline()
 	pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
 	pipelineInfo.basePipelineIndex = -1;
 
-	if (vkCreateGraphicsPipelines(_device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &_graphicsPipeline) != VK_SUCCESS)
+	std::array<VkGraphicsPipelineCreateInfo, FHE_VERTEX_LAYOUT_COUNT> pipelineInfos{};
+	for (uint32_t layout = 0; layout < FHE_VERTEX_LAYOUT_COUNT; ++layout)
+	{
+		pipelineInfos[layout] = pipelineInfo;
+		pipelineInfos[layout].pVertexInputState = &vertexInputInfos[layout];
+	}
+
+	if (vkCreateGraphicsPipelines(_device, VK_NULL_HANDLE, static_cast<uint32_t>(pipelineInfos.size()), pipelineInfos.data(), nullptr, _graphicsPipelines.data()) != VK_SUCCESS)
 		throw std::runtime_error("Failed to create graphics pipeline!");
 
 
@@ -649,16 +1127,171 @@ void RenderLoop::CreateGraphicsPipeline()
 	vkDestroyShaderModule(_device, vertShaderModule, nullptr);
 }
 
+void RenderLoop::CreateCullPipeline()
+{
+	const auto cullShaderCode = ReadFile(RenderLoop::SHADER_PATH + "/cull_comp.spv");
+	const VkShaderModule cullShaderModule = CreateShaderModule(cullShaderCode);
+
+	VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+	pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	pipelineLayoutInfo.setLayoutCount = 1;
+	pipelineLayoutInfo.pSetLayouts = &_descriptorSetLayout;
+	// Phase, whether occlusion culling runs and where this and the previous frame's instance visibility starts
+	VkPushConstantRange pushConstantRange{};
+	pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	pushConstantRange.offset = 0;
+	pushConstantRange.size = 4 * sizeof(uint32_t);
+	pipelineLayoutInfo.pushConstantRangeCount = 1;
+	pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+
+	if (vkCreatePipelineLayout(_device, &pipelineLayoutInfo, nullptr, &_cullPipelineLayout) != VK_SUCCESS)
+		throw std::runtime_error("Failed to create cull pipeline layout!");
+
+	// The late phase's records start MAX_INDIRECT_DRAWS records after the early phase's
+	const uint32_t maxDraws = MAX_INDIRECT_DRAWS;
+	VkSpecializationMapEntry specializationEntry{};
+	specializationEntry.constantID = 0;
+	specializationEntry.offset = 0;
+	specializationEntry.size = sizeof(uint32_t);
+	VkSpecializationInfo specializationInfo{};
+	specializationInfo.mapEntryCount = 1;
+	specializationInfo.pMapEntries = &specializationEntry;
+	specializationInfo.dataSize = sizeof(uint32_t);
+	specializationInfo.pData = &maxDraws;
+
+	VkComputePipelineCreateInfo pipelineInfo{};
+	pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+	pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+	pipelineInfo.stage.module = cullShaderModule;
+	pipelineInfo.stage.pName = "main";
+	pipelineInfo.stage.pSpecializationInfo = &specializationInfo;
+	pipelineInfo.layout = _cullPipelineLayout;
+	pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
+	pipelineInfo.basePipelineIndex = -1;
+
+	if (vkCreateComputePipelines(_device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &_cullPipeline) != VK_SUCCESS)
+		throw std::runtime_error("Failed to create cull pipeline!");
+
+	vkDestroyShaderModule(_device, cullShaderModule, nullptr);
+}
+
+void RenderLoop::CreateDepthPyramidPipeline()
+{
+	const auto pyramidShaderCode = ReadFile(RenderLoop::SHADER_PATH + "/depthpyramid_comp.spv");
+	const VkShaderModule pyramidShaderModule = CreateShaderModule(pyramidShaderCode);
+
+	// Nearest and clamped, every level is reduced texel by texel and culling fetches exact texels
+	VkSamplerCreateInfo samplerInfo{};
+	samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+	samplerInfo.magFilter = VK_FILTER_NEAREST;
+	samplerInfo.minFilter = VK_FILTER_NEAREST;
+	samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+	samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerInfo.anisotropyEnable = VK_FALSE;
+	samplerInfo.maxAnisotropy = 0.f;
+	samplerInfo.borderColor = VK_BORDER_COLOR_INT_OPAQUE_BLACK;
+	samplerInfo.unnormalizedCoordinates = VK_FALSE;
+	samplerInfo.compareEnable = VK_FALSE;
+	samplerInfo.compareOp = VK_COMPARE_OP_ALWAYS;
+	samplerInfo.mipLodBias = 0.f;
+	samplerInfo.minLod = 0.f;
+	samplerInfo.maxLod = VK_LOD_CLAMP_NONE;
+	_depthPyramidSampler = _samplerCache->Acquire(samplerInfo);
+
+	VkDescriptorSetLayoutBinding sourceBinding{};
+	sourceBinding.binding = 0;
+	sourceBinding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	sourceBinding.descriptorCount = 1;
+	sourceBinding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	sourceBinding.pImmutableSamplers = nullptr;
+
+	VkDescriptorSetLayoutBinding destinationBinding{};
+	destinationBinding.binding = 1;
+	destinationBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+	destinationBinding.descriptorCount = 1;
+	destinationBinding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	destinationBinding.pImmutableSamplers = nullptr;
+
+	const std::array<VkDescriptorSetLayoutBinding, 2> bindings = { sourceBinding, destinationBinding };
+	VkDescriptorSetLayoutCreateInfo layoutInfo{};
+	layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+	layoutInfo.pBindings = bindings.data();
+
+	if (vkCreateDescriptorSetLayout(_device, &layoutInfo, nullptr, &_depthPyramidSetLayout) != VK_SUCCESS)
+		throw std::runtime_error("Failed to create depth pyramid descriptor set layout!");
+
+	VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+	pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	pipelineLayoutInfo.setLayoutCount = 1;
+	pipelineLayoutInfo.pSetLayouts = &_depthPyramidSetLayout;
+	pipelineLayoutInfo.pushConstantRangeCount = 0;
+	pipelineLayoutInfo.pPushConstantRanges = nullptr;
+
+	if (vkCreatePipelineLayout(_device, &pipelineLayoutInfo, nullptr, &_depthPyramidPipelineLayout) != VK_SUCCESS)
+		throw std::runtime_error("Failed to create depth pyramid pipeline layout!");
+
+	VkComputePipelineCreateInfo pipelineInfo{};
+	pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+	pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+	pipelineInfo.stage.module = pyramidShaderModule;
+	pipelineInfo.stage.pName = "main";
+	pipelineInfo.layout = _depthPyramidPipelineLayout;
+	pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
+	pipelineInfo.basePipelineIndex = -1;
+
+	if (vkCreateComputePipelines(_device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &_depthPyramidPipeline) != VK_SUCCESS)
+		throw std::runtime_error("Failed to create depth pyramid pipeline!");
+
+	vkDestroyShaderModule(_device, pyramidShaderModule, nullptr);
+}
+
+void RenderLoop::CreateAnimationPipeline()
+{
+	const auto animationShaderCode = ReadFile(RenderLoop::SHADER_PATH + "/animate_comp.spv");
+	const VkShaderModule animationShaderModule = CreateShaderModule(animationShaderCode);
+
+	VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+	pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	pipelineLayoutInfo.setLayoutCount = 1;
+	pipelineLayoutInfo.pSetLayouts = &_descriptorSetLayout;
+	pipelineLayoutInfo.pushConstantRangeCount = 0;
+	pipelineLayoutInfo.pPushConstantRanges = nullptr;
+
+	if (vkCreatePipelineLayout(_device, &pipelineLayoutInfo, nullptr, &_animationPipelineLayout) != VK_SUCCESS)
+		throw std::runtime_error("Failed to create animation pipeline layout!");
+
+	VkComputePipelineCreateInfo pipelineInfo{};
+	pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+	pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+	pipelineInfo.stage.module = animationShaderModule;
+	pipelineInfo.stage.pName = "main";
+	pipelineInfo.layout = _animationPipelineLayout;
+	pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
+	pipelineInfo.basePipelineIndex = -1;
+
+	if (vkCreateComputePipelines(_device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &_animationPipeline) != VK_SUCCESS)
+		throw std::runtime_error("Failed to create animation pipeline!");
+
+	vkDestroyShaderModule(_device, animationShaderModule, nullptr);
+}
+
 void RenderLoop::CreateFrameBuffers()
 {
 	_swapChainFrameBuffers.resize(_swapChainImageViews.size());
 
 	for (size_t i = 0; i < _swapChainImageViews.size(); ++i)
 	{
-		std::array<VkImageView, 3> attachments = {
+		std::array<VkImageView, 4> attachments = {
 			_colorImageView,
 			_depthImageView,
 			_swapChainImageViews[i],
+			_depthResolveImageView,
 		};
 
 		VkFramebufferCreateInfo framebufferInfo{};
@@ -690,72 +1323,227 @@ void RenderLoop::CreateCommandPool(const QueueFamilyIndices& queueFamilyIndices)
 
 	if (vkCreateCommandPool(_device, &poolInfo, nullptr, &_transferCommandPool) != VK_SUCCESS)
 		throw std::runtime_error("Failed to create transfer command pool!");
+
+	if (NeedsPresentOwnershipTransfer())
+	{
+		poolInfo.queueFamilyIndex = queueFamilyIndices.presentFamily.value();
+		poolInfo.flags = 0;
+
+		if (vkCreateCommandPool(_device, &poolInfo, nullptr, &_presentCommandPool) != VK_SUCCESS)
+			throw std::runtime_error("Failed to create present command pool!");
+	}
+
+	_uploadContext = std::make_unique<UploadContext>(_device, _graphicsQueue, queueFamilyIndices.graphicsFamily.value());
+}
+
+void RenderLoop::CreatePresentAcquireCommandBuffers()
+{
+	if (!NeedsPresentOwnershipTransfer())
+		return;
+
+	// Recorded once per swap chain image, the images only change when the swap chain is recreated
+	_presentAcquireCommandBuffers.resize(_swapChainImages.size());
+
+	VkCommandBufferAllocateInfo allocInfo{};
+	allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+	allocInfo.commandPool = _presentCommandPool;
+	allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+	allocInfo.commandBufferCount = static_cast<uint32_t>(_presentAcquireCommandBuffers.size());
+
+	if (vkAllocateCommandBuffers(_device, &allocInfo, _presentAcquireCommandBuffers.data()) != VK_SUCCESS)
+		throw std::runtime_error("Failed to allocate present command buffers!");
+
+	VkCommandBufferBeginInfo beginInfo{};
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+
+	VkImageMemoryBarrier barrier{};
+	barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	barrier.oldLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+	barrier.newLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+	barrier.srcQueueFamilyIndex = _graphicsQueueFamily;
+	barrier.dstQueueFamilyIndex = _presentQueueFamily;
+	barrier.srcAccessMask = 0;
+	barrier.dstAccessMask = 0;
+	barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	barrier.subresourceRange.baseMipLevel = 0;
+	barrier.subresourceRange.levelCount = 1;
+	barrier.subresourceRange.baseArrayLayer = 0;
+	barrier.subresourceRange.layerCount = 1;
+
+	for (size_t i = 0; i < _presentAcquireCommandBuffers.size(); ++i)
+	{
+		vkBeginCommandBuffer(_presentAcquireCommandBuffers[i], &beginInfo);
+		barrier.image = _swapChainImages[i];
+		vkCmdPipelineBarrier(_presentAcquireCommandBuffers[i], VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+		if (vkEndCommandBuffer(_presentAcquireCommandBuffers[i]) != VK_SUCCESS)
+			throw std::runtime_error("Failed to record a present command buffer!");
+	}
+}
+
+void RenderLoop::CreateStagingRing()
+{
+	// Read by copies on both the graphics and the transfer queue, only ever written by the host. Linear host memory gains nothing from exclusive ownership.
+	CreateBuffer(STAGING_RING_SIZE, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, _stagingRingBuffer, _stagingRingAllocation, FHE_MEMORY_CATEGORY_STAGING, VK_SHARING_MODE_CONCURRENT);
+	_stagingRing = StagingRing(STAGING_RING_SIZE);
 }
 
 void RenderLoop::CreateDepthResources()
 {
 	const VkFormat depthFormat = FindDepthFormat();
 
-	CreateImage(_swapChainExtent.width, _swapChainExtent.height, 1, _msaaSamples, depthFormat, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, _depthImage, _depthImageMemory);
+	// Cleared at the start of the first pass and discarded at the end of the last one, so no layout transition is needed up front.
+	// Occlusion culling keeps it in memory between the early and the late pass, otherwise it never leaves tile memory and can be transient.
+	CreateImage(_swapChainExtent.width, _swapChainExtent.height, 1, _msaaSamples, depthFormat, VK_IMAGE_TILING_OPTIMAL, GetMultisampledAttachmentUsage() | VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, _depthImage, _depthImageAllocation, FHE_MEMORY_CATEGORY_ATTACHMENT, _occlusionCulling ? 0 : VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT);
 	CreateImageView(_depthImage, depthFormat, VK_IMAGE_ASPECT_DEPTH_BIT, 1, _depthImageView);
-
-	TransitionImageLayout(_depthImage, depthFormat, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL, 1);
 }
 
 void RenderLoop::CreateColorResources()
 {
 	const VkFormat colorFormat = _swapChainImageFormat;
 
-	CreateImage(_swapChainExtent.width, _swapChainExtent.height, 1, _msaaSamples, colorFormat, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT | VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, _colorImage, _colorImageMemory);
+	CreateImage(_swapChainExtent.width, _swapChainExtent.height, 1, _msaaSamples, colorFormat, VK_IMAGE_TILING_OPTIMAL, GetMultisampledAttachmentUsage() | VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, _colorImage, _colorImageAllocation, FHE_MEMORY_CATEGORY_ATTACHMENT, _occlusionCulling ? 0 : VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT);
 	CreateImageView(_colorImage, colorFormat, VK_IMAGE_ASPECT_COLOR_BIT, 1, _colorImageView);
 }
 
+VkImageUsageFlags RenderLoop::GetMultisampledAttachmentUsage() const
+{
+	// Only _singleRenderPass discards both attachments within the pass that cleared them
+	return _occlusionCulling ? 0 : VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT;
+}
 
-void RenderLoop::CreateTextures()
+void RenderLoop::CreateDepthResolveResources()
 {
-	_models.resize(1);
-	_models[0].textures.resize(1);
-	LoadTexture(TEXTURE_PATH, _models[0].textures[0].view, _models[0].textures[0].texture);
-	CreateSampler(_models[0].textures[0]);
+	const VkFormat depthFormat = FindDepthFormat();
+
+	// Written by the early pass's resolve and only ever sampled for its depth, the stencil of combined formats is left alone
+	CreateImage(_swapChainExtent.width, _swapChainExtent.height, 1, VK_SAMPLE_COUNT_1_BIT, depthFormat, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, _depthResolveImage, _depthResolveImageAllocation, FHE_MEMORY_CATEGORY_ATTACHMENT);
+	CreateImageView(_depthResolveImage, depthFormat, VK_IMAGE_ASPECT_DEPTH_BIT, 1, _depthResolveImageView);
 }
 
-void RenderLoop::LoadModels()
+void RenderLoop::CreateDepthPyramid()
 {
-	tinyobj::attrib_t attrib;
-	std::vector<tinyobj::shape_t> shapes;
-	std::vector<tinyobj::material_t> materials;
-	std::string warn, err;
+	// Level 0 rounds up so that it covers every texel of the resolved depth
+	_depthPyramidExtent.width = std::max(1u, (_swapChainExtent.width + 1) / 2);
+	_depthPyramidExtent.height = std::max(1u, (_swapChainExtent.height + 1) / 2);
+	const uint32_t levelCount = static_cast<uint32_t>(std::floor(std::log2(std::max(_depthPyramidExtent.width, _depthPyramidExtent.height)))) + 1;
+
+	CreateImage(_depthPyramidExtent.width, _depthPyramidExtent.height, levelCount, VK_SAMPLE_COUNT_1_BIT, VK_FORMAT_R32_SFLOAT, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, _depthPyramid, _depthPyramidAllocation, FHE_MEMORY_CATEGORY_ATTACHMENT);
+	CreateImageView(_depthPyramid, VK_FORMAT_R32_SFLOAT, VK_IMAGE_ASPECT_COLOR_BIT, levelCount, _depthPyramidView);
+	_depthPyramidLevelViews.resize(levelCount);
+	for (uint32_t level = 0; level < levelCount; ++level)
+		CreateImageView(_depthPyramid, VK_FORMAT_R32_SFLOAT, VK_IMAGE_ASPECT_COLOR_BIT, 1, _depthPyramidLevelViews[level], level);
+	TransitionImageLayout(_depthPyramid, VK_FORMAT_R32_SFLOAT, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL, levelCount);
+
+	std::array<VkDescriptorPoolSize, 2> poolSizes{};
+	poolSizes[0].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	poolSizes[0].descriptorCount = levelCount;
+	poolSizes[1].type = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+	poolSizes[1].descriptorCount = levelCount;
+
+	VkDescriptorPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+	poolInfo.pPoolSizes = poolSizes.data();
+	poolInfo.maxSets = levelCount;
+
+	if (vkCreateDescriptorPool(_device, &poolInfo, nullptr, &_depthPyramidDescriptorPool) != VK_SUCCESS)
+		throw std::runtime_error("Failed to create depth pyramid descriptor pool!");
 
-	std::unordered_map<Vertex, uint32_t> uniqueVertices{};
+	const std::vector<VkDescriptorSetLayout> layouts(levelCount, _depthPyramidSetLayout);
+	VkDescriptorSetAllocateInfo allocInfo{};
+	allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	allocInfo.descriptorPool = _depthPyramidDescriptorPool;
+	allocInfo.descriptorSetCount = levelCount;
+	allocInfo.pSetLayouts = layouts.data();
 
-	if (!LoadObj(&attrib, &shapes, &materials, &warn, &err, MODEL_PATH.c_str()))
-		throw std::runtime_error(warn + err);
+	_depthPyramidSets.resize(levelCount);
+	if (vkAllocateDescriptorSets(_device, &allocInfo, _depthPyramidSets.data()) != VK_SUCCESS)
+		throw std::runtime_error("Failed to allocate depth pyramid descriptor sets!");
 
-	for (const auto& shape : shapes)
+	// Each level reads the one below it, level 0 reads the resolved depth
+	std::vector<VkDescriptorImageInfo> imageInfos(levelCount * 2);
+	std::vector<VkWriteDescriptorSet> descriptorWrites(levelCount * 2);
+	for (uint32_t level = 0; level < levelCount; ++level)
 	{
-		for (const auto& index : shape.mesh.indices)
+		VkDescriptorImageInfo& sourceInfo = imageInfos[level * 2];
+		sourceInfo.sampler = _depthPyramidSampler;
+		sourceInfo.imageView = level == 0 ? _depthResolveImageView : _depthPyramidLevelViews[level - 1];
+		sourceInfo.imageLayout = level == 0 ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_GENERAL;
+		VkDescriptorImageInfo& destinationInfo = imageInfos[level * 2 + 1];
+		destinationInfo.sampler = nullptr;
+		destinationInfo.imageView = _depthPyramidLevelViews[level];
+		destinationInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+
+		for (uint32_t binding = 0; binding < 2; ++binding)
 		{
-			Vertex vertex{};
-			vertex.position = {
-				attrib.vertices[3 * index.vertex_index + 0],
-				attrib.vertices[3 * index.vertex_index + 1],
-				attrib.vertices[3 * index.vertex_index + 2]
-			};
-			vertex.texCoord = {
-				attrib.texcoords[2 * index.texcoord_index + 0],
-				1.f - attrib.texcoords[2 * index.texcoord_index + 1]
-			};
-			vertex.color = { 1.f, 1.f, 1.f };
-
-			if (uniqueVertices.count(vertex) == 0)
-			{
-				uniqueVertices[vertex] = static_cast<uint32_t>(_models[0].vertices.size());
-				_models[0].vertices.push_back(vertex);
-			}
-			_models[0].indices.push_back(uniqueVertices[vertex]);
+			VkWriteDescriptorSet& descriptorWrite = descriptorWrites[level * 2 + binding];
+			descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			descriptorWrite.dstSet = _depthPyramidSets[level];
+			descriptorWrite.dstBinding = binding;
+			descriptorWrite.dstArrayElement = 0;
+			descriptorWrite.descriptorType = binding == 0 ? VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER : VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+			descriptorWrite.descriptorCount = 1;
+			descriptorWrite.pImageInfo = &imageInfos[level * 2 + binding];
 		}
 	}
 
+	vkUpdateDescriptorSets(_device, static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
+}
+
+
+void RenderLoop::CreateTextures()
+{
+	// Registered first, so it takes slot 0
+	CreateDefaultTexture();
+
+	_models.resize(1);
+	_models[0].textures.resize(1);
+
+	// Every texture of every model goes through a single batch
+	std::vector<std::string> filePaths;
+	std::vector<FHEImage*> targets;
+	filePaths.push_back(TEXTURE_PATH);
+	targets.push_back(&_models[0].textures[0]);
+	LoadTextures(filePaths, targets);
+
+	for (const auto target : targets)
+	{
+		CreateSampler(*target);
+		RegisterTexture(*target);
+	}
+}
+
+void RenderLoop::CreateDefaultTexture()
+{
+	const uint32_t texel = UINT32_MAX;
+	_defaultTexture.format = VK_FORMAT_R8G8B8A8_UNORM;
+	_defaultTexture.levelCount = 1;
+	CreateImage(1, 1, 1, VK_SAMPLE_COUNT_1_BIT, _defaultTexture.format, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, _defaultTexture.image, _defaultTexture.allocation, FHE_MEMORY_CATEGORY_TEXTURE);
+
+	VkBuffer stagingBuffer;
+	FHEAllocation stagingBufferAllocation;
+	CreateBuffer(sizeof(texel), VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingBufferAllocation, FHE_MEMORY_CATEGORY_STAGING, _defaultSharingMode);
+	memcpy(stagingBufferAllocation.mapped, &texel, sizeof(texel));
+
+	TransitionImageLayout(_defaultTexture.image, _defaultTexture.format, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1);
+	CopyBufferToImage(stagingBuffer, _defaultTexture.image, 1, 1);
+	TransitionImageLayout(_defaultTexture.image, _defaultTexture.format, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, 1);
+	_uploadDeletionQueue.emplace_back(_uploadContext->GetRecordingValue(), [this, stagingBuffer, stagingBufferAllocation]()
+		{
+			vkDestroyBuffer(_device, stagingBuffer, nullptr);
+			_memoryAllocator->Free(stagingBufferAllocation);
+		});
+
+	CreateImageView(_defaultTexture.image, _defaultTexture.format, VK_IMAGE_ASPECT_COLOR_BIT, 1, _defaultTexture.view);
+	CreateSampler(_defaultTexture);
+	RegisterTexture(_defaultTexture);
+}
+
+void RenderLoop::LoadModels()
+{
+	// Transforms are known up front, the geometry streams in and the model is drawn once it is resident
+	RequestModelGeometry(_models[0], MODEL_PATH);
+
 	uint32_t transformCount = 0;
 	for (auto& model : _models)
 	{
@@ -826,46 +1614,10 @@ void RenderLoop::SetupCamera()
 	_inputManager->AddKeyListener(listenerD);
 }
 
-void RenderLoop::CreateVertexBuffer()
-{
-	const VkDeviceSize bufferSize = sizeof(_models[0].vertices[0]) * _models[0].vertices.size();
-
-	VkBuffer stagingBuffer;
-	VkDeviceMemory stagingBufferMemory;
-	CreateBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingBufferMemory);
-
-	void* data;
-	vkMapMemory(_device, stagingBufferMemory, 0, bufferSize, 0, &data);
-	memcpy(data, _models[0].vertices.data(), bufferSize);
-	vkUnmapMemory(_device, stagingBufferMemory);
-
-	CreateBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, _vertexBuffer, _vertexBufferMemory);
-
-	CopyBuffer(stagingBuffer, _vertexBuffer, bufferSize);
-
-	vkDestroyBuffer(_device, stagingBuffer, nullptr);
-	vkFreeMemory(_device, stagingBufferMemory, nullptr);
-}
-
-void RenderLoop::CreateIndexBuffer()
+void RenderLoop::CreateGeometryArena()
 {
-	const VkDeviceSize bufferSize = sizeof(_models[0].indices[0]) * _models[0].indices.size();
-
-	VkBuffer stagingBuffer;
-	VkDeviceMemory stagingBufferMemory;
-	CreateBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingBufferMemory);
-
-	void* data;
-	vkMapMemory(_device, stagingBufferMemory, 0, bufferSize, 0, &data);
-	memcpy(data, _models[0].indices.data(), bufferSize);
-	vkUnmapMemory(_device, stagingBufferMemory);
-
-	CreateBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, _indexBuffer, _indexBufferMemory);
-
-	CopyBuffer(stagingBuffer, _indexBuffer, bufferSize);
-
-	vkDestroyBuffer(_device, stagingBuffer, nullptr);
-	vkFreeMemory(_device, stagingBufferMemory, nullptr);
+	GrowGeometryBuffer(_vertexBuffer, _vertexBufferAllocation, _vertexArena, GEOMETRY_ARENA_VERTEX_SIZE, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT);
+	GrowGeometryBuffer(_indexBuffer, _indexBufferAllocation, _indexArena, GEOMETRY_ARENA_INDEX_SIZE, VK_BUFFER_USAGE_INDEX_BUFFER_BIT);
 }
 
 void RenderLoop::CreateTransformBuffer()
@@ -874,13 +1626,87 @@ void RenderLoop::CreateTransformBuffer()
 	{
 		_transformBufferSize += model->second->size();
 	}
+	_instanceCount = static_cast<uint32_t>(_transformBufferSize);
 	_transformBufferSize *= sizeof(glm::mat4);
 
-	CreateBuffer(_transformBufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, _transformStagingBuffer, _transformStagingBufferMemory);
-	CreateBuffer(_transformBufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, _transformBuffer, _transformBufferMemory);
+	// Each frame in flight gets its own region, aligned so it can be bound as the start of a storage buffer descriptor
+	VkPhysicalDeviceProperties properties{};
+	vkGetPhysicalDeviceProperties(_physicalDevice, &properties);
+	const VkDeviceSize alignment = properties.limits.minStorageBufferOffsetAlignment;
+	_transformRegionSize = (_transformBufferSize + alignment - 1) / alignment * alignment;
+	// Only ever written by animate.comp, every frame before anything reads its region
+	CreateBuffer(_transformRegionSize * MAX_FRAMES_IN_FLIGHT, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, _transformBuffer, _transformBufferAllocation, FHE_MEMORY_CATEGORY_OTHER, _defaultSharingMode);
+
+	// The transforms of _modelTransforms stay on the host as rest poses, the device spins them from here on
+	std::vector<InstanceAnimation> animations(_instanceCount);
+	for (const auto& model : _models)
+	{
+		const auto& transforms = *_modelTransforms.at(&model);
+		for (size_t i = 0; i < transforms.size(); ++i)
+		{
+			InstanceAnimation& animation = animations[model.transformIndex + i];
+			animation.restTransform = transforms[i];
+			animation.axis = glm::vec3(0.f, 1.f, 0.f);
+			animation.angularVelocity = &model == _models.data() ? glm::radians(static_cast<float>(FISH_DEGREES_PER_SECOND)) : 0.f;
+			animation.angle = 0.f;
+		}
+	}
+
+	const VkDeviceSize animationSize = animations.size() * sizeof(InstanceAnimation);
+	VkBuffer stagingBuffer;
+	FHEAllocation stagingBufferAllocation;
+	CreateBuffer(animationSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingBufferAllocation, FHE_MEMORY_CATEGORY_STAGING, _defaultSharingMode);
+	memcpy(stagingBufferAllocation.mapped, animations.data(), animationSize);
+	CreateBuffer(animationSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, _animationBuffer, _animationBufferAllocation, FHE_MEMORY_CATEGORY_OTHER, _defaultSharingMode);
+	CopyBuffer(stagingBuffer, _animationBuffer, animationSize);
+	_uploadDeletionQueue.emplace_back(_uploadContext->GetRecordingValue(), [this, stagingBuffer, stagingBufferAllocation]()
+		{
+			vkDestroyBuffer(_device, stagingBuffer, nullptr);
+			_memoryAllocator->Free(stagingBufferAllocation);
+		});
+
+	const VkDeviceSize uniformAlignment = properties.limits.minUniformBufferOffsetAlignment;
+	_animationClockRegionSize = (sizeof(float) + uniformAlignment - 1) / uniformAlignment * uniformAlignment;
+	CreateBuffer(_animationClockRegionSize * MAX_FRAMES_IN_FLIGHT, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, _animationClockBuffer, _animationClockBufferAllocation, FHE_MEMORY_CATEGORY_OTHER, _defaultSharingMode);
+	memset(_animationClockBufferAllocation.mapped, 0, _animationClockRegionSize * MAX_FRAMES_IN_FLIGHT);
+}
+
+void RenderLoop::CreateDrawBuffer()
+{
+	// Every slice writes its own draw counts, so the slice count is fixed from here on
+	_recordingSliceCount = std::max(1u, _recordingJobSystem->GetThreadCount());
 
-	vkMapMemory(_device, _transformStagingBufferMemory, 0, _transformBufferSize, 0, &_transformStagingData);
-	CopyTransformsToDevice();
+	VkPhysicalDeviceProperties properties{};
+	vkGetPhysicalDeviceProperties(_physicalDevice, &properties);
+	const VkDeviceSize alignment = properties.limits.minStorageBufferOffsetAlignment;
+	// The records and the DrawData are both bound as the start of a storage buffer descriptor
+	const VkDeviceSize countsSize = static_cast<VkDeviceSize>(_recordingSliceCount) * DRAW_BUCKET_COUNT * sizeof(uint32_t);
+	_drawCommandOffset = (countsSize + alignment - 1) / alignment * alignment;
+	_lateDrawCommandOffset = _drawCommandOffset + MAX_INDIRECT_DRAWS * sizeof(VkDrawIndexedIndirectCommand);
+	const VkDeviceSize commandsEnd = _lateDrawCommandOffset + MAX_INDIRECT_DRAWS * sizeof(VkDrawIndexedIndirectCommand);
+	_drawDataOffset = (commandsEnd + alignment - 1) / alignment * alignment;
+	const VkDeviceSize dataEnd = _drawDataOffset + MAX_INDIRECT_DRAWS * sizeof(DrawData);
+	_drawRegionSize = (dataEnd + alignment - 1) / alignment * alignment;
+	const VkDeviceSize ringSize = _drawRegionSize * MAX_FRAMES_IN_FLIGHT;
+
+	CreateBuffer(ringSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, _drawStagingBuffer, _drawStagingBufferAllocation, FHE_MEMORY_CATEGORY_STAGING, _defaultSharingMode);
+	CreateBuffer(ringSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, _drawBuffer, _drawBufferAllocation, FHE_MEMORY_CATEGORY_OTHER, _defaultSharingMode);
+	_drawStagingData = _drawStagingBufferAllocation.mapped;
+
+	// Only ever written by culling, so it needs no staging. The early phase fills the first half, the late phase the second.
+	// A model's records share one slot per instance, so every half fits all transforms however many models get drawn.
+	_visibleInstanceRegionSize = (2 * static_cast<VkDeviceSize>(_instanceCount) * sizeof(uint32_t) + alignment - 1) / alignment * alignment;
+	CreateBuffer(_visibleInstanceRegionSize * MAX_FRAMES_IN_FLIGHT, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, _visibleInstanceBuffer, _visibleInstanceBufferAllocation, FHE_MEMORY_CATEGORY_OTHER, _defaultSharingMode);
+
+	// Starts out all invisible, so the first frame draws everything in its late phase
+	const VkDeviceSize visibilitySize = static_cast<VkDeviceSize>(_instanceCount) * MAX_FRAMES_IN_FLIGHT * sizeof(uint32_t);
+	CreateBuffer(visibilitySize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, _instanceVisibilityBuffer, _instanceVisibilityBufferAllocation, FHE_MEMORY_CATEGORY_OTHER, _defaultSharingMode);
+	vkCmdFillBuffer(_uploadContext->GetCommandBuffer(), _instanceVisibilityBuffer, 0, VK_WHOLE_SIZE, 0);
+
+	_cullStatisticsRegionSize = (sizeof(CullStatistics) + alignment - 1) / alignment * alignment;
+	CreateBuffer(_cullStatisticsRegionSize * MAX_FRAMES_IN_FLIGHT, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, _cullStatisticsBuffer, _cullStatisticsBufferAllocation, FHE_MEMORY_CATEGORY_OTHER, _defaultSharingMode);
+	// Read back before the first frames were ever submitted
+	memset(_cullStatisticsBufferAllocation.mapped, 0, _cullStatisticsRegionSize * MAX_FRAMES_IN_FLIGHT);
 }
 
 void RenderLoop::CreateUniformBuffers()
@@ -889,14 +1715,13 @@ void RenderLoop::CreateUniformBuffers()
 	const VkDeviceSize bufferSize = sizeof(Camera);
 
 	_uniformBuffers.resize(MAX_FRAMES_IN_FLIGHT);
-	_uniformBuffersMemory.resize(MAX_FRAMES_IN_FLIGHT);
+	_uniformBuffersAllocation.resize(MAX_FRAMES_IN_FLIGHT);
 	_uniformBuffersMapped.resize(MAX_FRAMES_IN_FLIGHT);
 
 	for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i)
 	{
-		CreateBuffer(bufferSize, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, _uniformBuffers[i], _uniformBuffersMemory[i]);
-
-		vkMapMemory(_device, _uniformBuffersMemory[i], 0, bufferSize, 0, &_uniformBuffersMapped[i]);
+		CreateBuffer(bufferSize, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, _uniformBuffers[i], _uniformBuffersAllocation[i], FHE_MEMORY_CATEGORY_OTHER, _defaultSharingMode);
+		_uniformBuffersMapped[i] = _uniformBuffersAllocation[i].mapped;
 	}
 }
 
@@ -904,14 +1729,15 @@ void RenderLoop::CreateDescriptorPool()
 {
 	std::array<VkDescriptorPoolSize, 3> poolSizes{};
 	poolSizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-	poolSizes[0].descriptorCount = MAX_FRAMES_IN_FLIGHT;
+	poolSizes[0].descriptorCount = MAX_FRAMES_IN_FLIGHT * 2;
 	poolSizes[1].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
-	poolSizes[1].descriptorCount = MAX_FRAMES_IN_FLIGHT;
+	poolSizes[1].descriptorCount = MAX_FRAMES_IN_FLIGHT * 7;
 	poolSizes[2].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-	poolSizes[2].descriptorCount = MAX_FRAMES_IN_FLIGHT;
+	poolSizes[2].descriptorCount = MAX_FRAMES_IN_FLIGHT * (MAX_BINDLESS_TEXTURES + 1);
 
 	VkDescriptorPoolCreateInfo poolInfo{};
 	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolInfo.flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT;
 	poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
 	poolInfo.pPoolSizes = poolSizes.data();
 	poolInfo.maxSets = MAX_FRAMES_IN_FLIGHT;
@@ -936,21 +1762,37 @@ void RenderLoop::CreateDescriptorSets()
 
 	for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i)
 	{
-		std::array<VkDescriptorBufferInfo, 2> bufferInfo{};
+		std::array<VkDescriptorBufferInfo, 9> bufferInfo{};
 		bufferInfo[0].buffer = _uniformBuffers[i];
 		bufferInfo[0].offset = 0;
 		bufferInfo[0].range = sizeof(Camera);
 		bufferInfo[1].buffer = _transformBuffer;
-		bufferInfo[1].offset = 0;
-		bufferInfo[1].range = VK_WHOLE_SIZE;
-
-		VkDescriptorImageInfo imageInfo{};
-		imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-		// TODO: Temporarily hard-coded
-		imageInfo.imageView = _models[0].textures[0].view;
-		imageInfo.sampler = _models[0].textures[0].sampler;
-
-		std::array<VkWriteDescriptorSet, 3> descriptorWrites{};
+		bufferInfo[1].offset = i * _transformRegionSize;
+		bufferInfo[1].range = _transformBufferSize;
+		bufferInfo[2].buffer = _drawBuffer;
+		bufferInfo[2].offset = i * _drawRegionSize + _drawDataOffset;
+		bufferInfo[2].range = MAX_INDIRECT_DRAWS * sizeof(DrawData);
+		bufferInfo[3].buffer = _visibleInstanceBuffer;
+		bufferInfo[3].offset = i * _visibleInstanceRegionSize;
+		bufferInfo[3].range = 2 * static_cast<VkDeviceSize>(_instanceCount) * sizeof(uint32_t);
+		bufferInfo[4].buffer = _drawBuffer;
+		bufferInfo[4].offset = i * _drawRegionSize + _drawCommandOffset;
+		bufferInfo[4].range = 2 * MAX_INDIRECT_DRAWS * sizeof(VkDrawIndexedIndirectCommand);
+		// Every frame's region, frames find theirs and the previous one's through push constants
+		bufferInfo[5].buffer = _instanceVisibilityBuffer;
+		bufferInfo[5].offset = 0;
+		bufferInfo[5].range = VK_WHOLE_SIZE;
+		bufferInfo[6].buffer = _cullStatisticsBuffer;
+		bufferInfo[6].offset = i * _cullStatisticsRegionSize;
+		bufferInfo[6].range = sizeof(CullStatistics);
+		bufferInfo[7].buffer = _animationBuffer;
+		bufferInfo[7].offset = 0;
+		bufferInfo[7].range = VK_WHOLE_SIZE;
+		bufferInfo[8].buffer = _animationClockBuffer;
+		bufferInfo[8].offset = i * _animationClockRegionSize;
+		bufferInfo[8].range = sizeof(float);
+
+		std::array<VkWriteDescriptorSet, 9> descriptorWrites{};
 		descriptorWrites[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
 		descriptorWrites[0].dstSet = _descriptorSets[i];
 		descriptorWrites[0].dstBinding = 0;
@@ -973,21 +1815,106 @@ void RenderLoop::CreateDescriptorSets()
 
 		descriptorWrites[2].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
 		descriptorWrites[2].dstSet = _descriptorSets[i];
-		descriptorWrites[2].dstBinding = 2;
+		descriptorWrites[2].dstBinding = 3;
 		descriptorWrites[2].dstArrayElement = 0;
-		descriptorWrites[2].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		descriptorWrites[2].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
 		descriptorWrites[2].descriptorCount = 1;
-		descriptorWrites[2].pBufferInfo = nullptr;
-		descriptorWrites[2].pImageInfo = &imageInfo;
+		descriptorWrites[2].pBufferInfo = &bufferInfo[2];
+		descriptorWrites[2].pImageInfo = nullptr;
 		descriptorWrites[2].pTexelBufferView = nullptr;
 
+		// Binding 6 is the depth pyramid, written by WriteDepthPyramidDescriptors
+		for (uint32_t write = 3; write < 9; ++write)
+		{
+			descriptorWrites[write].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			descriptorWrites[write].dstSet = _descriptorSets[i];
+			descriptorWrites[write].dstBinding = write < 5 ? write + 1 : write + 2;
+			descriptorWrites[write].dstArrayElement = 0;
+			descriptorWrites[write].descriptorType = write == 8 ? VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER : VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+			descriptorWrites[write].descriptorCount = 1;
+			descriptorWrites[write].pBufferInfo = &bufferInfo[write];
+			descriptorWrites[write].pImageInfo = nullptr;
+			descriptorWrites[write].pTexelBufferView = nullptr;
+		}
+
 		vkUpdateDescriptorSets(_device, descriptorWrites.size(), descriptorWrites.data(), 0, nullptr);
 	}
+
+	WriteDepthPyramidDescriptors();
+}
+
+void RenderLoop::WriteDepthPyramidDescriptors()
+{
+	VkDescriptorImageInfo imageInfo{};
+	imageInfo.sampler = _depthPyramidSampler;
+	imageInfo.imageView = _depthPyramidView;
+	imageInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+
+	std::array<VkWriteDescriptorSet, MAX_FRAMES_IN_FLIGHT> descriptorWrites{};
+	for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i)
+	{
+		descriptorWrites[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		descriptorWrites[i].dstSet = _descriptorSets[i];
+		descriptorWrites[i].dstBinding = 6;
+		descriptorWrites[i].dstArrayElement = 0;
+		descriptorWrites[i].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		descriptorWrites[i].descriptorCount = 1;
+		descriptorWrites[i].pImageInfo = &imageInfo;
+	}
+
+	vkUpdateDescriptorSets(_device, static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
+}
+
+void RenderLoop::RegisterTexture(FHEImage& texture)
+{
+	if (_textureSlotCount == MAX_BINDLESS_TEXTURES)
+		throw std::runtime_error("Bindless texture table is full!");
+
+	texture.descriptorIndex = _textureSlotCount++;
+	// Written into each frame's set as that frame comes around, so sets never have to be rebuilt
+	_dirtyTextureDescriptors[&texture] = (1u << MAX_FRAMES_IN_FLIGHT) - 1;
+}
+
+void RenderLoop::WriteTextureDescriptors(const uint32_t& frameIndex)
+{
+	std::vector<VkDescriptorImageInfo> imageInfos;
+	std::vector<VkWriteDescriptorSet> descriptorWrites;
+	imageInfos.reserve(_dirtyTextureDescriptors.size());
+	descriptorWrites.reserve(_dirtyTextureDescriptors.size());
+	for (auto texture = _dirtyTextureDescriptors.begin(); texture != _dirtyTextureDescriptors.end();)
+	{
+		if (!(texture->second & (1u << frameIndex)))
+		{
+			++texture;
+			continue;
+		}
+
+		VkDescriptorImageInfo& imageInfo = imageInfos.emplace_back();
+		imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+		imageInfo.imageView = texture->first->view;
+		imageInfo.sampler = texture->first->sampler;
+
+		VkWriteDescriptorSet& descriptorWrite = descriptorWrites.emplace_back();
+		descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		descriptorWrite.dstSet = _descriptorSets[frameIndex];
+		descriptorWrite.dstBinding = 2;
+		descriptorWrite.dstArrayElement = texture->first->descriptorIndex;
+		descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		descriptorWrite.descriptorCount = 1;
+		descriptorWrite.pImageInfo = &imageInfo;
+
+		texture->second &= ~(1u << frameIndex);
+		texture = texture->second == 0 ? _dirtyTextureDescriptors.erase(texture) : std::next(texture);
+	}
+
+	if (!descriptorWrites.empty())
+		vkUpdateDescriptorSets(_device, static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
 }
 
 void RenderLoop::CreateCommandBuffers()
 {
-	_commandBuffers.resize(MAX_FRAMES_IN_FLIGHT);
+	_commandBuffers.resize(_swapChainImages.size() * MAX_FRAMES_IN_FLIGHT);
+	_recordedRevisions.assign(_commandBuffers.size(), 0);
 
 	VkCommandBufferAllocateInfo allocInfo{};
 	allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
@@ -999,6 +1926,36 @@ void RenderLoop::CreateCommandBuffers()
 		throw std::runtime_error("Failed to allocate command buffers!");
 }
 
+void RenderLoop::CreateRecordingCommandBuffers()
+{
+	_recordingCommandPools.resize(_commandBuffers.size() * _recordingSliceCount);
+	_earlyRecordingCommandBuffers.resize(_recordingCommandPools.size());
+	_recordingCommandBuffers.resize(_recordingCommandPools.size());
+
+	// Reset as a whole whenever the slot is recorded again, so the buffers never need resetting on their own
+	VkCommandPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+	poolInfo.queueFamilyIndex = _graphicsQueueFamily;
+
+	VkCommandBufferAllocateInfo allocInfo{};
+	allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+	allocInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+	allocInfo.commandBufferCount = 1;
+
+	for (size_t i = 0; i < _recordingCommandPools.size(); ++i)
+	{
+		if (vkCreateCommandPool(_device, &poolInfo, nullptr, &_recordingCommandPools[i]) != VK_SUCCESS)
+			throw std::runtime_error("Failed to create a recording command pool!");
+
+		// A slice records its draws for both passes
+		allocInfo.commandPool = _recordingCommandPools[i];
+		if (vkAllocateCommandBuffers(_device, &allocInfo, &_earlyRecordingCommandBuffers[i]) != VK_SUCCESS ||
+			vkAllocateCommandBuffers(_device, &allocInfo, &_recordingCommandBuffers[i]) != VK_SUCCESS)
+			throw std::runtime_error("Failed to allocate a secondary command buffer!");
+	}
+}
+
 void RenderLoop::CreateSyncObjects()
 {
 	_imageAvailableSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
@@ -1007,6 +1964,10 @@ void RenderLoop::CreateSyncObjects()
 
 	VkSemaphoreCreateInfo semaphoreInfo{};
 	semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+	VkSemaphoreTypeCreateInfo timelineInfo{};
+	timelineInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+	timelineInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+	timelineInfo.initialValue = 0;
 	VkFenceCreateInfo fenceInfo{};
 	fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
 	fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
@@ -1018,6 +1979,20 @@ void RenderLoop::CreateSyncObjects()
 			vkCreateFence(_device, &fenceInfo, nullptr, &_inFlightFences[i]) != VK_SUCCESS)
 			throw std::runtime_error("Failed to create synchronization objects for a frame!");
 	}
+
+	if (NeedsPresentOwnershipTransfer())
+	{
+		_presentAcquiredSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
+		for (auto& semaphore : _presentAcquiredSemaphores)
+		{
+			if (vkCreateSemaphore(_device, &semaphoreInfo, nullptr, &semaphore) != VK_SUCCESS)
+				throw std::runtime_error("Failed to create a present semaphore!");
+		}
+	}
+
+	semaphoreInfo.pNext = &timelineInfo;
+	if (vkCreateSemaphore(_device, &semaphoreInfo, nullptr, &_transferTimeline) != VK_SUCCESS)
+		throw std::runtime_error("Failed to create the transfer timeline semaphore!");
 }
 
 void RenderLoop::RecreateSwapChain()
@@ -1035,18 +2010,53 @@ void RenderLoop::RecreateSwapChain()
 
 	vkDeviceWaitIdle(_device);
 
+	const VkExtent2D previousExtent = _swapChainExtent;
+	const VkFormat previousFormat = _swapChainImageFormat;
 	CleanupSwapChain();
 
-	QueueFamilyIndices queueFamilyIndices = FindQueueFamilies(_physicalDevice);
-	CreateSwapChain(queueFamilyIndices);
+	CreateSwapChain();
 	CreateImageViews();
-	CreateDepthResources();
-	CreateColorResources();
+	// The attachments do not depend on the swap chain images themselves, only on their size and format
+	if (_swapChainExtent.width != previousExtent.width || _swapChainExtent.height != previousExtent.height || _swapChainImageFormat != previousFormat)
+	{
+		CleanupAttachments();
+		CleanupDepthPyramid();
+		CreateDepthResources();
+		CreateColorResources();
+		CreateDepthResolveResources();
+		CreateDepthPyramid();
+		WriteDepthPyramidDescriptors();
+	}
 	CreateFrameBuffers();
+	CreatePresentAcquireCommandBuffers();
+	// Recorded buffers reference the old framebuffers, and the number of images may have changed
+	CleanupCommandBuffers();
+	CreateCommandBuffers();
+	CreateRecordingCommandBuffers();
 
 	SetupCamera();
 }
 
+void RenderLoop::SetOcclusionCulling(const bool& occlusionCulling)
+{
+	if (occlusionCulling == _occlusionCulling)
+		return;
+
+	// The multisampled attachments only have to outlive a render pass with occlusion culling, the framebuffers and every recorded
+	// command buffer reference them
+	vkDeviceWaitIdle(_device);
+	_occlusionCulling = occlusionCulling;
+	for (const auto framebuffer : _swapChainFrameBuffers)
+	{
+		vkDestroyFramebuffer(_device, framebuffer, nullptr);
+	}
+	CleanupMultisampledAttachments();
+	CreateDepthResources();
+	CreateColorResources();
+	CreateFrameBuffers();
+	++_sceneRevision;
+}
+
 void RenderLoop::PopulateDebugMessengerCreateInfo(VkDebugUtilsMessengerCreateInfoEXT& createInfo)
 {
 	createInfo.sType = VK_STRUCTURE_TYPE_DEBUG_UTILS_MESSENGER_CREATE_INFO_EXT;
@@ -1211,56 +2221,138 @@ VkShaderModule RenderLoop::CreateShaderModule(const std::vector<char>& shaderCod
 	return shaderModule;
 }
 
-void RenderLoop::CreateBuffer(const VkDeviceSize& size, const VkBufferUsageFlags& usage, const VkMemoryPropertyFlags& properties, VkBuffer& buffer, VkDeviceMemory& bufferMemory) const
+void RenderLoop::CreateBuffer(const VkDeviceSize& size, const VkBufferUsageFlags& usage, const VkMemoryPropertyFlags& properties, VkBuffer& buffer, FHEAllocation& bufferAllocation, const FHEMemoryCategory& category, const VkSharingMode& sharingMode, const FHEMemoryLifetime& lifetime) const
 {
 	VkBufferCreateInfo bufferInfo{};
 	bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
 	bufferInfo.size = size;
 	bufferInfo.usage = usage;
-	// May need to change if not all buffers need to be concurrent
-	bufferInfo.sharingMode = VK_SHARING_MODE_CONCURRENT;
-	std::vector<uint32_t> queueFamilyIndices{};
-	GetUniqueQueueFamilyIndices(FindQueueFamilies(_physicalDevice), queueFamilyIndices);
-	bufferInfo.queueFamilyIndexCount = static_cast<uint32_t>(queueFamilyIndices.size());
-	bufferInfo.pQueueFamilyIndices = queueFamilyIndices.data();
+	// Exclusive buffers change hands between queue families through explicit ownership transfers
+	bufferInfo.sharingMode = sharingMode;
+	if (sharingMode == VK_SHARING_MODE_CONCURRENT)
+	{
+		bufferInfo.queueFamilyIndexCount = static_cast<uint32_t>(_concurrentQueueFamilies.size());
+		bufferInfo.pQueueFamilyIndices = _concurrentQueueFamilies.data();
+	}
 
 	if (vkCreateBuffer(_device, &bufferInfo, nullptr, &buffer) != VK_SUCCESS)
 		throw std::runtime_error("Failed to create buffer!");
 
+	_memoryAllocator->AllocateBufferMemory(buffer, properties, lifetime, category, bufferAllocation);
+}
 
-	VkMemoryRequirements memoryRequirements;
-	vkGetBufferMemoryRequirements(_device, buffer, &memoryRequirements);
+void RenderLoop::CopyBuffer(const VkBuffer& srcBuffer, const VkBuffer& dstBuffer, const VkDeviceSize& size, const VkDeviceSize& srcOffset, const VkDeviceSize& dstOffset) const
+{
+	VkBufferCopy copyRegion{};
+	copyRegion.srcOffset = srcOffset;
+	copyRegion.dstOffset = dstOffset;
+	copyRegion.size = size;
+	vkCmdCopyBuffer(_uploadContext->GetCommandBuffer(), srcBuffer, dstBuffer, 1, &copyRegion);
+}
+
+void RenderLoop::RequestModelGeometry(Model& model, const std::string& filePath)
+{
+	model.resident = false;
+	model.geometryFailed = false;
+	++_sceneRevision;
+
+	Model* target = &model;
+	_jobSystem->Submit([this, target, filePath]()
+		{
+			// The mesh stays mapped, the main thread stages it through the ring as space frees up
+			GeometryUpload upload{};
+			upload.model = target;
+			try
+			{
+				upload.mesh = MeshCache::Load(filePath);
+			}
+			catch (const std::exception& e)
+			{
+				upload.error = filePath + ": " + e.what();
+			}
+			catch (...)
+			{
+				upload.error = filePath + ": unknown error";
+			}
 
-	VkMemoryAllocateInfo allocInfo{};
-	allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-	allocInfo.allocationSize = memoryRequirements.size;
-	allocInfo.memoryTypeIndex = FindMemoryType(memoryRequirements.memoryTypeBits, properties);
+			std::lock_guard lock(_streamedGeometryMutex);
+			_streamedGeometry.push_back(std::move(upload));
+		});
+}
 
-	if (vkAllocateMemory(_device, &allocInfo, nullptr, &bufferMemory) != VK_SUCCESS)
-		throw std::runtime_error("Failed to allocate buffer memory!");
+void RenderLoop::PlaceModelGeometry(Model& model)
+{
+	const VkDeviceSize vertexStride = VertexLayout::GetStride(model.mesh.vertexLayout);
+	const VkDeviceSize vertexSize = vertexStride * model.mesh.vertexCount;
+	const VkDeviceSize indexSize = static_cast<VkDeviceSize>(model.mesh.indexSize) * model.mesh.indexCount;
+
+	// Aligning to the element size lets the ranges be addressed by vertexOffset and firstIndex with both buffers bound at 0
+	model.vertexArenaOffset = AllocateGeometry(_vertexBuffer, _vertexBufferAllocation, _vertexArena, vertexSize, vertexStride, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT);
+	model.indexArenaOffset = AllocateGeometry(_indexBuffer, _indexBufferAllocation, _indexArena, indexSize, model.mesh.indexSize, VK_BUFFER_USAGE_INDEX_BUFFER_BIT);
+	model.vertexOffset = static_cast<int32_t>(model.vertexArenaOffset / vertexStride);
+	model.firstIndex = static_cast<uint32_t>(model.indexArenaOffset / model.mesh.indexSize);
+	model.indexType = model.mesh.indexSize == sizeof(uint16_t) ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32;
+}
 
-	vkBindBufferMemory(_device, buffer, bufferMemory, 0);
+void RenderLoop::FreeModelGeometry(Model& model)
+{
+	// The caller must make sure no frame in flight still draws the model
+	_vertexArena.Free(model.vertexArenaOffset);
+	_indexArena.Free(model.indexArenaOffset);
+	model.vertexOffset = 0;
+	model.firstIndex = 0;
+	model.resident = false;
+	++_sceneRevision;
 }
 
-void RenderLoop::CopyBuffer(const VkBuffer& srcBuffer, const VkBuffer& dstBuffer, const VkDeviceSize& size) const
+VkDeviceSize RenderLoop::AllocateGeometry(VkBuffer& buffer, FHEAllocation& bufferAllocation, RangeAllocator& arena, const VkDeviceSize& size, const VkDeviceSize& alignment, const VkBufferUsageFlags& usage)
 {
-	VkCommandBuffer commandBuffer;
-	BeginSingleTimeCommand(commandBuffer);
+	uint64_t offset;
+	if (arena.Allocate(size, alignment, offset))
+		return offset;
 
-	VkBufferCopy copyRegion{};
-	copyRegion.srcOffset = 0;
-	copyRegion.dstOffset = 0;
-	copyRegion.size = size;
-	vkCmdCopyBuffer(commandBuffer, srcBuffer, dstBuffer, 1, &copyRegion);
+	GrowGeometryBuffer(buffer, bufferAllocation, arena, std::max(arena.GetSize() * 2, arena.GetRequiredSize(size, alignment)), usage);
+	if (!arena.Allocate(size, alignment, offset))
+		throw std::runtime_error("Failed to allocate from the geometry arena!");
 
-	EndSingleTimeCommands(commandBuffer);
+	return offset;
 }
 
-void RenderLoop::CopyBufferToImage(const VkBuffer& buffer, const VkImage& image, const uint32_t& width, const uint32_t& height) const
+void RenderLoop::GrowGeometryBuffer(VkBuffer& buffer, FHEAllocation& bufferAllocation, RangeAllocator& arena, const VkDeviceSize& newSize, const VkBufferUsageFlags& usage)
 {
-	VkCommandBuffer commandBuffer;
-	BeginSingleTimeCommand(commandBuffer);
+	VkBuffer newBuffer;
+	FHEAllocation newBufferAllocation;
+	// Transfer source as well, so the arena can be copied over again when it next grows. When exclusive, it belongs to the graphics family and streamed ranges are handed over explicitly.
+	CreateBuffer(newSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | usage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, newBuffer, newBufferAllocation, FHE_MEMORY_CATEGORY_MESH, _defaultSharingMode);
+
+	if (buffer != nullptr)
+	{
+		// Frames in flight may still read the old buffer. Growing is rare enough that waiting for them is fine.
+		vkDeviceWaitIdle(_device);
+
+		// With the device idle every submitted upload has completed, their ranges have to be acquired before the copy reads them
+		(void)RecordGeometryAcquires(_uploadContext->GetCommandBuffer());
+		CopyBuffer(buffer, newBuffer, arena.GetSize());
 
+		// Uploads placed after this point are written by the transfer queue, the copy must not land on top of them
+		WaitForUploads(SubmitUploads());
+
+		vkDestroyBuffer(_device, buffer, nullptr);
+		_memoryAllocator->Free(bufferAllocation);
+	}
+
+	buffer = newBuffer;
+	bufferAllocation = newBufferAllocation;
+	arena.Grow(newSize);
+	++_sceneRevision;
+
+	// Chunks of unfinished uploads went to the old buffer without being handed over, so they start again
+	for (auto& upload : _geometryUploadsInProgress)
+		upload.stagedSize = 0;
+}
+
+void RenderLoop::CopyBufferToImage(const VkBuffer& buffer, const VkImage& image, const uint32_t& width, const uint32_t& height) const
+{
 	VkBufferImageCopy region{};
 	region.bufferOffset = 0;
 	region.bufferRowLength = 0;
@@ -1278,24 +2370,184 @@ void RenderLoop::CopyBufferToImage(const VkBuffer& buffer, const VkImage& image,
 		1
 	};
 
-	vkCmdCopyBufferToImage(commandBuffer, buffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+	vkCmdCopyBufferToImage(_uploadContext->GetCommandBuffer(), buffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+}
 
-	EndSingleTimeCommands(commandBuffer);
+void RenderLoop::RecordAnimation(const VkCommandBuffer& commandBuffer) const
+{
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, _animationPipeline);
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, _animationPipelineLayout, 0, 1, &_descriptorSets[_currentFrame], 0, nullptr);
+	vkCmdDispatch(commandBuffer, (_instanceCount + ANIMATION_GROUP_SIZE - 1) / ANIMATION_GROUP_SIZE, 1, 1);
+
+	std::array<VkBufferMemoryBarrier, 2> barriers{};
+	barriers[0].sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+	barriers[0].srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+	barriers[0].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+	barriers[0].srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barriers[0].dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barriers[0].buffer = _transformBuffer;
+	barriers[0].offset = _currentFrame * _transformRegionSize;
+	barriers[0].size = _transformBufferSize;
+	// The angles carry over to the next frame's dispatch
+	barriers[1] = barriers[0];
+	barriers[1].dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+	barriers[1].buffer = _animationBuffer;
+	barriers[1].offset = 0;
+	barriers[1].size = VK_WHOLE_SIZE;
+
+	// Culling reads the transforms as well
+	vkCmdPipelineBarrier(
+		commandBuffer,
+		VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT,
+		0,
+		0, nullptr,
+		static_cast<uint32_t>(barriers.size()), barriers.data(),
+		0, nullptr
+	);
 }
 
-void RenderLoop::CopyTransformsToDevice()
+void RenderLoop::RecordDrawCopy(const VkCommandBuffer& commandBuffer, const uint32_t& drawCount) const
 {
-	size_t offset = 0;
-	for (auto model = _modelTransforms.begin(); model != _modelTransforms.end(); ++model)
+	const VkDeviceSize regionOffset = _currentFrame * _drawRegionSize;
+
+	// Counts of slices left out this time are copied too, they are simply never read
+	std::array<VkBufferCopy, 4> copyRegions{};
+	copyRegions[0].srcOffset = regionOffset;
+	copyRegions[0].dstOffset = regionOffset;
+	copyRegions[0].size = _drawCommandOffset;
+	copyRegions[1].srcOffset = regionOffset + _drawCommandOffset;
+	copyRegions[1].dstOffset = regionOffset + _drawCommandOffset;
+	copyRegions[1].size = drawCount * sizeof(VkDrawIndexedIndirectCommand);
+	copyRegions[2].srcOffset = regionOffset + _lateDrawCommandOffset;
+	copyRegions[2].dstOffset = regionOffset + _lateDrawCommandOffset;
+	copyRegions[2].size = drawCount * sizeof(VkDrawIndexedIndirectCommand);
+	copyRegions[3].srcOffset = regionOffset + _drawDataOffset;
+	copyRegions[3].dstOffset = regionOffset + _drawDataOffset;
+	copyRegions[3].size = drawCount * sizeof(DrawData);
+	vkCmdCopyBuffer(commandBuffer, _drawStagingBuffer, _drawBuffer, drawCount > 0 ? 4 : 1, copyRegions.data());
+
+	// Culling accumulates into the statistics, a cached command buffer has to start them over every time it executes
+	const VkDeviceSize statisticsOffset = _currentFrame * _cullStatisticsRegionSize;
+	vkCmdFillBuffer(commandBuffer, _cullStatisticsBuffer, statisticsOffset, sizeof(CullStatistics), 0);
+
+	std::array<VkBufferMemoryBarrier, 2> barriers{};
+	barriers[0].sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+	barriers[0].srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	barriers[0].dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_INDIRECT_COMMAND_READ_BIT;
+	barriers[0].srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barriers[0].dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barriers[0].buffer = _drawBuffer;
+	barriers[0].offset = regionOffset;
+	barriers[0].size = _drawRegionSize;
+	barriers[1] = barriers[0];
+	barriers[1].dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+	barriers[1].buffer = _cullStatisticsBuffer;
+	barriers[1].offset = statisticsOffset;
+	barriers[1].size = sizeof(CullStatistics);
+
+	vkCmdPipelineBarrier(
+		commandBuffer,
+		VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT,
+		0,
+		0, nullptr,
+		static_cast<uint32_t>(barriers.size()), barriers.data(),
+		0, nullptr
+	);
+}
+
+void RenderLoop::RecordCulling(const VkCommandBuffer& commandBuffer, const uint32_t& drawCount, const uint32_t& phase) const
+{
+	if (drawCount == 0)
+		return;
+
+	// The previous frame's late phase wrote the visibility both phases read
+	if (phase == 0)
+	{
+		VkMemoryBarrier visibilityBarrier{};
+		visibilityBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		visibilityBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+		visibilityBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &visibilityBarrier, 0, nullptr, 0, nullptr);
+	}
+
+	const uint32_t previousFrame = (_currentFrame + MAX_FRAMES_IN_FLIGHT - 1) % MAX_FRAMES_IN_FLIGHT;
+	const std::array<uint32_t, 4> cullPhase = { phase, _occlusionCulling ? 1u : 0u, _currentFrame * _instanceCount, previousFrame * _instanceCount };
+
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, _cullPipeline);
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, _cullPipelineLayout, 0, 1, &_descriptorSets[_currentFrame], 0, nullptr);
+	vkCmdPushConstants(commandBuffer, _cullPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, static_cast<uint32_t>(cullPhase.size() * sizeof(uint32_t)), cullPhase.data());
+	// One workgroup per record
+	vkCmdDispatch(commandBuffer, drawCount, 1, 1);
+
+	std::array<VkBufferMemoryBarrier, 3> barriers{};
+	barriers[0].sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+	barriers[0].srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+	barriers[0].dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT;
+	barriers[0].srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barriers[0].dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barriers[0].buffer = _drawBuffer;
+	barriers[0].offset = _currentFrame * _drawRegionSize + (phase == 0 ? _drawCommandOffset : _lateDrawCommandOffset);
+	barriers[0].size = drawCount * sizeof(VkDrawIndexedIndirectCommand);
+	barriers[1].sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+	barriers[1].srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+	barriers[1].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+	barriers[1].srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barriers[1].dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barriers[1].buffer = _visibleInstanceBuffer;
+	barriers[1].offset = _currentFrame * _visibleInstanceRegionSize + phase * static_cast<VkDeviceSize>(_instanceCount) * sizeof(uint32_t);
+	barriers[1].size = static_cast<VkDeviceSize>(_instanceCount) * sizeof(uint32_t);
+	// The late phase adds to the early phase's counts, the host reads them once the frame's fence signaled
+	barriers[2].sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+	barriers[2].srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+	barriers[2].dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_HOST_READ_BIT;
+	barriers[2].srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barriers[2].dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barriers[2].buffer = _cullStatisticsBuffer;
+	barriers[2].offset = _currentFrame * _cullStatisticsRegionSize;
+	barriers[2].size = sizeof(CullStatistics);
+
+	vkCmdPipelineBarrier(
+		commandBuffer,
+		VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_HOST_BIT,
+		0,
+		0, nullptr,
+		static_cast<uint32_t>(barriers.size()), barriers.data(),
+		0, nullptr
+	);
+}
+
+void RenderLoop::RecordDepthPyramid(const VkCommandBuffer& commandBuffer) const
+{
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, _depthPyramidPipeline);
+
+	VkImageMemoryBarrier barrier{};
+	barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+	barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+	barrier.oldLayout = VK_IMAGE_LAYOUT_GENERAL;
+	barrier.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.image = _depthPyramid;
+	barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	barrier.subresourceRange.levelCount = 1;
+	barrier.subresourceRange.baseArrayLayer = 0;
+	barrier.subresourceRange.layerCount = 1;
+
+	// Each level waits for the one it reduces, the last barrier hands the whole pyramid to the late cull
+	for (uint32_t level = 0; level < static_cast<uint32_t>(_depthPyramidSets.size()); ++level)
 	{
-		const size_t innerSize = model->second->size() * sizeof(glm::mat4);
-		memcpy(static_cast<char*>(_transformStagingData) + offset, model->second->data(), innerSize);
-		offset += innerSize;
+		const uint32_t width = std::max(1u, _depthPyramidExtent.width >> level);
+		const uint32_t height = std::max(1u, _depthPyramidExtent.height >> level);
+		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, _depthPyramidPipelineLayout, 0, 1, &_depthPyramidSets[level], 0, nullptr);
+		vkCmdDispatch(commandBuffer, (width + DEPTH_PYRAMID_GROUP_SIZE - 1) / DEPTH_PYRAMID_GROUP_SIZE, (height + DEPTH_PYRAMID_GROUP_SIZE - 1) / DEPTH_PYRAMID_GROUP_SIZE, 1);
+
+		barrier.subresourceRange.baseMipLevel = level;
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
 	}
-	CopyBuffer(_transformStagingBuffer, _transformBuffer, _transformBufferSize);
 }
 
-void RenderLoop::CreateImage(const uint32_t& width, const uint32_t& height, const uint32_t& mipLevels, const VkSampleCountFlagBits& numSample, const VkFormat& format, const VkImageTiling& tiling, const VkImageUsageFlags& usage, const VkMemoryPropertyFlags& properties, VkImage& image, VkDeviceMemory& imageMemory) const
+void RenderLoop::CreateImage(const uint32_t& width, const uint32_t& height, const uint32_t& mipLevels, const VkSampleCountFlagBits& numSample, const VkFormat& format, const VkImageTiling& tiling, const VkImageUsageFlags& usage, const VkMemoryPropertyFlags& properties, VkImage& image, FHEAllocation& imageAllocation, const FHEMemoryCategory& category, const VkMemoryPropertyFlags& preferredProperties) const
 {
 	VkImageCreateInfo imageInfo{};
 	imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
@@ -1315,21 +2567,10 @@ void RenderLoop::CreateImage(const uint32_t& width, const uint32_t& height, cons
 	if (vkCreateImage(_device, &imageInfo, nullptr, &image) != VK_SUCCESS)
 		throw std::runtime_error("Failed to create image!");
 
-	VkMemoryRequirements memoryRequirements;
-	vkGetImageMemoryRequirements(_device, image, &memoryRequirements);
-
-	VkMemoryAllocateInfo allocInfo{};
-	allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-	allocInfo.allocationSize = memoryRequirements.size;
-	allocInfo.memoryTypeIndex = FindMemoryType(memoryRequirements.memoryTypeBits, properties);
-
-	if (vkAllocateMemory(_device, &allocInfo, nullptr, &imageMemory) != VK_SUCCESS)
-		throw std::runtime_error("Failed to allocate image memory!");
-
-	vkBindImageMemory(_device, image, imageMemory, 0);
+	_memoryAllocator->AllocateImageMemory(image, tiling, properties, category, imageAllocation, preferredProperties);
 }
 
-void RenderLoop::CreateImageView(const VkImage& image, const VkFormat& format, const VkImageAspectFlags& aspectFlags, const uint32_t& mipLevels, VkImageView& imageView) const
+void RenderLoop::CreateImageView(const VkImage& image, const VkFormat& format, const VkImageAspectFlags& aspectFlags, const uint32_t& mipLevels, VkImageView& imageView, const uint32_t& baseMipLevel) const
 {
 	VkImageViewCreateInfo viewInfo{};
 	viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
@@ -1337,8 +2578,7 @@ void RenderLoop::CreateImageView(const VkImage& image, const VkFormat& format, c
 	viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
 	viewInfo.format = format;
 	viewInfo.subresourceRange.aspectMask = aspectFlags;
-	// ReSharper disable once CppAssignedValueIsNeverUsed
-	viewInfo.subresourceRange.baseMipLevel = 0;
+	viewInfo.subresourceRange.baseMipLevel = baseMipLevel;
 	viewInfo.subresourceRange.levelCount = mipLevels;
 	viewInfo.subresourceRange.baseArrayLayer = 0;
 	viewInfo.subresourceRange.layerCount = 1;
@@ -1347,56 +2587,281 @@ void RenderLoop::CreateImageView(const VkImage& image, const VkFormat& format, c
 		throw std::runtime_error("Failed to create image view!");
 }
 
-void RenderLoop::LoadTexture(std::string filePath, VkImageView& targetView, ktxVulkanTexture& targetTexture, const VkImageTiling& tiling, const VkImageUsageFlags& usage, const VkImageLayout& layout, const ktxTextureCreateFlagBits& createFlags) const
+void RenderLoop::LoadTextures(const std::vector<std::string>& filePaths, const std::vector<FHEImage*>& targets)
 {
-	ktxTexture* kTexture;
-	ktxVulkanDeviceInfo vulkanDeviceInfo;
-	if (ktxVulkanDeviceInfo_Construct(&vulkanDeviceInfo, _physicalDevice, _device, _graphicsQueue, _commandPool, nullptr) != KTX_error_code::KTX_SUCCESS)
-		throw std::runtime_error("Could not construct vulkan device for the creation of KTX textures!");
-	vulkanDeviceInfo.instance = _instance;
+	const auto startTime = std::chrono::high_resolution_clock::now();
 
-	if (filePath.find('.') == std::string::npos)
-		throw std::runtime_error("Could not load a texture, because the filePath was invalid!");
+	// Reading and decoding dominates, so the files are spread over the workers
+	std::vector<ktxTexture*> textures(filePaths.size(), nullptr);
+	try
+	{
+		// Basis transcoding happens here as well
+		_jobSystem->Dispatch(static_cast<uint32_t>(filePaths.size()), [this, &filePaths, &textures](const uint32_t index)
+			{
+				textures[index] = TextureImporter::Load(filePaths[index], _textureCompression);
+			});
+	}
+	catch (...)
+	{
+		for (const auto texture : textures)
+		{
+			if (texture != nullptr)
+				ktxTexture_Destroy(texture);
+		}
+		throw;
+	}
 
-	filePath = filePath.substr(0, filePath.find_last_of('.'));
-	filePath.append(".ktx");
-	if (ktxTexture_CreateFromNamedFile(filePath.c_str(), createFlags, &kTexture) != KTX_error_code::KTX_SUCCESS)
-		throw std::runtime_error("Failed to create the texture from given file path!");
+	// Files with a stored chain start out with only their small levels resident, the rest is streamed in by UpdateTextureStreaming
+	std::vector<uint32_t> baseLevels(textures.size(), 0);
+	for (size_t i = 0; i < textures.size(); ++i)
+	{
+		if (textures[i]->numDimensions != 2 || textures[i]->isArray || textures[i]->isCubemap)
+			throw std::runtime_error("Only 2D textures are supported: " + filePaths[i]);
 
-	kTexture->generateMipmaps = true;
+		while (baseLevels[i] + 1 < textures[i]->numLevels && std::max(textures[i]->baseWidth, textures[i]->baseHeight) >> baseLevels[i] > TEXTURE_STREAMING_INITIAL_EXTENT)
+			++baseLevels[i];
+	}
 
-	if (ktxTexture_VkUploadEx(kTexture, &vulkanDeviceInfo, &targetTexture, tiling, usage, layout))
-		throw std::runtime_error("Failed to upload texture to the device! (consider checking the encoding format on the relevant .ktx file)");
+	// Files with a single level get their chain generated by blits, as long as the format can be filtered and blitted.
+	// Block-compressed formats cannot be blitted, so those rely on the mip chain stored in the file.
+	std::vector<bool> generateMipmaps(textures.size());
+	for (size_t i = 0; i < textures.size(); ++i)
+	{
+		FHEImage& target = *targets[i];
+		target.format = ktxTexture_GetVkFormat(textures[i]);
 
-	ktxTexture_Destroy(kTexture);
-	ktxVulkanDeviceInfo_Destruct(&vulkanDeviceInfo);
+		VkFormatProperties formatProperties;
+		vkGetPhysicalDeviceFormatProperties(_physicalDevice, target.format, &formatProperties);
+		const VkFormatFeatureFlags blitFeatures = VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+		generateMipmaps[i] = textures[i]->numLevels == 1 && (formatProperties.optimalTilingFeatures & blitFeatures) == blitFeatures;
 
-	VkImageViewCreateInfo viewInfo{};
-	viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
-	viewInfo.components = {
-		VK_COMPONENT_SWIZZLE_R, VK_COMPONENT_SWIZZLE_G,
-		VK_COMPONENT_SWIZZLE_B, VK_COMPONENT_SWIZZLE_A
-	};
-	viewInfo.image = targetTexture.image;
-	viewInfo.format = targetTexture.imageFormat;
-	viewInfo.viewType = targetTexture.viewType;
-	viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-	viewInfo.subresourceRange.layerCount = targetTexture.layerCount;
-	viewInfo.subresourceRange.levelCount = targetTexture.levelCount;
-	viewInfo.subresourceRange.baseMipLevel = 0;
-	viewInfo.subresourceRange.baseArrayLayer = 0;
+		target.levelCount = generateMipmaps[i]
+			? static_cast<uint32_t>(std::floor(std::log2(std::max(textures[i]->baseWidth, textures[i]->baseHeight)))) + 1
+			: textures[i]->numLevels - baseLevels[i];
+
+		CreateImage(std::max(1u, textures[i]->baseWidth >> baseLevels[i]), std::max(1u, textures[i]->baseHeight >> baseLevels[i]), target.levelCount, VK_SAMPLE_COUNT_1_BIT, target.format, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, target.image, target.allocation, FHE_MEMORY_CATEGORY_TEXTURE);
+	}
+
+	VkCommandBuffer commandBuffer = _uploadContext->GetCommandBuffer();
+
+	VkImageMemoryBarrier barrier{};
+	barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	barrier.subresourceRange.baseArrayLayer = 0;
+	barrier.subresourceRange.layerCount = 1;
+
+	std::vector<VkImageMemoryBarrier> barriers;
+	for (const auto target : targets)
+	{
+		barrier.image = target->image;
+		barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+		barrier.srcAccessMask = 0;
+		barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.subresourceRange.baseMipLevel = 0;
+		barrier.subresourceRange.levelCount = target->levelCount;
+		barriers.push_back(barrier);
+	}
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, static_cast<uint32_t>(barriers.size()), barriers.data());
+
+	// Every resident level goes through the staging ring, which is flushed whenever it fills up
+	VkDeviceSize stagedSize = 0;
+	for (size_t i = 0; i < textures.size(); ++i)
+	{
+		for (uint32_t level = baseLevels[i]; level < textures[i]->numLevels; ++level)
+		{
+			StageTextureLevel(textures[i], level, targets[i]->image, level - baseLevels[i]);
+			stagedSize += ktxTexture_GetImageSize(textures[i], level);
+		}
+	}
+	// Flushing the ring moves recording on to a new command buffer
+	commandBuffer = _uploadContext->GetCommandBuffer();
+
+	// Each level is blitted from the previous one, which is moved to shader read once it has served as the source
+	barriers.clear();
+	for (size_t i = 0; i < textures.size(); ++i)
+	{
+		barrier.image = targets[i]->image;
+		barrier.subresourceRange.levelCount = 1;
+
+		int32_t mipWidth = static_cast<int32_t>(textures[i]->baseWidth);
+		int32_t mipHeight = static_cast<int32_t>(textures[i]->baseHeight);
+		for (uint32_t level = 1; generateMipmaps[i] && level < targets[i]->levelCount; ++level)
+		{
+			barrier.subresourceRange.baseMipLevel = level - 1;
+			barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+			barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+			barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+			barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+			vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+			VkImageBlit blit{};
+			blit.srcOffsets[0] = { 0, 0, 0 };
+			blit.srcOffsets[1] = { mipWidth, mipHeight, 1 };
+			blit.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+			blit.srcSubresource.mipLevel = level - 1;
+			blit.srcSubresource.baseArrayLayer = 0;
+			blit.srcSubresource.layerCount = 1;
+			mipWidth = std::max(1, mipWidth / 2);
+			mipHeight = std::max(1, mipHeight / 2);
+			blit.dstOffsets[0] = { 0, 0, 0 };
+			blit.dstOffsets[1] = { mipWidth, mipHeight, 1 };
+			blit.dstSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+			blit.dstSubresource.mipLevel = level;
+			blit.dstSubresource.baseArrayLayer = 0;
+			blit.dstSubresource.layerCount = 1;
+			vkCmdBlitImage(commandBuffer, targets[i]->image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, targets[i]->image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &blit, VK_FILTER_LINEAR);
+
+			barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+			barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+			barrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+			barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+			barriers.push_back(barrier);
+		}
+
+		// Whatever is still a transfer destination: the last generated level, or every level loaded from the file
+		const uint32_t firstRemainingLevel = generateMipmaps[i] ? targets[i]->levelCount - 1 : 0;
+		barrier.subresourceRange.baseMipLevel = firstRemainingLevel;
+		barrier.subresourceRange.levelCount = targets[i]->levelCount - firstRemainingLevel;
+		barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+		barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+		barriers.push_back(barrier);
+	}
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr, 0, nullptr, static_cast<uint32_t>(barriers.size()), barriers.data());
+
+	// Nothing waits for the uploads here, the first frame that samples the textures waits on the upload timeline
+	(void)SubmitUploads();
 
-	if (vkCreateImageView(_device, &viewInfo, nullptr, &targetView))
-		throw std::runtime_error("Failed to create an image view for a texture!");
+	for (size_t i = 0; i < textures.size(); ++i)
+	{
+		CreateImageView(targets[i]->image, targets[i]->format, VK_IMAGE_ASPECT_COLOR_BIT, targets[i]->levelCount, targets[i]->view);
+
+		if (textures[i]->numLevels == 1)
+		{
+			ktxTexture_Destroy(textures[i]);
+			continue;
+		}
+
+		VkMemoryRequirements memoryRequirements;
+		vkGetImageMemoryRequirements(_device, targets[i]->image, &memoryRequirements);
+
+		TextureStreamState& stream = _textureStreams[targets[i]];
+		stream.source = textures[i];
+		stream.residentLevel = baseLevels[i];
+		stream.desiredLevel = baseLevels[i];
+		stream.residentSize = memoryRequirements.size;
+	}
+
+	const auto endTime = std::chrono::high_resolution_clock::now();
+	printf("Loaded %zu textures (%.2f ms, %.2f MiB staged)\n", textures.size(), std::chrono::duration<float, std::chrono::milliseconds::period>(endTime - startTime).count(), static_cast<float>(stagedSize) / (1024.f * 1024.f));
+}
+
+void RenderLoop::StageTextureLevel(ktxTexture* source, const uint32_t& level, const VkImage& image, const uint32_t& mipLevel)
+{
+	ktx_size_t levelOffset;
+	ktxTexture_GetImageOffset(source, level, 0, 0, &levelOffset);
+	const uint8_t* levelData = ktxTexture_GetData(source) + levelOffset;
+	const VkDeviceSize levelSize = ktxTexture_GetImageSize(source, level);
+	const uint32_t width = std::max(1u, source->baseWidth >> level);
+	const uint32_t height = std::max(1u, source->baseHeight >> level);
+
+	const VkDeviceSize alignment = GetTextureStagingAlignment(source);
+	const VkDeviceSize elementSize = ktxTexture_GetElementSize(source);
+
+	// KTX1 pads every row to 4 bytes, KTX2 stores them tightly. Block-compressed rows are always a multiple of 4 bytes already.
+	const VkDeviceSize rowSize = source->isCompressed ? ktxTexture_GetRowPitch(source, level) : width * elementSize;
+	const VkDeviceSize storedPitch = source->classId == ktxTexture1_c ? ktxTexture_GetRowPitch(source, level) : rowSize;
+	// The copy addresses rows in whole texels, padding that is not a multiple of the texel size (RGB8) is stripped while staging
+	const VkDeviceSize rowPitch = storedPitch % elementSize == 0 ? storedPitch : rowSize;
+	const uint32_t bufferRowLength = source->isCompressed ? 0 : static_cast<uint32_t>(rowPitch / elementSize);
+
+	// Levels are split along rows of texel blocks, so one larger than the ring can still go through it a piece at a time.
+	// Only levels that large are ever split, and at those sizes the block height follows exactly from the row count.
+	const uint32_t blockRowCount = static_cast<uint32_t>(levelSize / storedPitch);
+	const uint32_t blockHeight = (height + blockRowCount - 1) / blockRowCount;
+	if (rowPitch + alignment > _stagingRing.GetSize())
+		throw std::runtime_error("A texture row does not fit the staging ring!");
+
+	uint32_t blockRow = 0;
+	while (blockRow < blockRowCount)
+	{
+		const uint32_t remainingRows = blockRowCount - blockRow;
+		const uint32_t fittingRows = static_cast<uint32_t>(std::min<VkDeviceSize>(remainingRows, _stagingRing.GetAvailableSize(alignment) / rowPitch));
+		// Whole levels that fit the ring are never split, they wait for it to drain instead
+		const uint32_t rowCount = levelSize <= _stagingRing.GetSize() - alignment && fittingRows < remainingRows ? 0 : fittingRows;
+		uint64_t stagingOffset;
+		if (rowCount == 0 || !_stagingRing.Allocate(rowCount * rowPitch, alignment, stagingOffset))
+		{
+			FlushStagingRing();
+			continue;
+		}
+
+		uint8_t* staging = static_cast<uint8_t*>(_stagingRingAllocation.mapped) + stagingOffset;
+		if (rowPitch == storedPitch)
+			memcpy(staging, levelData + blockRow * storedPitch, rowCount * rowPitch);
+		else
+		{
+			for (uint32_t row = 0; row < rowCount; ++row)
+				memcpy(staging + row * rowPitch, levelData + (blockRow + row) * storedPitch, rowSize);
+		}
+
+		const uint32_t y = blockRow * blockHeight;
+		VkBufferImageCopy region{};
+		region.bufferOffset = stagingOffset;
+		region.bufferRowLength = bufferRowLength;
+		region.bufferImageHeight = 0;
+		region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		region.imageSubresource.mipLevel = mipLevel;
+		region.imageSubresource.baseArrayLayer = 0;
+		region.imageSubresource.layerCount = 1;
+		region.imageOffset = { 0, static_cast<int32_t>(y), 0 };
+		region.imageExtent = { width, std::min(rowCount * blockHeight, height - y), 1 };
+		vkCmdCopyBufferToImage(_uploadContext->GetCommandBuffer(), _stagingRingBuffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+
+		blockRow += rowCount;
+	}
+}
+
+VkDeviceSize RenderLoop::GetTextureStagingAlignment(ktxTexture* source)
+{
+	return std::lcm<VkDeviceSize>(ktxTexture_GetElementSize(source), TEXTURE_COPY_OFFSET_ALIGNMENT);
+}
+
+void RenderLoop::FlushStagingRing()
+{
+	// Layouts and barriers recorded so far carry over, the copies simply continue in the next command buffer of the upload context
+	(void)SubmitUploads();
+	WaitForStagingSpace();
+}
+
+void RenderLoop::WaitForStagingSpace()
+{
+	// Everything submitted so far reads from the ring, once it has all completed the ring is empty again
+	_uploadContext->Wait(_uploadContext->GetSubmittedValue());
+	if (_transferTimelineValue > 0)
+	{
+		VkSemaphoreWaitInfo waitInfo{};
+		waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+		waitInfo.semaphoreCount = 1;
+		waitInfo.pSemaphores = &_transferTimeline;
+		waitInfo.pValues = &_transferTimelineValue;
+		vkWaitSemaphores(_device, &waitInfo, UINT64_MAX);
+	}
+
+	ReleaseCompletedTransfers();
+	ReleaseCompletedUploads();
+	FinishTextureResidencyChanges();
 }
 
 void RenderLoop::TransitionImageLayout(const VkImage& image, const VkFormat& format, const VkImageLayout& oldLayout, const VkImageLayout& newLayout, const
 	uint32_t& mipLevels) const
 {
-	VkCommandBuffer commandBuffer;
 	VkPipelineStageFlags sourceStage;
 	VkPipelineStageFlags destinationStage;
-	BeginSingleTimeCommand(commandBuffer);
 
 	VkImageMemoryBarrier barrier{};
 	barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
@@ -1434,7 +2899,7 @@ void RenderLoop::TransitionImageLayout(const VkImage& image, const VkFormat& for
 		barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
 
 		sourceStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
-		destinationStage = VK_ACCESS_SHADER_READ_BIT;
+		destinationStage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
 	}
 	else if (oldLayout == VK_IMAGE_LAYOUT_UNDEFINED && newLayout == VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL)
 	{
@@ -1444,86 +2909,82 @@ void RenderLoop::TransitionImageLayout(const VkImage& image, const VkFormat& for
 		sourceStage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
 		destinationStage = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
 	}
+	else if (oldLayout == VK_IMAGE_LAYOUT_UNDEFINED && newLayout == VK_IMAGE_LAYOUT_GENERAL)
+	{
+		barrier.srcAccessMask = 0;
+		barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+
+		sourceStage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+		destinationStage = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+	}
 	else
 		throw std::invalid_argument("Unsupported layout transition!");
 
 
 	vkCmdPipelineBarrier(
-		commandBuffer,
+		_uploadContext->GetCommandBuffer(),
 		sourceStage, destinationStage,
 		0,
 		0, nullptr,
 		0, nullptr,
 		1, &barrier
 	);
-
-	EndSingleTimeCommands(commandBuffer);
 }
 
 void RenderLoop::CreateSampler(FHEImage& image) const
 {
-	VkPhysicalDeviceProperties properties{};
-	vkGetPhysicalDeviceProperties(_physicalDevice, &properties);
+	const FHESamplerSettings& settings = image.samplerSettings;
+	const float maxAnisotropy = std::min(settings.maxAnisotropy, _maxSamplerAnisotropy);
 
 	VkSamplerCreateInfo samplerInfo{};
 	samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
-	// TODO: Add parameters for the filters
-	samplerInfo.magFilter = VK_FILTER_LINEAR;
-	samplerInfo.minFilter = VK_FILTER_LINEAR;
-	samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT;
-	samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+	samplerInfo.magFilter = settings.magFilter;
+	samplerInfo.minFilter = settings.minFilter;
+	samplerInfo.addressModeU = settings.addressModeU;
+	samplerInfo.addressModeV = settings.addressModeV;
 	samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT;
-	samplerInfo.anisotropyEnable = VK_TRUE;
-	samplerInfo.maxAnisotropy = properties.limits.maxSamplerAnisotropy;
+	samplerInfo.anisotropyEnable = maxAnisotropy > 1.f ? VK_TRUE : VK_FALSE;
+	// Disabled anisotropy ignores the value, zeroing it keeps those samplers under one cache key
+	samplerInfo.maxAnisotropy = maxAnisotropy > 1.f ? maxAnisotropy : 0.f;
 	samplerInfo.borderColor = VK_BORDER_COLOR_INT_OPAQUE_BLACK;
 	samplerInfo.unnormalizedCoordinates = VK_FALSE;
 	samplerInfo.compareEnable = VK_FALSE;
 	samplerInfo.compareOp = VK_COMPARE_OP_ALWAYS;
-	samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
+	samplerInfo.mipmapMode = settings.mipmapMode;
 	samplerInfo.mipLodBias = 0.f;
 	samplerInfo.minLod = 0.f;
-	samplerInfo.maxLod = static_cast<float>(image.texture.levelCount);
+	// Unclamped, the view limits sampling to whichever levels are resident
+	samplerInfo.maxLod = VK_LOD_CLAMP_NONE;
 
-	if (vkCreateSampler(_device, &samplerInfo, nullptr, &image.sampler) != VK_SUCCESS)
-		throw std::runtime_error("Failed to create texture sampler!");
+	image.sampler = _samplerCache->Acquire(samplerInfo);
 }
 
-void RenderLoop::BeginSingleTimeCommand(VkCommandBuffer& commandBuffer) const
+uint64_t RenderLoop::SubmitUploads()
 {
-	VkCommandBufferAllocateInfo allocInfo{};
-	allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-	allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-	allocInfo.commandPool = _commandPool;
-	allocInfo.commandBufferCount = 1;
-
-	vkAllocateCommandBuffers(_device, &allocInfo, &commandBuffer);
+	const uint64_t previousValue = _uploadContext->GetSubmittedValue();
+	const uint64_t value = _uploadContext->Submit();
+	if (value != previousValue)
+	{
+		// Ring space staged for the batch comes back once it completed
+		const uint64_t stagingBatch = _stagingRing.Submit();
+		_uploadDeletionQueue.emplace_back(value, [this, stagingBatch]()
+			{
+				_stagingRing.Release(stagingBatch);
+			});
+	}
 
-	VkCommandBufferBeginInfo beginInfo{};
-	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+	return value;
+}
 
-	vkBeginCommandBuffer(commandBuffer, &beginInfo);
+void RenderLoop::WaitForUploads(const uint64_t& value)
+{
+	_uploadContext->Wait(value);
+	ReleaseCompletedUploads();
 }
 
-void RenderLoop::EndSingleTimeCommands(const VkCommandBuffer& commandBuffer) const
+QueueFamilyIndices RenderLoop::FindQueueFamilies(const VkPhysicalDevice& physicalDevice) const
 {
-	vkEndCommandBuffer(commandBuffer);
-
-	VkSubmitInfo submitInfo{};
-	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-	submitInfo.commandBufferCount = 1;
-	submitInfo.pCommandBuffers = &commandBuffer;
-
-	vkQueueSubmit(_graphicsQueue, 1, &submitInfo, VK_NULL_HANDLE);
-	vkQueueWaitIdle(_graphicsQueue);
-
-	vkFreeCommandBuffers(_device, _commandPool, 1, &commandBuffer);
-}
-
-
-QueueFamilyIndices RenderLoop::FindQueueFamilies(const VkPhysicalDevice& physicalDevice) const
-{
-	QueueFamilyIndices indices;
+	QueueFamilyIndices indices;
 
 	uint32_t queueFamilyCount = 0;
 	vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, nullptr);
@@ -1533,7 +2994,8 @@ QueueFamilyIndices RenderLoop::FindQueueFamilies(const VkPhysicalDevice& physica
 	int i = 0;
 	for (const auto& queueFamily : queueFamilies)
 	{
-		if (queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT)
+		// Culling runs on the graphics queue right before the draws it feeds
+		if ((queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT) && (queueFamily.queueFlags & VK_QUEUE_COMPUTE_BIT))
 			indices.graphicsFamily = i;
 		else if (queueFamily.queueFlags & VK_QUEUE_TRANSFER_BIT)
 			indices.transferFamily = i;
@@ -1564,6 +3026,16 @@ void RenderLoop::GetUniqueQueueFamilyIndices(const QueueFamilyIndices& indices,
 	}
 }
 
+bool RenderLoop::NeedsPresentOwnershipTransfer() const
+{
+	return _defaultSharingMode == VK_SHARING_MODE_EXCLUSIVE && _graphicsQueueFamily != _presentQueueFamily;
+}
+
+bool RenderLoop::NeedsGeometryOwnershipTransfer() const
+{
+	return _defaultSharingMode == VK_SHARING_MODE_EXCLUSIVE && _transferQueueFamily != _graphicsQueueFamily;
+}
+
 int32_t RenderLoop::RateDeviceSuitability(const VkPhysicalDevice physicalDevice) const
 {
 	const QueueFamilyIndices indices = FindQueueFamilies(physicalDevice);
@@ -1583,6 +3055,28 @@ int32_t RenderLoop::RateDeviceSuitability(const VkPhysicalDevice physicalDevice)
 	// Required traits
 	VkPhysicalDeviceFeatures supportedFeatures;
 	vkGetPhysicalDeviceFeatures(physicalDevice, &supportedFeatures);
+	VkPhysicalDeviceVulkan12Features supportedVulkan12Features{};
+	supportedVulkan12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+	VkPhysicalDeviceVulkan11Features supportedVulkan11Features{};
+	supportedVulkan11Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_1_FEATURES;
+	supportedVulkan12Features.pNext = &supportedVulkan11Features;
+	VkPhysicalDeviceFeatures2 supportedFeatures2{};
+	supportedFeatures2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+	supportedFeatures2.pNext = &supportedVulkan12Features;
+	vkGetPhysicalDeviceFeatures2(physicalDevice, &supportedFeatures2);
+	const bool descriptorIndexingSupported = supportedVulkan12Features.runtimeDescriptorArray && supportedVulkan12Features.descriptorBindingPartiallyBound
+		&& supportedVulkan12Features.descriptorBindingSampledImageUpdateAfterBind && supportedVulkan12Features.descriptorBindingUpdateUnusedWhilePending
+		&& supportedVulkan12Features.shaderSampledImageArrayNonUniformIndexing;
+	const bool indirectDrawingSupported = supportedFeatures.multiDrawIndirect && supportedFeatures.drawIndirectFirstInstance
+		&& supportedVulkan12Features.drawIndirectCount && supportedVulkan11Features.shaderDrawParameters;
+	VkPhysicalDeviceDescriptorIndexingProperties descriptorIndexingProperties{};
+	descriptorIndexingProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_PROPERTIES;
+	VkPhysicalDeviceProperties2 deviceProperties2{};
+	deviceProperties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+	deviceProperties2.pNext = &descriptorIndexingProperties;
+	vkGetPhysicalDeviceProperties2(physicalDevice, &deviceProperties2);
+	const bool bindlessTableFits = descriptorIndexingProperties.maxPerStageDescriptorUpdateAfterBindSampledImages >= MAX_BINDLESS_TEXTURES
+		&& descriptorIndexingProperties.maxDescriptorSetUpdateAfterBindSampledImages >= MAX_BINDLESS_TEXTURES;
 	const bool extensionsSupported = CheckDeviceExtensionSupport(physicalDevice);
 	bool swapChainAdequate = false;
 	if (extensionsSupported)
@@ -1591,7 +3085,7 @@ int32_t RenderLoop::RateDeviceSuitability(const VkPhysicalDevice physicalDevice)
 		swapChainAdequate = !swapChainSupport.formats.empty() && !swapChainSupport.presentModes.empty();
 	}
 
-	if (!deviceFeatures.geometryShader || !indices.IsComplete() || !extensionsSupported || !swapChainAdequate || !supportedFeatures.samplerAnisotropy)
+	if (!deviceFeatures.geometryShader || !indices.IsComplete() || !extensionsSupported || !swapChainAdequate || !supportedFeatures.samplerAnisotropy || !supportedVulkan12Features.timelineSemaphore || !descriptorIndexingSupported || !bindlessTableFits || !indirectDrawingSupported)
 		return 0;
 
 	return score;
@@ -1638,27 +3132,19 @@ void RenderLoop::SelectPhysicalDevice()
 	if (deviceCandidates.rbegin()->first > 0)
 	{
 		_physicalDevice = deviceCandidates.rbegin()->second;
-		_msaaSamples = GetMaxUsableSampleCount();
+		_msaaSamples = GetUsableSampleCount();
+		if (_msaaSamples != _maxMsaaSamples)
+			printf("Rendering with %ux MSAA, the device does not support %ux\n", static_cast<uint32_t>(_msaaSamples), static_cast<uint32_t>(_maxMsaaSamples));
+
+		VkPhysicalDeviceProperties properties{};
+		vkGetPhysicalDeviceProperties(_physicalDevice, &properties);
+		_maxSamplerAnisotropy = properties.limits.maxSamplerAnisotropy;
 		return;
 	}
 
 	throw std::runtime_error("Failed to find a suitable GPU!");
 }
 
-uint32_t RenderLoop::FindMemoryType(const uint32_t& typeFilter, const VkMemoryPropertyFlags& properties) const
-{
-	VkPhysicalDeviceMemoryProperties memoryProperties;
-	vkGetPhysicalDeviceMemoryProperties(_physicalDevice, &memoryProperties);
-
-	for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; ++i)
-	{
-		if ((typeFilter & (1 << i)) && (memoryProperties.memoryTypes[i].propertyFlags & properties) == properties)
-			return i;
-	}
-
-	throw std::runtime_error("Failed to find suitable memory type!");
-}
-
 VkFormat RenderLoop::FindSupportedFormat(const std::vector<VkFormat>& candidates, const VkImageTiling& tiling, VkFormatFeatureFlags features) const
 {
 	for (const VkFormat format : candidates)
@@ -1689,22 +3175,590 @@ bool RenderLoop::HasStencilComponent(const VkFormat& format)
 	return format == VK_FORMAT_D32_SFLOAT_S8_UINT || format == VK_FORMAT_D24_UNORM_S8_UINT;
 }
 
-VkSampleCountFlagBits RenderLoop::GetMaxUsableSampleCount() const
+VkSampleCountFlagBits RenderLoop::GetUsableSampleCount() const
 {
 	VkPhysicalDeviceProperties physicalDeviceProperties;
 	vkGetPhysicalDeviceProperties(_physicalDevice, &physicalDeviceProperties);
 
 	const VkSampleCountFlags counts = physicalDeviceProperties.limits.framebufferColorSampleCounts & physicalDeviceProperties.limits.framebufferDepthSampleCounts;
 
-	if (counts & VK_SAMPLE_COUNT_64_BIT) return VK_SAMPLE_COUNT_64_BIT;
-	if (counts & VK_SAMPLE_COUNT_32_BIT) return VK_SAMPLE_COUNT_32_BIT;
-	if (counts & VK_SAMPLE_COUNT_16_BIT) return VK_SAMPLE_COUNT_16_BIT;
-	if (counts & VK_SAMPLE_COUNT_8_BIT) return VK_SAMPLE_COUNT_8_BIT;
-	if (counts & VK_SAMPLE_COUNT_4_BIT) return VK_SAMPLE_COUNT_4_BIT;
-	if (counts & VK_SAMPLE_COUNT_2_BIT) return VK_SAMPLE_COUNT_2_BIT;
+	// Highest supported count that does not exceed _maxMsaaSamples
+	for (uint32_t count = _maxMsaaSamples; count > VK_SAMPLE_COUNT_1_BIT; count >>= 1)
+	{
+		if (counts & count)
+			return static_cast<VkSampleCountFlagBits>(count);
+	}
 	return VK_SAMPLE_COUNT_1_BIT;
 }
 
+uint32_t RenderLoop::GetSupportedTextureCompression(const VkPhysicalDeviceFeatures& supportedFeatures) const
+{
+	// A family counts when its feature exists and the transcode target of that family can be sampled with linear filtering
+	const auto isSampleable = [this](const VkFormat& format)
+		{
+			VkFormatProperties properties;
+			vkGetPhysicalDeviceFormatProperties(_physicalDevice, format, &properties);
+			constexpr VkFormatFeatureFlags requiredFeatures = VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+			return (properties.optimalTilingFeatures & requiredFeatures) == requiredFeatures;
+		};
+
+	uint32_t compression = FHE_TEXTURE_COMPRESSION_NONE;
+	if (supportedFeatures.textureCompressionBC && isSampleable(VK_FORMAT_BC7_SRGB_BLOCK) && isSampleable(VK_FORMAT_BC1_RGB_SRGB_BLOCK))
+		compression |= FHE_TEXTURE_COMPRESSION_BC;
+	if (supportedFeatures.textureCompressionASTC_LDR && isSampleable(VK_FORMAT_ASTC_4x4_SRGB_BLOCK))
+		compression |= FHE_TEXTURE_COMPRESSION_ASTC;
+	if (supportedFeatures.textureCompressionETC2 && isSampleable(VK_FORMAT_ETC2_R8G8B8A8_SRGB_BLOCK))
+		compression |= FHE_TEXTURE_COMPRESSION_ETC2;
+
+	printf("Texture compression: BC %s, ASTC %s, ETC2 %s\n",
+		(compression & FHE_TEXTURE_COMPRESSION_BC) ? "yes" : "no",
+		(compression & FHE_TEXTURE_COMPRESSION_ASTC) ? "yes" : "no",
+		(compression & FHE_TEXTURE_COMPRESSION_ETC2) ? "yes" : "no");
+
+	return compression;
+}
+
+
+void RenderLoop::ProcessStreamedGeometry()
+{
+	ReleaseCompletedTransfers();
+
+	std::vector<GeometryUpload> uploads;
+	{
+		std::lock_guard lock(_streamedGeometryMutex);
+		uploads.swap(_streamedGeometry);
+	}
+
+	// Place every new mesh before recording any copy, growing an arena replaces the buffer the copies would target
+	for (auto& upload : uploads)
+	{
+		if (!upload.error.empty())
+		{
+			printf("Failed to load model geometry %s\n", upload.error.c_str());
+			upload.model->geometryFailed = true;
+			continue;
+		}
+
+		upload.model->mesh = upload.mesh;
+		PlaceModelGeometry(*upload.model);
+		_geometryUploadsInProgress.push_back(std::move(upload));
+	}
+	if (_geometryUploadsInProgress.empty())
+		return;
+
+	VkCommandBufferAllocateInfo allocInfo{};
+	allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+	allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+	allocInfo.commandPool = _transferCommandPool;
+	allocInfo.commandBufferCount = 1;
+
+	VkCommandBuffer commandBuffer;
+	if (vkAllocateCommandBuffers(_device, &allocInfo, &commandBuffer) != VK_SUCCESS)
+		throw std::runtime_error("Failed to allocate a transfer command buffer!");
+
+	VkCommandBufferBeginInfo beginInfo{};
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+	vkBeginCommandBuffer(commandBuffer, &beginInfo);
+
+	const uint64_t timelineValue = _transferTimelineValue + 1;
+	std::vector<VkBufferMemoryBarrier> releaseBarriers;
+	VkDeviceSize frameStagedSize = 0;
+	size_t completedCount = 0;
+	for (auto& upload : _geometryUploadsInProgress)
+	{
+		const Model& model = *upload.model;
+		const VkDeviceSize vertexSize = VertexLayout::GetStride(model.mesh.vertexLayout) * model.mesh.vertexCount;
+		const VkDeviceSize indexSize = static_cast<VkDeviceSize>(model.mesh.indexSize) * model.mesh.indexCount;
+		const VkDeviceSize totalSize = vertexSize + indexSize;
+
+		// Vertices then indices, in chunks of whatever the ring and this frame's budget leave
+		while (upload.stagedSize < totalSize && frameStagedSize < MAX_STAGED_GEOMETRY_PER_FRAME)
+		{
+			const bool vertices = upload.stagedSize < vertexSize;
+			const VkDeviceSize sectionOffset = vertices ? upload.stagedSize : upload.stagedSize - vertexSize;
+			const VkDeviceSize chunkSize = std::min({ (vertices ? vertexSize : indexSize) - sectionOffset, MAX_STAGED_GEOMETRY_PER_FRAME - frameStagedSize, _stagingRing.GetAvailableSize(GEOMETRY_STAGING_ALIGNMENT) });
+			uint64_t stagingOffset;
+			if (chunkSize == 0 || !_stagingRing.Allocate(chunkSize, GEOMETRY_STAGING_ALIGNMENT, stagingOffset))
+				break;
+
+			memcpy(static_cast<uint8_t*>(_stagingRingAllocation.mapped) + stagingOffset, (vertices ? upload.mesh.vertexData : upload.mesh.indexData) + sectionOffset, chunkSize);
+
+			VkBufferCopy region{};
+			region.srcOffset = stagingOffset;
+			region.dstOffset = (vertices ? model.vertexArenaOffset : model.indexArenaOffset) + sectionOffset;
+			region.size = chunkSize;
+			vkCmdCopyBuffer(commandBuffer, _stagingRingBuffer, vertices ? _vertexBuffer : _indexBuffer, 1, &region);
+
+			upload.stagedSize += chunkSize;
+			frameStagedSize += chunkSize;
+		}
+
+		// Uploads complete in order, the rest continue next frame
+		if (upload.stagedSize < totalSize)
+			break;
+
+		// Release to the graphics family, the matching acquire is recorded by the first frame that sees the timeline pass.
+		// Chunks copied by earlier submissions are covered too, they precede this barrier on the same queue.
+		// Concurrent arenas need no transfer, the frame's wait on the transfer timeline alone makes the copies visible.
+		for (auto& barrier : upload.ownershipBarriers)
+		{
+			barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+			barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+			barrier.dstAccessMask = 0;
+			barrier.srcQueueFamilyIndex = _transferQueueFamily;
+			barrier.dstQueueFamilyIndex = _graphicsQueueFamily;
+		}
+		upload.ownershipBarriers[0].buffer = _vertexBuffer;
+		upload.ownershipBarriers[0].offset = model.vertexArenaOffset;
+		upload.ownershipBarriers[0].size = vertexSize;
+		upload.ownershipBarriers[1].buffer = _indexBuffer;
+		upload.ownershipBarriers[1].offset = model.indexArenaOffset;
+		upload.ownershipBarriers[1].size = indexSize;
+		if (NeedsGeometryOwnershipTransfer())
+			releaseBarriers.insert(releaseBarriers.end(), upload.ownershipBarriers.begin(), upload.ownershipBarriers.end());
+		upload.timelineValue = timelineValue;
+
+		// The mapped cache can be closed now. Counts and bounds stay valid for drawing.
+		upload.mesh.vertexData = nullptr;
+		upload.mesh.indexData = nullptr;
+		upload.mesh.storage.reset();
+		upload.model->mesh.vertexData = nullptr;
+		upload.model->mesh.indexData = nullptr;
+		upload.model->mesh.storage.reset();
+		++completedCount;
+	}
+
+	if (frameStagedSize == 0 && completedCount == 0)
+	{
+		vkEndCommandBuffer(commandBuffer);
+		vkFreeCommandBuffers(_device, _transferCommandPool, 1, &commandBuffer);
+		return;
+	}
+
+	if (!releaseBarriers.empty())
+	{
+		vkCmdPipelineBarrier(
+			commandBuffer,
+			VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+			0,
+			0, nullptr,
+			static_cast<uint32_t>(releaseBarriers.size()), releaseBarriers.data(),
+			0, nullptr
+		);
+	}
+
+	if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS)
+		throw std::runtime_error("Failed to record transfer command buffer!");
+
+	_transferTimelineValue = timelineValue;
+	VkTimelineSemaphoreSubmitInfo timelineInfo{};
+	timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+	timelineInfo.signalSemaphoreValueCount = 1;
+	timelineInfo.pSignalSemaphoreValues = &timelineValue;
+
+	VkSubmitInfo submitInfo{};
+	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submitInfo.pNext = &timelineInfo;
+	submitInfo.commandBufferCount = 1;
+	submitInfo.pCommandBuffers = &commandBuffer;
+	submitInfo.signalSemaphoreCount = 1;
+	submitInfo.pSignalSemaphores = &_transferTimeline;
+
+	if (vkQueueSubmit(_transferQueue, 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS)
+		throw std::runtime_error("Failed to submit transfer command buffer!");
+
+	const uint64_t stagingBatch = _stagingRing.Submit();
+	_transferDeletionQueue.emplace_back(timelineValue, [this, commandBuffer, stagingBatch]()
+		{
+			_stagingRing.Release(stagingBatch);
+			vkFreeCommandBuffers(_device, _transferCommandPool, 1, &commandBuffer);
+		});
+
+	for (size_t i = 0; i < completedCount; ++i)
+		_pendingGeometryAcquires.push_back(std::move(_geometryUploadsInProgress[i]));
+	_geometryUploadsInProgress.erase(_geometryUploadsInProgress.begin(), _geometryUploadsInProgress.begin() + static_cast<std::ptrdiff_t>(completedCount));
+}
+
+uint64_t RenderLoop::RecordGeometryAcquires(const VkCommandBuffer& commandBuffer)
+{
+	if (_pendingGeometryAcquires.empty())
+		return 0;
+
+	uint64_t completedValue;
+	vkGetSemaphoreCounterValue(_device, _transferTimeline, &completedValue);
+
+	uint64_t waitValue = 0;
+	std::vector<VkBufferMemoryBarrier> acquireBarriers;
+	for (auto upload = _pendingGeometryAcquires.begin(); upload != _pendingGeometryAcquires.end();)
+	{
+		// Acquiring before the transfer queue finished would make the submission wait on it
+		if (upload->timelineValue > completedValue)
+		{
+			++upload;
+			continue;
+		}
+
+		for (auto barrier : upload->ownershipBarriers)
+		{
+			barrier.srcAccessMask = 0;
+			barrier.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT | VK_ACCESS_TRANSFER_READ_BIT;
+			acquireBarriers.push_back(barrier);
+		}
+		upload->model->resident = true;
+		waitValue = std::max(waitValue, upload->timelineValue);
+		upload = _pendingGeometryAcquires.erase(upload);
+	}
+
+	if (waitValue == 0)
+		return 0;
+
+	// Newly resident models change the draw list
+	++_sceneRevision;
+	if (!NeedsGeometryOwnershipTransfer())
+		return waitValue;
+
+	// Transfer reads included, so a growing arena can copy acquired ranges in the same command buffer
+	vkCmdPipelineBarrier(
+		commandBuffer,
+		VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT,
+		0,
+		0, nullptr,
+		static_cast<uint32_t>(acquireBarriers.size()), acquireBarriers.data(),
+		0, nullptr
+	);
+
+	return waitValue;
+}
+
+bool RenderLoop::HasGeometryAcquiresReady() const
+{
+	if (_pendingGeometryAcquires.empty())
+		return false;
+
+	uint64_t completedValue;
+	vkGetSemaphoreCounterValue(_device, _transferTimeline, &completedValue);
+	return std::any_of(_pendingGeometryAcquires.begin(), _pendingGeometryAcquires.end(), [&completedValue](const GeometryUpload& upload) { return upload.timelineValue <= completedValue; });
+}
+
+void RenderLoop::ReleaseCompletedTransfers()
+{
+	if (_transferDeletionQueue.empty())
+		return;
+
+	uint64_t completedValue;
+	vkGetSemaphoreCounterValue(_device, _transferTimeline, &completedValue);
+
+	while (!_transferDeletionQueue.empty() && _transferDeletionQueue.front().first <= completedValue)
+	{
+		_transferDeletionQueue.front().second();
+		_transferDeletionQueue.pop_front();
+	}
+}
+
+void RenderLoop::ReleaseCompletedUploads()
+{
+	if (_uploadDeletionQueue.empty())
+		return;
+
+	const uint64_t completedValue = _uploadContext->GetCompletedValue();
+	while (!_uploadDeletionQueue.empty() && _uploadDeletionQueue.front().first <= completedValue)
+	{
+		_uploadDeletionQueue.front().second();
+		_uploadDeletionQueue.pop_front();
+	}
+}
+
+void RenderLoop::ReleaseCompletedFrames()
+{
+	while (!_frameDeletionQueue.empty() && _frameDeletionQueue.front().first <= _frameNumber)
+	{
+		_frameDeletionQueue.front().second();
+		_frameDeletionQueue.pop_front();
+	}
+}
+
+void RenderLoop::UpdateTextureStreaming()
+{
+	FinishTextureResidencyChanges();
+	if (_textureStreams.empty() || _textureResidencyChanges.size() >= MAX_TEXTURE_RESIDENCY_CHANGES)
+		return;
+
+	EstimateTextureLevels();
+
+	// Levels move one at a time, which spreads the cost over frames and keeps each staging upload small.
+	// Surplus is how many levels finer than needed a texture is resident, negative when it is missing detail.
+	const FHEImage* evictTarget = nullptr;
+	const FHEImage* loadTarget = nullptr;
+	int32_t largestSurplus = std::numeric_limits<int32_t>::min();
+	int32_t largestShortage = 0;
+	for (const auto& [image, stream] : _textureStreams)
+	{
+		if (stream.changing)
+			continue;
+
+		const int32_t surplus = static_cast<int32_t>(stream.desiredLevel) - static_cast<int32_t>(stream.residentLevel);
+		if (stream.residentLevel + 1 < stream.source->numLevels && surplus > largestSurplus)
+		{
+			largestSurplus = surplus;
+			evictTarget = image;
+		}
+		if (-surplus > largestShortage)
+		{
+			largestShortage = -surplus;
+			loadTarget = image;
+		}
+	}
+
+	// Over budget the least recently used texture gives up a level, otherwise only textures two levels finer than needed do, so a texture on the edge does not flip every frame
+	if (!_memoryAllocator->FitsSoftBudget(FHE_MEMORY_CATEGORY_TEXTURE, 0))
+		evictTarget = FindLeastRecentlyUsedTexture();
+	else if (largestSurplus < 2)
+		evictTarget = nullptr;
+	if (evictTarget != nullptr)
+	{
+		TextureStreamState& stream = _textureStreams.at(evictTarget);
+		BeginTextureResidencyChange(*const_cast<FHEImage*>(evictTarget), stream, stream.residentLevel + 1);
+		return;
+	}
+
+	// The next level up is roughly three times what is resident now, it has to fit without forcing an eviction right after
+	if (loadTarget != nullptr)
+	{
+		TextureStreamState& stream = _textureStreams.at(loadTarget);
+		if (_memoryAllocator->FitsSoftBudget(FHE_MEMORY_CATEGORY_TEXTURE, 3 * stream.residentSize))
+			BeginTextureResidencyChange(*const_cast<FHEImage*>(loadTarget), stream, stream.residentLevel - 1);
+	}
+}
+
+void RenderLoop::EstimateTextureLevels()
+{
+	for (auto& [image, stream] : _textureStreams)
+		stream.desiredLevel = stream.source->numLevels - 1;
+
+	const glm::vec3 cameraPosition = glm::vec3(glm::inverse(_camera.view)[3]);
+	// Pixels covered by one world unit at distance one
+	const float pixelsPerUnit = std::abs(_camera.projection[1][1]) * static_cast<float>(_swapChainExtent.height) * 0.5f;
+	const Frustum frustum(_camera.projection * _camera.view);
+
+	for (const auto& model : _models)
+	{
+		if (!model.resident)
+			continue;
+
+		const glm::vec3 center = (model.mesh.boundsMin + model.mesh.boundsMax) * 0.5f;
+		const float radius = glm::length(model.mesh.boundsMax - model.mesh.boundsMin) * 0.5f;
+
+		float nearestDistance = std::numeric_limits<float>::max();
+		bool inView = false;
+		for (const auto& transform : *_modelTransforms.at(&model))
+		{
+			const glm::vec3 instanceCenter = glm::vec3(transform * glm::vec4(center, 1.f));
+			nearestDistance = std::min(nearestDistance, glm::length(instanceCenter - cameraPosition));
+
+			const float scale = std::max({ glm::length(glm::vec3(transform[0])), glm::length(glm::vec3(transform[1])), glm::length(glm::vec3(transform[2])) });
+			inView = inView || frustum.IntersectsSphere(instanceCenter, radius * scale);
+		}
+
+		// Diameter of the nearest instance on screen, assuming the texture is mapped across the model once
+		const float projectedSize = 2.f * radius * pixelsPerUnit / std::max(nearestDistance - radius, 0.1f);
+
+		for (const auto& texture : model.textures)
+		{
+			const auto stream = _textureStreams.find(&texture);
+			if (stream == _textureStreams.end())
+				continue;
+
+			const ktxTexture* source = stream->second.source;
+			const float level = std::log2(static_cast<float>(std::max(source->baseWidth, source->baseHeight)) / std::max(projectedSize, 1.f));
+			const uint32_t desiredLevel = std::min(static_cast<uint32_t>(std::max(level, 0.f)), source->numLevels - 1);
+			stream->second.desiredLevel = std::min(stream->second.desiredLevel, desiredLevel);
+			if (inView)
+				stream->second.lastUsedFrame = _frameNumber;
+		}
+	}
+}
+
+const FHEImage* RenderLoop::FindLeastRecentlyUsedTexture() const
+{
+	const FHEImage* leastRecentlyUsed = nullptr;
+	uint64_t oldestFrame = std::numeric_limits<uint64_t>::max();
+	for (const auto& [image, stream] : _textureStreams)
+	{
+		if (!stream.changing && stream.residentLevel + 1 < stream.source->numLevels && stream.lastUsedFrame < oldestFrame)
+		{
+			oldestFrame = stream.lastUsedFrame;
+			leastRecentlyUsed = image;
+		}
+	}
+
+	return leastRecentlyUsed;
+}
+
+bool RenderLoop::EvictMemory(const FHEMemoryCategory& category, const VkDeviceSize& size)
+{
+	// Memory that only waits for the device to be done with it comes back first
+	if (!_frameDeletionQueue.empty() || !_textureResidencyChanges.empty() || !_transferDeletionQueue.empty() || !_uploadDeletionQueue.empty())
+	{
+		vkDeviceWaitIdle(_device);
+		FinishTextureResidencyChanges();
+		ReleaseCompletedTransfers();
+		ReleaseCompletedUploads();
+		while (!_frameDeletionQueue.empty())
+		{
+			_frameDeletionQueue.front().second();
+			_frameDeletionQueue.pop_front();
+		}
+		return true;
+	}
+
+	// Dropping texture levels only helps a category over its own budget if it is the texture category, it always helps the heap
+	if (category != FHE_MEMORY_CATEGORY_TEXTURE && _memoryAllocator->ExceedsHardBudget(category, size))
+		return false;
+
+	const FHEImage* target = FindLeastRecentlyUsedTexture();
+	if (target == nullptr)
+		return false;
+
+	// Coarser levels are copied on the device, nothing goes through the ring. The old image is freed once the copy completed.
+	TextureStreamState& stream = _textureStreams.at(target);
+	BeginTextureResidencyChange(*const_cast<FHEImage*>(target), stream, stream.residentLevel + 1);
+	WaitForUploads(SubmitUploads());
+	FinishTextureResidencyChanges();
+	return true;
+}
+
+void RenderLoop::BeginTextureResidencyChange(FHEImage& target, TextureStreamState& stream, const uint32_t& residentLevel)
+{
+	ktxTexture* source = stream.source;
+	const uint32_t oldResidentLevel = stream.residentLevel;
+
+	// Wait for the ring to drain rather than stalling the frame, unless the levels could never fit and have to be flushed through it anyway
+	VkDeviceSize uploadSize = 0;
+	for (uint32_t level = residentLevel; level < oldResidentLevel; ++level)
+		uploadSize += ktxTexture_GetImageSize(source, level) + GetTextureStagingAlignment(source);
+	if (uploadSize <= _stagingRing.GetSize() && uploadSize > _stagingRing.GetAvailableSize(GetTextureStagingAlignment(source)))
+		return;
+
+	// Before any allocation, so an eviction the allocation triggers leaves this texture alone
+	stream.changing = true;
+
+	TextureResidencyChange change{};
+	change.target = &target;
+	change.residentLevel = residentLevel;
+	change.replacement = target;
+	change.replacement.levelCount = source->numLevels - residentLevel;
+	CreateImage(std::max(1u, source->baseWidth >> residentLevel), std::max(1u, source->baseHeight >> residentLevel), change.replacement.levelCount, VK_SAMPLE_COUNT_1_BIT, target.format, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, change.replacement.image, change.replacement.allocation, FHE_MEMORY_CATEGORY_TEXTURE);
+	CreateImageView(change.replacement.image, change.replacement.format, VK_IMAGE_ASPECT_COLOR_BIT, change.replacement.levelCount, change.replacement.view);
+
+	VkMemoryRequirements memoryRequirements;
+	vkGetImageMemoryRequirements(_device, change.replacement.image, &memoryRequirements);
+	change.residentSize = memoryRequirements.size;
+
+	// Levels resident on both sides are copied on the device
+	std::vector<VkImageCopy> copyRegions;
+	for (uint32_t level = std::max(residentLevel, oldResidentLevel); level < source->numLevels; ++level)
+	{
+		VkImageCopy region{};
+		region.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		region.srcSubresource.mipLevel = level - oldResidentLevel;
+		region.srcSubresource.baseArrayLayer = 0;
+		region.srcSubresource.layerCount = 1;
+		region.srcOffset = { 0, 0, 0 };
+		region.dstSubresource = region.srcSubresource;
+		region.dstSubresource.mipLevel = level - residentLevel;
+		region.dstOffset = { 0, 0, 0 };
+		region.extent = { std::max(1u, source->baseWidth >> level), std::max(1u, source->baseHeight >> level), 1 };
+		copyRegions.push_back(region);
+	}
+
+	VkCommandBuffer commandBuffer = _uploadContext->GetCommandBuffer();
+
+	// Frames submitted earlier may still sample the old image, so the copy waits for their fragment shaders
+	std::array<VkImageMemoryBarrier, 2> barriers{};
+	for (auto& barrier : barriers)
+	{
+		barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+		barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		barrier.subresourceRange.baseMipLevel = 0;
+		barrier.subresourceRange.baseArrayLayer = 0;
+		barrier.subresourceRange.layerCount = 1;
+	}
+	barriers[0].image = target.image;
+	barriers[0].subresourceRange.levelCount = target.levelCount;
+	barriers[0].oldLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	barriers[0].newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+	barriers[0].srcAccessMask = 0;
+	barriers[0].dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+	barriers[1].image = change.replacement.image;
+	barriers[1].subresourceRange.levelCount = change.replacement.levelCount;
+	barriers[1].oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	barriers[1].newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+	barriers[1].srcAccessMask = 0;
+	barriers[1].dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, static_cast<uint32_t>(barriers.size()), barriers.data());
+
+	vkCmdCopyImage(commandBuffer, target.image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, change.replacement.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, static_cast<uint32_t>(copyRegions.size()), copyRegions.data());
+	// Levels finer than what is resident come from the file kept on the host
+	for (uint32_t level = residentLevel; level < oldResidentLevel; ++level)
+		StageTextureLevel(source, level, change.replacement.image, level - residentLevel);
+	commandBuffer = _uploadContext->GetCommandBuffer();
+
+	// The old image goes back to shader reads for the frames recorded before the swap
+	barriers[0].oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+	barriers[0].newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	barriers[0].srcAccessMask = 0;
+	barriers[0].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+	barriers[1].oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+	barriers[1].newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	barriers[1].srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	barriers[1].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr, 0, nullptr, static_cast<uint32_t>(barriers.size()), barriers.data());
+
+	// Submitted along with the rest of the batch, the replacement is swapped in once the batch completed
+	change.uploadValue = _uploadContext->GetRecordingValue();
+	_textureResidencyChanges.push_back(change);
+}
+
+void RenderLoop::FinishTextureResidencyChanges()
+{
+	if (_textureResidencyChanges.empty())
+		return;
+
+	const uint64_t completedValue = _uploadContext->GetCompletedValue();
+	for (auto change = _textureResidencyChanges.begin(); change != _textureResidencyChanges.end();)
+	{
+		if (change->uploadValue > completedValue)
+		{
+			++change;
+			continue;
+		}
+
+		// Frames in flight still sample the old image through their descriptor sets, it goes once they have all completed
+		FHEImage& target = *change->target;
+		_frameDeletionQueue.emplace_back(_frameNumber + MAX_FRAMES_IN_FLIGHT, [this, view = target.view, image = target.image, allocation = target.allocation]()
+			{
+				vkDestroyImageView(_device, view, nullptr);
+				vkDestroyImage(_device, image, nullptr);
+				_memoryAllocator->Free(allocation);
+			});
+
+		target.image = change->replacement.image;
+		target.allocation = change->replacement.allocation;
+		target.view = change->replacement.view;
+		target.levelCount = change->replacement.levelCount;
+		_dirtyTextureDescriptors[&target] = (1u << MAX_FRAMES_IN_FLIGHT) - 1;
+
+		TextureStreamState& stream = _textureStreams.at(&target);
+		stream.residentLevel = change->residentLevel;
+		stream.residentSize = change->residentSize;
+		stream.changing = false;
+
+		change = _textureResidencyChanges.erase(change);
+	}
+}
 
 void RenderLoop::RecordCommandBuffer(const VkCommandBuffer& commandBuffer, const uint32_t& imageIndex)
 {
@@ -1716,10 +3770,71 @@ void RenderLoop::RecordCommandBuffer(const VkCommandBuffer& commandBuffer, const
 	if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS)
 		throw std::runtime_error("Failed to begin recording command buffer!");
 
+	// Uploads finished on the transfer queue become drawable from this frame on
+	_frameTransferWaitValue = RecordGeometryAcquires(commandBuffer);
+
+	// Executes after UpdateUniformBuffer has written this frame's delta time, as that happens before submission
+	RecordAnimation(commandBuffer);
+
+	std::vector<const Model*> drawList;
+	uint32_t drawCount = 0;
+	uint32_t instanceSlotCount = 0;
+	for (const auto& model : _models)
+	{
+		if (!model.resident || _modelTransforms.at(&model)->empty())
+			continue;
+
+		drawList.push_back(&model);
+		drawCount += static_cast<uint32_t>(model.mesh.submeshes.size());
+		instanceSlotCount += GetDrawInstanceCount(model);
+	}
+	if (drawCount > MAX_INDIRECT_DRAWS)
+		throw std::runtime_error("Too many draws for the indirect draw buffer!");
+
+	// Slices hold whole models and roughly the same number of draws each, their records follow each other
+	uint32_t sliceCount = _recordingSliceLimit != 0 ? _recordingSliceLimit : drawCount / MIN_DRAWS_PER_RECORDING_SLICE;
+	sliceCount = std::max(1u, std::min(sliceCount, _recordingSliceCount));
+	std::vector<size_t> sliceStarts(sliceCount + 1, drawList.size());
+	std::vector<uint32_t> sliceFirstDraws(sliceCount, drawCount);
+	std::vector<uint32_t> sliceFirstInstances(sliceCount, instanceSlotCount);
+	sliceStarts[0] = 0;
+	sliceFirstDraws[0] = 0;
+	sliceFirstInstances[0] = 0;
+	uint32_t slicedDrawCount = 0;
+	uint32_t slicedInstanceCount = 0;
+	for (size_t i = 0, slice = 1; i < drawList.size() && slice < sliceCount; ++i)
+	{
+		slicedDrawCount += static_cast<uint32_t>(drawList[i]->mesh.submeshes.size());
+		slicedInstanceCount += GetDrawInstanceCount(*drawList[i]);
+		if (static_cast<uint64_t>(slicedDrawCount) * sliceCount >= static_cast<uint64_t>(drawCount) * slice)
+		{
+			sliceStarts[slice] = i + 1;
+			sliceFirstDraws[slice] = slicedDrawCount;
+			sliceFirstInstances[slice++] = slicedInstanceCount;
+		}
+	}
+
+	// The in-flight fence of this frame has been waited on, so nothing still executes from its pools or reads its draw staging region
+	const size_t firstSlice = (static_cast<size_t>(imageIndex) * MAX_FRAMES_IN_FLIGHT + _currentFrame) * _recordingSliceCount;
+	for (uint32_t slice = 0; slice < sliceCount; ++slice)
+		vkResetCommandPool(_device, _recordingCommandPools[firstSlice + slice], 0);
+
+	const auto recordSlice = [&](const uint32_t slice)
+		{
+			RecordDrawSlice(_earlyRecordingCommandBuffers[firstSlice + slice], _recordingCommandBuffers[firstSlice + slice], imageIndex, drawList, sliceStarts[slice], sliceStarts[slice + 1], slice, sliceFirstDraws[slice], sliceFirstInstances[slice]);
+		};
+	if (sliceCount == 1)
+		recordSlice(0);
+	else
+		_recordingJobSystem->Dispatch(sliceCount, recordSlice);
+
+	// The slices wrote the records, the copy and culling only have to be recorded ahead of the render passes
+	RecordDrawCopy(commandBuffer, drawCount);
+	RecordCulling(commandBuffer, drawCount, 0);
 
 	VkRenderPassBeginInfo renderPassInfo{};
 	renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-	renderPassInfo.renderPass = _renderPass;
+	renderPassInfo.renderPass = _occlusionCulling ? _earlyRenderPass : _singleRenderPass;
 	renderPassInfo.framebuffer = _swapChainFrameBuffers[imageIndex];
 	renderPassInfo.renderArea.offset = { 0, 0 };
 	renderPassInfo.renderArea.extent = _swapChainExtent;
@@ -1731,9 +3846,134 @@ void RenderLoop::RecordCommandBuffer(const VkCommandBuffer& commandBuffer, const
 	renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
 	renderPassInfo.pClearValues = clearValues.data();
 
-	vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
-	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, _graphicsPipeline);
+	vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+	vkCmdExecuteCommands(commandBuffer, sliceCount, &_earlyRecordingCommandBuffers[firstSlice]);
+	vkCmdEndRenderPass(commandBuffer);
 
+	// Whatever the early pass left uncovered is tested against its depth, the late pass draws what turned out visible after all
+	if (_occlusionCulling)
+	{
+		RecordDepthPyramid(commandBuffer);
+		RecordCulling(commandBuffer, drawCount, 1);
+
+		// Loads what the early pass drew, so nothing is cleared
+		renderPassInfo.renderPass = _renderPass;
+		renderPassInfo.clearValueCount = 0;
+		renderPassInfo.pClearValues = nullptr;
+		vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+		vkCmdExecuteCommands(commandBuffer, sliceCount, &_recordingCommandBuffers[firstSlice]);
+		vkCmdEndRenderPass(commandBuffer);
+	}
+
+	// Released to the present family, which acquires the image with the matching barrier before presenting it
+	if (NeedsPresentOwnershipTransfer())
+	{
+		VkImageMemoryBarrier barrier{};
+		barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+		barrier.oldLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+		barrier.newLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+		barrier.srcQueueFamilyIndex = _graphicsQueueFamily;
+		barrier.dstQueueFamilyIndex = _presentQueueFamily;
+		barrier.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+		barrier.dstAccessMask = 0;
+		barrier.image = _swapChainImages[imageIndex];
+		barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		barrier.subresourceRange.baseMipLevel = 0;
+		barrier.subresourceRange.levelCount = 1;
+		barrier.subresourceRange.baseArrayLayer = 0;
+		barrier.subresourceRange.layerCount = 1;
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+	}
+
+	if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS)
+		throw std::runtime_error("Failed to record command buffer!");
+}
+
+void RenderLoop::RecordDrawSlice(const VkCommandBuffer& earlyCommandBuffer, const VkCommandBuffer& commandBuffer, const uint32_t& imageIndex, const std::vector<const Model*>& drawList, const size_t& first, const size_t& last, const uint32_t& slice, const uint32_t& firstDraw, const uint32_t& firstVisibleInstance) const
+{
+	const VkDeviceSize regionOffset = _currentFrame * _drawRegionSize;
+	char* region = static_cast<char*>(_drawStagingData) + regionOffset;
+	auto* counts = reinterpret_cast<uint32_t*>(region) + static_cast<size_t>(slice) * DRAW_BUCKET_COUNT;
+	auto* commands = reinterpret_cast<VkDrawIndexedIndirectCommand*>(region + _drawCommandOffset);
+	auto* lateCommands = reinterpret_cast<VkDrawIndexedIndirectCommand*>(region + _lateDrawCommandOffset);
+	auto* drawData = reinterpret_cast<DrawData*>(region + _drawDataOffset);
+
+	// Records are grouped by bucket inside the slice, so every bucket is one contiguous indirect draw
+	std::array<uint32_t, DRAW_BUCKET_COUNT> bucketCounts{};
+	for (size_t i = first; i < last; ++i)
+		bucketCounts[GetDrawBucket(*drawList[i])] += static_cast<uint32_t>(drawList[i]->mesh.submeshes.size());
+	std::array<uint32_t, DRAW_BUCKET_COUNT> bucketStarts{};
+	for (uint32_t bucket = 0, start = firstDraw; bucket < DRAW_BUCKET_COUNT; ++bucket)
+	{
+		bucketStarts[bucket] = start;
+		start += bucketCounts[bucket];
+		counts[bucket] = bucketCounts[bucket];
+	}
+
+	std::array<uint32_t, DRAW_BUCKET_COUNT> nextDraws = bucketStarts;
+	uint32_t nextVisibleInstance = firstVisibleInstance;
+	for (size_t i = first; i < last; ++i)
+	{
+		const Model& model = *drawList[i];
+		DrawData data{};
+		data.dequantization = VertexLayout::GetDequantization(model.mesh.vertexLayout, model.mesh.boundsMin, model.mesh.boundsMax, model.mesh.texCoordMin, model.mesh.texCoordMax);
+		data.boundingSphere = glm::vec4((model.mesh.boundsMin + model.mesh.boundsMax) * 0.5f, glm::length(model.mesh.boundsMax - model.mesh.boundsMin) * 0.5f);
+		// Submeshes only split the index range for 16-bit indices, they all share the model's texture
+		data.textureIndex = model.textures.empty() ? _defaultTexture.descriptorIndex : model.textures[0].descriptorIndex;
+		data.firstTransform = model.transformIndex;
+		data.transformCount = GetDrawInstanceCount(model);
+
+		// The first record culls for the model, the others draw the same visible instances
+		data.recordCount = static_cast<uint32_t>(model.mesh.submeshes.size());
+
+		uint32_t& nextDraw = nextDraws[GetDrawBucket(model)];
+		for (const auto& submesh : model.mesh.submeshes)
+		{
+			// Culling counts the instances, firstInstance offsets gl_InstanceIndex to the model's range of visible instances
+			VkDrawIndexedIndirectCommand& command = commands[nextDraw];
+			command.indexCount = submesh.indexCount;
+			command.instanceCount = 0;
+			command.firstIndex = model.firstIndex + submesh.firstIndex;
+			command.vertexOffset = model.vertexOffset + submesh.vertexOffset;
+			command.firstInstance = nextVisibleInstance;
+			// The late phase draws the same record from its own half of the visible instances
+			VkDrawIndexedIndirectCommand& lateCommand = lateCommands[nextDraw];
+			lateCommand = command;
+			lateCommand.firstInstance = nextVisibleInstance + _instanceCount;
+			drawData[nextDraw] = data;
+			++nextDraw;
+			data.recordCount = 0;
+		}
+		nextVisibleInstance += data.transformCount;
+	}
+
+	// Without occlusion culling the late secondary is never executed, so it is not recorded either
+	RecordIndirectDraws(earlyCommandBuffer, _occlusionCulling ? _earlyRenderPass : _singleRenderPass, imageIndex, slice, bucketStarts, bucketCounts, _drawCommandOffset);
+	if (_occlusionCulling)
+		RecordIndirectDraws(commandBuffer, _renderPass, imageIndex, slice, bucketStarts, bucketCounts, _lateDrawCommandOffset);
+}
+
+void RenderLoop::RecordIndirectDraws(const VkCommandBuffer& commandBuffer, const VkRenderPass& renderPass, const uint32_t& imageIndex, const uint32_t& slice, const std::array<uint32_t, DRAW_BUCKET_COUNT>& bucketStarts, const std::array<uint32_t, DRAW_BUCKET_COUNT>& bucketCounts, const VkDeviceSize& recordOffset) const
+{
+	const VkDeviceSize regionOffset = _currentFrame * _drawRegionSize;
+
+	VkCommandBufferInheritanceInfo inheritanceInfo{};
+	inheritanceInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+	inheritanceInfo.renderPass = renderPass;
+	inheritanceInfo.subpass = 0;
+	inheritanceInfo.framebuffer = _swapChainFrameBuffers[imageIndex];
+
+	// Cached primaries execute their secondaries again, so those may only be one-time when nothing is cached. Every secondary belongs
+	// to one slot's primary, which is only submitted again once its frame's fence signalled, so simultaneous use is never needed.
+	VkCommandBufferBeginInfo beginInfo{};
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT | (_commandBufferCaching ? 0 : VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
+	beginInfo.pInheritanceInfo = &inheritanceInfo;
+
+	if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS)
+		throw std::runtime_error("Failed to begin recording secondary command buffer!");
+
+	// Secondary command buffers inherit no state from the primary, every slice sets up its own
 	VkViewport viewport{};
 	viewport.x = 0.f;
 	viewport.y = 0.f;
@@ -1750,33 +3990,43 @@ void RenderLoop::RecordCommandBuffer(const VkCommandBuffer& commandBuffer, const
 	const VkBuffer vertexBuffers[] = { _vertexBuffer };
 	const VkDeviceSize offsets[] = { 0 };
 	vkCmdBindVertexBuffers(commandBuffer, 0, 1, vertexBuffers, offsets);
-	vkCmdBindIndexBuffer(commandBuffer, _indexBuffer, 0, VK_INDEX_TYPE_UINT32);
 	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, _pipelineLayout, 0, 1, &_descriptorSets[_currentFrame], 0, nullptr);
 
-	for (auto& model : _models)
+	// The recorded counts are upper bounds, whatever ends up in the count buffer decides how many records are drawn
+	for (uint32_t bucket = 0; bucket < DRAW_BUCKET_COUNT; ++bucket)
 	{
-		if (_modelTransforms[&model]->empty())
+		if (bucketCounts[bucket] == 0)
 			continue;
-		if (!RENDER_ONLY_FIRST_INSTANCE)
-		{
-			vkCmdDrawIndexed(commandBuffer, static_cast<uint32_t>(model.indices.size()), static_cast<uint32_t>(_modelTransforms[&model]->size()), 0, 0, 0);
-		}
-		else
-			// ReSharper disable once CppUnreachableCode
-		{
-			vkCmdDrawIndexed(commandBuffer, static_cast<uint32_t>(model.indices.size()), 1, 0, 0, 0);
-		}
-	}
 
-	vkCmdEndRenderPass(commandBuffer);
+		// Every pipeline shares _pipelineLayout, so the descriptor sets bound above stay valid across switches.
+		// The arena holds 16 and 32-bit ranges side by side, so only the index type forces a rebind.
+		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, _graphicsPipelines[bucket / 2]);
+		vkCmdBindIndexBuffer(commandBuffer, _indexBuffer, 0, bucket % 2 == 0 ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32);
+		vkCmdPushConstants(commandBuffer, _pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(uint32_t), &bucketStarts[bucket]);
+		const VkDeviceSize countOffset = regionOffset + (static_cast<VkDeviceSize>(slice) * DRAW_BUCKET_COUNT + bucket) * sizeof(uint32_t);
+		const VkDeviceSize commandOffset = regionOffset + recordOffset + bucketStarts[bucket] * sizeof(VkDrawIndexedIndirectCommand);
+		vkCmdDrawIndexedIndirectCount(commandBuffer, _drawBuffer, commandOffset, _drawBuffer, countOffset, bucketCounts[bucket], sizeof(VkDrawIndexedIndirectCommand));
+	}
 
 	if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS)
-		throw std::runtime_error("Failed to record command buffer!");
+		throw std::runtime_error("Failed to record secondary command buffer!");
+}
+
+uint32_t RenderLoop::GetDrawBucket(const Model& model)
+{
+	return static_cast<uint32_t>(model.mesh.vertexLayout) * 2 + (model.indexType == VK_INDEX_TYPE_UINT32 ? 1 : 0);
+}
+
+uint32_t RenderLoop::GetDrawInstanceCount(const Model& model) const
+{
+	// ReSharper disable once CppUnreachableCode
+	return RENDER_ONLY_FIRST_INSTANCE ? 1 : static_cast<uint32_t>(_modelTransforms.at(&model)->size());
 }
 
 void RenderLoop::DrawFrame()
 {
 	vkWaitForFences(_device, 1, &_inFlightFences[_currentFrame], VK_TRUE, UINT64_MAX);
+	ReadCullStatistics();
 
 	uint32_t imageIndex;
 	VkResult result = vkAcquireNextImageKHR(_device, _swapChain, UINT64_MAX, _imageAvailableSemaphores[_currentFrame], VK_NULL_HANDLE, &imageIndex);
@@ -1790,33 +4040,85 @@ void RenderLoop::DrawFrame()
 		throw std::runtime_error("Failed to acquire swap chain image!");
 
 	vkResetFences(_device, 1, &_inFlightFences[_currentFrame]);
-	vkResetCommandBuffer(_commandBuffers[_currentFrame], 0);
-	RecordCommandBuffer(_commandBuffers[_currentFrame], imageIndex);
+	_memoryAllocator->UpdateHeapBudgets();
+	ProcessStreamedGeometry();
+	ReleaseCompletedFrames();
+	ReleaseCompletedUploads();
+	UpdateTextureStreaming();
+	float stagingThroughput;
+	if (_stagingRing.SampleThroughput(static_cast<float>(STAGING_THROUGHPUT_INTERVAL), stagingThroughput) && stagingThroughput > 0.f)
+		printf("Staging ring: %.1f MB/s\n", stagingThroughput);
+	// This frame's previous submission has completed, so its set can point at the current views again
+	WriteTextureDescriptors(_currentFrame);
+	const uint32_t slot = imageIndex * MAX_FRAMES_IN_FLIGHT + _currentFrame;
+	const auto recordingStart = std::chrono::steady_clock::now();
+	if (!_commandBufferCaching || _recordedRevisions[slot] != _sceneRevision || HasGeometryAcquiresReady())
+	{
+		vkResetCommandBuffer(_commandBuffers[slot], 0);
+		RecordCommandBuffer(_commandBuffers[slot], imageIndex);
+		// Acquire barriers have to execute exactly once, so a buffer holding them is never submitted again.
+		// Neither is one recorded without caching, its secondaries are one-time and turning caching on must not pick it up.
+		_recordedRevisions[slot] = !_commandBufferCaching || _frameTransferWaitValue != 0 ? 0 : _sceneRevision;
+	}
+	else
+		_frameTransferWaitValue = 0;
+	_recordingTime += std::chrono::steady_clock::now() - recordingStart;
 	UpdateUniformBuffer();
 
-	const VkSemaphore waitSemaphores[] = { _imageAvailableSemaphores[_currentFrame] };
+	// Uploads recorded since the last frame (residency changes, startup copies) go out in one submission ahead of the frame
+	const uint64_t uploadWaitValue = SubmitUploads();
+
+	// The transfer timeline is only waited on for values the host already saw completed, so it never stalls the frame. It still orders the acquire barriers after their releases.
+	// The upload timeline orders the frame after uploads it may read, which were submitted earlier on the same queue.
+	const VkSemaphore waitSemaphores[] = { _imageAvailableSemaphores[_currentFrame], _transferTimeline, _uploadContext->GetTimeline() };
 	const VkSemaphore signalSemaphores[] = { _renderFinishedSemaphores[_currentFrame] };
-	const VkPipelineStageFlags waitStages[] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
+	const VkPipelineStageFlags waitStages[] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT };
+	// The value for the binary semaphore is ignored
+	const uint64_t waitValues[] = { 0, _frameTransferWaitValue, uploadWaitValue };
+
+	VkTimelineSemaphoreSubmitInfo timelineInfo{};
+	timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+	timelineInfo.waitSemaphoreValueCount = 3;
+	timelineInfo.pWaitSemaphoreValues = waitValues;
 
 	VkSubmitInfo submitInfo{};
 	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-	submitInfo.waitSemaphoreCount = 1;
+	submitInfo.pNext = &timelineInfo;
+	submitInfo.waitSemaphoreCount = 3;
 	submitInfo.pWaitSemaphores = waitSemaphores;
 	submitInfo.pWaitDstStageMask = waitStages;
 	submitInfo.commandBufferCount = 1;
-	submitInfo.pCommandBuffers = &_commandBuffers[_currentFrame];
+	submitInfo.pCommandBuffers = &_commandBuffers[slot];
 	submitInfo.signalSemaphoreCount = 1;
 	submitInfo.pSignalSemaphores = signalSemaphores;
 
 	if (vkQueueSubmit(_graphicsQueue, 1, &submitInfo, _inFlightFences[_currentFrame]) != VK_SUCCESS)
 		throw std::runtime_error("Failed to submit draw command buffer!");
 
+	const VkSemaphore* presentWaitSemaphore = signalSemaphores;
+	if (NeedsPresentOwnershipTransfer())
+	{
+		const VkPipelineStageFlags acquireWaitStage = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+		VkSubmitInfo acquireInfo{};
+		acquireInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+		acquireInfo.waitSemaphoreCount = 1;
+		acquireInfo.pWaitSemaphores = signalSemaphores;
+		acquireInfo.pWaitDstStageMask = &acquireWaitStage;
+		acquireInfo.commandBufferCount = 1;
+		acquireInfo.pCommandBuffers = &_presentAcquireCommandBuffers[imageIndex];
+		acquireInfo.signalSemaphoreCount = 1;
+		acquireInfo.pSignalSemaphores = &_presentAcquiredSemaphores[_currentFrame];
+
+		if (vkQueueSubmit(_presentationQueue, 1, &acquireInfo, VK_NULL_HANDLE) != VK_SUCCESS)
+			throw std::runtime_error("Failed to submit the swap chain image acquire!");
+		presentWaitSemaphore = &_presentAcquiredSemaphores[_currentFrame];
+	}
 
 	const VkSwapchainKHR swapChains[] = { _swapChain };
 	VkPresentInfoKHR presentInfo{};
 	presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
 	presentInfo.waitSemaphoreCount = 1;
-	presentInfo.pWaitSemaphores = signalSemaphores;
+	presentInfo.pWaitSemaphores = presentWaitSemaphore;
 	presentInfo.swapchainCount = 1;
 	presentInfo.pSwapchains = swapChains;
 	presentInfo.pImageIndices = &imageIndex;
@@ -1832,6 +4134,13 @@ void RenderLoop::DrawFrame()
 		throw std::runtime_error("Failed to present swap chain image!");
 
 	_currentFrame = (_currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
+	++_frameNumber;
+}
+
+void RenderLoop::ReadCullStatistics()
+{
+	// The frame's fence signaled, so its region holds what its last submission counted
+	memcpy(&_cullStatistics, static_cast<char*>(_cullStatisticsBufferAllocation.mapped) + _currentFrame * _cullStatisticsRegionSize, sizeof(CullStatistics));
 }
 
 void RenderLoop::UpdateUniformBuffer()
@@ -1845,16 +4154,11 @@ void RenderLoop::UpdateUniformBuffer()
 	_inputManager->HandleKeyHeldEvents();
 	_inputManager->HandleMouseButtonHeldEvents();
 
-	// Update transforms
-	for (size_t i = 0; i < _modelTransforms[_models.data()]->size(); ++i)
-	{
-		(*_modelTransforms[_models.data()])[i] = rotate((*_modelTransforms[_models.data()])[i], _deltaTime.count() * glm::radians(-180.f), glm::vec3(0.f, 1.f, 0.f));
-	}
-
 	// Copy updated camera data to GPU mapped memory
 	memcpy(_uniformBuffersMapped[_currentFrame], &_camera, sizeof(_camera));
-	// Do the same for all the transforms
-	CopyTransformsToDevice();
+	// Transforms are animated on the device, this frame's command buffer advances them by the delta time
+	const float deltaTime = _deltaTime.count();
+	memcpy(static_cast<char*>(_animationClockBufferAllocation.mapped) + _currentFrame * _animationClockRegionSize, &deltaTime, sizeof(float));
 }
 
 void RenderLoop::MainLoop()
@@ -1866,18 +4170,51 @@ void RenderLoop::MainLoop()
 	}
 
 	vkDeviceWaitIdle(_device);
+	StopStreaming();
 }
 
-void RenderLoop::CleanupSwapChain() const
+void RenderLoop::StopStreaming()
 {
-	vkDestroyImageView(_device, _depthImageView, nullptr);
-	vkDestroyImage(_device, _depthImage, nullptr);
-	vkFreeMemory(_device, _depthImageMemory, nullptr);
+	// Meshes still queued are dropped, the ones being decoded right now are finished first
+	_jobSystem.reset();
 
-	vkDestroyImageView(_device, _colorImageView, nullptr);
-	vkDestroyImage(_device, _colorImage, nullptr);
-	vkFreeMemory(_device, _colorImageMemory, nullptr);
+	_streamedGeometry.clear();
+	_geometryUploadsInProgress.clear();
+
+	// The device is idle, so every transfer and upload has completed
+	while (!_transferDeletionQueue.empty())
+	{
+		_transferDeletionQueue.front().second();
+		_transferDeletionQueue.pop_front();
+	}
+	while (!_uploadDeletionQueue.empty())
+	{
+		_uploadDeletionQueue.front().second();
+		_uploadDeletionQueue.pop_front();
+	}
+
+	// Residency changes still in flight are dropped, the textures keep the levels they had
+	for (const auto& change : _textureResidencyChanges)
+	{
+		vkDestroyImageView(_device, change.replacement.view, nullptr);
+		vkDestroyImage(_device, change.replacement.image, nullptr);
+		_memoryAllocator->Free(change.replacement.allocation);
+	}
+	_textureResidencyChanges.clear();
+
+	while (!_frameDeletionQueue.empty())
+	{
+		_frameDeletionQueue.front().second();
+		_frameDeletionQueue.pop_front();
+	}
+
+	for (const auto& [image, stream] : _textureStreams)
+		ktxTexture_Destroy(stream.source);
+	_textureStreams.clear();
+}
 
+void RenderLoop::CleanupSwapChain() const
+{
 	for (const auto framebuffer : _swapChainFrameBuffers)
 	{
 		vkDestroyFramebuffer(_device, framebuffer, nullptr);
@@ -1886,9 +4223,59 @@ void RenderLoop::CleanupSwapChain() const
 	{
 		vkDestroyImageView(_device, imageView, nullptr);
 	}
+	if (!_presentAcquireCommandBuffers.empty())
+		vkFreeCommandBuffers(_device, _presentCommandPool, static_cast<uint32_t>(_presentAcquireCommandBuffers.size()), _presentAcquireCommandBuffers.data());
 	vkDestroySwapchainKHR(_device, _swapChain, nullptr);
 }
 
+void RenderLoop::CleanupMultisampledAttachments() const
+{
+	vkDestroyImageView(_device, _depthImageView, nullptr);
+	vkDestroyImage(_device, _depthImage, nullptr);
+	_memoryAllocator->Free(_depthImageAllocation);
+
+	vkDestroyImageView(_device, _colorImageView, nullptr);
+	vkDestroyImage(_device, _colorImage, nullptr);
+	_memoryAllocator->Free(_colorImageAllocation);
+}
+
+void RenderLoop::CleanupAttachments() const
+{
+	CleanupMultisampledAttachments();
+
+	vkDestroyImageView(_device, _depthResolveImageView, nullptr);
+	vkDestroyImage(_device, _depthResolveImage, nullptr);
+	_memoryAllocator->Free(_depthResolveImageAllocation);
+}
+
+void RenderLoop::CleanupDepthPyramid()
+{
+	// Destroying the pool frees the sets of every level
+	vkDestroyDescriptorPool(_device, _depthPyramidDescriptorPool, nullptr);
+	_depthPyramidSets.clear();
+	for (const auto view : _depthPyramidLevelViews)
+		vkDestroyImageView(_device, view, nullptr);
+	_depthPyramidLevelViews.clear();
+	vkDestroyImageView(_device, _depthPyramidView, nullptr);
+	vkDestroyImage(_device, _depthPyramid, nullptr);
+	_memoryAllocator->Free(_depthPyramidAllocation);
+}
+
+void RenderLoop::CleanupCommandBuffers()
+{
+	if (!_commandBuffers.empty())
+		vkFreeCommandBuffers(_device, _commandPool, static_cast<uint32_t>(_commandBuffers.size()), _commandBuffers.data());
+	_commandBuffers.clear();
+	_recordedRevisions.clear();
+
+	// Destroying a pool frees its secondary command buffer
+	for (const auto pool : _recordingCommandPools)
+		vkDestroyCommandPool(_device, pool, nullptr);
+	_recordingCommandPools.clear();
+	_earlyRecordingCommandBuffers.clear();
+	_recordingCommandBuffers.clear();
+}
+
 void RenderLoop::CleanupModels() const
 {
 	for (const auto& model : _models)
@@ -1896,14 +4283,20 @@ void RenderLoop::CleanupModels() const
 		for (const auto& texture : model.textures)
 		{
 			vkDestroyImageView(_device, texture.view, nullptr);
-			ktxVulkanTexture_Destruct(const_cast<ktxVulkanTexture*>(&texture.texture), _device, nullptr);
-			vkDestroySampler(_device, texture.sampler, nullptr);
+			vkDestroyImage(_device, texture.image, nullptr);
+			_memoryAllocator->Free(texture.allocation);
+			_samplerCache->Release(texture.sampler);
 		}
 	}
+
+	vkDestroyImageView(_device, _defaultTexture.view, nullptr);
+	vkDestroyImage(_device, _defaultTexture.image, nullptr);
+	_memoryAllocator->Free(_defaultTexture.allocation);
+	_samplerCache->Release(_defaultTexture.sampler);
 }
 
 // TODO: Sort function into smaller functions like CleanupSwapChain to better label what is getting cleaned up and when.
-void RenderLoop::Cleanup() const
+void RenderLoop::Cleanup()
 {
 	if (VALIDATION_LAYERS_ENABLED)
 		(void)DestroyDebugUtilsMessengerEXT(nullptr);
@@ -1914,24 +4307,42 @@ void RenderLoop::Cleanup() const
 		vkDestroySemaphore(_device, _renderFinishedSemaphores[i], nullptr);
 		vkDestroyFence(_device, _inFlightFences[i], nullptr);
 	}
+	for (const auto semaphore : _presentAcquiredSemaphores)
+		vkDestroySemaphore(_device, semaphore, nullptr);
+	vkDestroySemaphore(_device, _transferTimeline, nullptr);
 
 	CleanupSwapChain();
+	CleanupAttachments();
+	CleanupDepthPyramid();
 
 	vkDestroyBuffer(_device, _vertexBuffer, nullptr);
-	vkFreeMemory(_device, _vertexBufferMemory, nullptr);
+	_memoryAllocator->Free(_vertexBufferAllocation);
 	vkDestroyBuffer(_device, _indexBuffer, nullptr);
-	vkFreeMemory(_device, _indexBufferMemory, nullptr);
+	_memoryAllocator->Free(_indexBufferAllocation);
 
-	vkUnmapMemory(_device, _transformStagingBufferMemory);
-	vkDestroyBuffer(_device, _transformStagingBuffer, nullptr);
-	vkFreeMemory(_device, _transformStagingBufferMemory, nullptr);
+	vkDestroyBuffer(_device, _stagingRingBuffer, nullptr);
+	_memoryAllocator->Free(_stagingRingAllocation);
 	vkDestroyBuffer(_device, _transformBuffer, nullptr);
-	vkFreeMemory(_device, _transformBufferMemory, nullptr);
+	_memoryAllocator->Free(_transformBufferAllocation);
+	vkDestroyBuffer(_device, _animationBuffer, nullptr);
+	_memoryAllocator->Free(_animationBufferAllocation);
+	vkDestroyBuffer(_device, _animationClockBuffer, nullptr);
+	_memoryAllocator->Free(_animationClockBufferAllocation);
+	vkDestroyBuffer(_device, _drawStagingBuffer, nullptr);
+	_memoryAllocator->Free(_drawStagingBufferAllocation);
+	vkDestroyBuffer(_device, _drawBuffer, nullptr);
+	_memoryAllocator->Free(_drawBufferAllocation);
+	vkDestroyBuffer(_device, _visibleInstanceBuffer, nullptr);
+	_memoryAllocator->Free(_visibleInstanceBufferAllocation);
+	vkDestroyBuffer(_device, _instanceVisibilityBuffer, nullptr);
+	_memoryAllocator->Free(_instanceVisibilityBufferAllocation);
+	vkDestroyBuffer(_device, _cullStatisticsBuffer, nullptr);
+	_memoryAllocator->Free(_cullStatisticsBufferAllocation);
 
 	for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i)
 	{
 		vkDestroyBuffer(_device, _uniformBuffers[i], nullptr);
-		vkFreeMemory(_device, _uniformBuffersMemory[i], nullptr);
+		_memoryAllocator->Free(_uniformBuffersAllocation[i]);
 	}
 
 	// Textures
@@ -1940,13 +4351,32 @@ void RenderLoop::Cleanup() const
 	vkDestroyDescriptorPool(_device, _descriptorPool, nullptr);
 	vkDestroyDescriptorSetLayout(_device, _descriptorSetLayout, nullptr);
 
-	vkDestroyPipeline(_device, _graphicsPipeline, nullptr);
+	for (const auto pipeline : _graphicsPipelines)
+		vkDestroyPipeline(_device, pipeline, nullptr);
 	vkDestroyPipelineLayout(_device, _pipelineLayout, nullptr);
+	vkDestroyPipeline(_device, _cullPipeline, nullptr);
+	vkDestroyPipelineLayout(_device, _cullPipelineLayout, nullptr);
+	vkDestroyPipeline(_device, _animationPipeline, nullptr);
+	vkDestroyPipelineLayout(_device, _animationPipelineLayout, nullptr);
+	vkDestroyPipeline(_device, _depthPyramidPipeline, nullptr);
+	vkDestroyPipelineLayout(_device, _depthPyramidPipelineLayout, nullptr);
+	vkDestroyDescriptorSetLayout(_device, _depthPyramidSetLayout, nullptr);
+	_samplerCache->Release(_depthPyramidSampler);
+	vkDestroyRenderPass(_device, _earlyRenderPass, nullptr);
 	vkDestroyRenderPass(_device, _renderPass, nullptr);
+	vkDestroyRenderPass(_device, _singleRenderPass, nullptr);
 
+	_uploadContext.reset();
+	_recordingJobSystem.reset();
+	CleanupCommandBuffers();
 	vkDestroyCommandPool(_device, _commandPool, nullptr);
 	vkDestroyCommandPool(_device, _transferCommandPool, nullptr);
+	if (_presentCommandPool != nullptr)
+		vkDestroyCommandPool(_device, _presentCommandPool, nullptr);
 
+	_samplerCache->Clear();
+	_memoryAllocator->PrintStatistics();
+	_memoryAllocator.reset();
 	vkDestroyDevice(_device, nullptr);
 	vkDestroySurfaceKHR(_instance, _surface, nullptr);
 	vkDestroyInstance(_instance, nullptr);
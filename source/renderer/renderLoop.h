@@ -7,8 +7,13 @@
 #define RENDERER_RENDERLOOP_API __declspec(dllimport)
 #endif
 
+#include <array>
 #include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 #define NOMINMAX
@@ -18,12 +23,24 @@
 #define GLFW_EXPOSE_NATIVE_WIN32
 //#include <GLFW/glfw3native.h>
 #include <chrono>
-#include <ktxvulkan.h>
 #include <memory>
 
 #include "Camera.h"
+#include "CullStatistics.h"
+#include "DeviceMemoryAllocator.h"
+#include "DrawData.h"
 #include "FHEImage.h"
+#include "InstanceAnimation.h"
+#include "GeometryUpload.h"
+#include "JobSystem.h"
+#include "MemoryBudget.h"
 #include "Model.h"
+#include "RangeAllocator.h"
+#include "SamplerCache.h"
+#include "StagingRing.h"
+#include "TextureResidencyChange.h"
+#include "TextureStreamState.h"
+#include "UploadContext.h"
 #include "../core/FHEMacros.h"
 
 class InputManager;
@@ -37,6 +54,15 @@ extern "C"
 	public:
 		RENDERER_RENDERLOOP_API explicit RenderLoop(const std::string& windowName, const std::string& appName, const int32_t& width = 800, const int32_t& height = 600);
 		RENDERER_RENDERLOOP_API void Run();
+		// Highest MSAA sample count to render with, lowered to what the device supports. Must be a power of two and set before Run.
+		RENDERER_RENDERLOOP_API void SetMaxMsaaSamples(const uint32_t& sampleCount);
+		// Renders frameCount frames with resources shared concurrently across queue families, then again with exclusive ownership, and prints the frame times
+		RENDERER_RENDERLOOP_API static void BenchmarkSharingModes(const std::string& windowName, const std::string& appName, const uint32_t& frameCount);
+		// Renders frameCount frames for every number of recording threads from one up to all workers, then with cached command buffers, and prints the time spent recording per frame
+		RENDERER_RENDERLOOP_API static void BenchmarkRecording(const std::string& windowName, const std::string& appName, const uint32_t& frameCount);
+		// Renders frameCount frames of a view along the school, where most fish hide behind closer ones, with frustum culling only and then with
+		// occlusion culling as well, and prints the frame times and the cull statistics
+		RENDERER_RENDERLOOP_API static void BenchmarkOcclusionCulling(const std::string& windowName, const std::string& appName, const uint32_t& frameCount);
 	private:
 		int32_t _windowWidth;
 		int32_t _windowHeight;
@@ -52,6 +78,20 @@ extern "C"
 		VkQueue _graphicsQueue;
 		VkQueue _presentationQueue;
 		VkQueue _transferQueue;
+		uint32_t _graphicsQueueFamily;
+		uint32_t _transferQueueFamily;
+		uint32_t _presentQueueFamily;
+		// Every distinct family, for the few resources that are shared concurrently
+		std::vector<uint32_t> _concurrentQueueFamilies;
+		// Sharing mode of buffers and swap chain images that have no reason to pick one themselves
+		VkSharingMode _defaultSharingMode;
+		// FHETextureCompression families that are both enabled on the device and sampleable, Basis textures are transcoded to the best of them
+		uint32_t _textureCompression;
+		float _maxSamplerAnisotropy;
+		std::unique_ptr<SamplerCache> _samplerCache;
+		std::unique_ptr<DeviceMemoryAllocator> _memoryAllocator;
+		// VK_EXT_memory_budget is enabled, so heap budgets come from the driver instead of a share of the heap size
+		bool _memoryBudgetSupported;
 
 		VkSwapchainKHR _swapChain;
 		VkFormat _swapChainImageFormat;
@@ -64,41 +104,168 @@ extern "C"
 		VkDescriptorPool _descriptorPool;
 		std::vector<VkDescriptorSet> _descriptorSets;
 
+		// The early pass draws what was visible last frame and keeps depth for the depth pyramid, _renderPass then adds the instances the
+		// pyramid found newly visible and resolves. Without occlusion culling _singleRenderPass draws and resolves on its own. All three
+		// are compatible, so the pipelines, framebuffers and secondaries work with any of them.
+		VkRenderPass _earlyRenderPass;
 		VkRenderPass _renderPass;
+		VkRenderPass _singleRenderPass;
 		VkPipelineLayout _pipelineLayout;
-		VkPipeline _graphicsPipeline;
+		// One per vertex layout, they only differ in their vertex input state
+		std::array<VkPipeline, FHE_VERTEX_LAYOUT_COUNT> _graphicsPipelines;
+		// Frustum and occlusion culling ahead of each render pass, binds the same descriptor sets as the graphics pipelines
+		VkPipelineLayout _cullPipelineLayout;
+		VkPipeline _cullPipeline;
+		// Writes this frame's transforms from the instance animations ahead of culling
+		VkPipelineLayout _animationPipelineLayout;
+		VkPipeline _animationPipeline;
 
 		VkCommandPool _commandPool;
 		VkCommandPool _transferCommandPool;
+		// One per swap chain image and frame in flight, indexed imageIndex * MAX_FRAMES_IN_FLIGHT + frame. With _commandBufferCaching a
+		// buffer is submitted again as long as it was recorded at the current _sceneRevision, per-frame data only changes in buffers.
 		std::vector<VkCommandBuffer> _commandBuffers;
-
+		std::vector<uint64_t> _recordedRevisions;
+		uint64_t _sceneRevision;
+		bool _commandBufferCaching;
+		// Draws are recorded by _recordingJobSystem into secondary command buffers, one slice of the draw list each. Every slice has its own
+		// pool per primary command buffer, indexed slot * _recordingSliceCount + slice, so a pool is only ever used by the thread recording that slice.
+		// A slice writes the indirect draw records of its models and draws them with one vkCmdDrawIndexedIndirectCount per draw bucket.
+		std::unique_ptr<JobSystem> _recordingJobSystem;
+		uint32_t _recordingSliceCount;
+		std::vector<VkCommandPool> _recordingCommandPools;
+		std::vector<VkCommandBuffer> _earlyRecordingCommandBuffers;
+		std::vector<VkCommandBuffer> _recordingCommandBuffers;
+		// Forces the number of slices when not 0, for the recording benchmark
+		uint32_t _recordingSliceLimit;
+		std::chrono::duration<float, std::milli> _recordingTime;
+		// Only used when presentation happens on another family than rendering: exclusive swap chain images are acquired there
+		// by one prerecorded command buffer per image, and presenting waits for that instead of the render
+		VkCommandPool _presentCommandPool;
+		std::vector<VkCommandBuffer> _presentAcquireCommandBuffers;
+		std::vector<VkSemaphore> _presentAcquiredSemaphores;
+
+		// Geometry arena: every model's vertices and indices are sub-allocated from these two buffers, so all draws share one bind
 		VkBuffer _vertexBuffer;
-		VkDeviceMemory _vertexBufferMemory;
+		FHEAllocation _vertexBufferAllocation;
+		RangeAllocator _vertexArena;
 		VkBuffer _indexBuffer;
-		VkDeviceMemory _indexBufferMemory;
-
-		void* _transformStagingData;
+		FHEAllocation _indexBufferAllocation;
+		RangeAllocator _indexArena;
+
+		// Streaming: workers load meshes, the main thread stages them and copies them on the transfer queue and frames acquire them once the timeline passes
+		std::unique_ptr<JobSystem> _jobSystem;
+		std::mutex _streamedGeometryMutex;
+		std::vector<GeometryUpload> _streamedGeometry;
+		std::vector<GeometryUpload> _pendingGeometryAcquires;
+		VkSemaphore _transferTimeline;
+		uint64_t _transferTimelineValue;
+		uint64_t _frameTransferWaitValue;
+		// Staging ring batches and command buffers are released once the transfer timeline reaches the paired value
+		std::deque<std::pair<uint64_t, std::function<void()>>> _transferDeletionQueue;
+		// Placed in the arena but not fully staged yet, continued every frame in order
+		std::vector<GeometryUpload> _geometryUploadsInProgress;
+
+		// Every upload is staged through this one persistently mapped buffer
+		VkBuffer _stagingRingBuffer;
+		FHEAllocation _stagingRingAllocation;
+		StagingRing _stagingRing;
+		// One-time commands on the graphics queue are batched here, frames wait for them on its timeline instead of the queue idling
+		std::unique_ptr<UploadContext> _uploadContext;
+		// Staging ring batches read by submitted uploads, released once the upload timeline reaches the paired value
+		std::deque<std::pair<uint64_t, std::function<void()>>> _uploadDeletionQueue;
+
+		// Mip streaming: textures with a stored chain keep only the levels their on-screen size needs
+		std::unordered_map<const FHEImage*, TextureStreamState> _textureStreams;
+		std::vector<TextureResidencyChange> _textureResidencyChanges;
+		// Bindless table slots handed out so far
+		uint32_t _textureSlotCount;
+		// Opaque white texel in slot 0, sampled by draws of models without a texture
+		FHEImage _defaultTexture;
+		// Textures whose table entry is stale, with one bit per frame in flight whose descriptor set still has to be written
+		std::unordered_map<const FHEImage*, uint32_t> _dirtyTextureDescriptors;
+		uint64_t _frameNumber;
+		// Resources a frame in flight may still use, destroyed once _frameNumber reaches the paired value
+		std::deque<std::pair<uint64_t, std::function<void()>>> _frameDeletionQueue;
+
+		// Transforms live in a ring with one region per frame in flight, so a frame never overwrites data a pending frame still reads.
+		// animate.comp writes a frame's region from _animationBuffer, which holds the rest transforms and the current angles.
 		VkDeviceSize _transformBufferSize;
-		VkBuffer _transformStagingBuffer;
-		VkDeviceMemory _transformStagingBufferMemory;
+		VkDeviceSize _transformRegionSize;
 		VkBuffer _transformBuffer;
-		VkDeviceMemory _transformBufferMemory;
+		FHEAllocation _transformBufferAllocation;
+		VkBuffer _animationBuffer;
+		FHEAllocation _animationBufferAllocation;
+		// The delta time of each frame in flight, the only thing the host writes for animation every frame
+		VkDeviceSize _animationClockRegionSize;
+		VkBuffer _animationClockBuffer;
+		FHEAllocation _animationClockBufferAllocation;
+
+		// Indirect draws, written to the staging ring when a slot is recorded and copied to _drawBuffer by every frame that uses them.
+		// A region per frame in flight holds one draw count per slice and bucket, then the VkDrawIndexedIndirectCommand records, then their DrawData.
+		// Everything past the staging copy only reads _drawBuffer, so compute can rewrite records and counts there.
+		// Records arrive with no instances, cull.comp appends the visible ones to the model's range of _visibleInstanceBuffer and counts them
+		// into every record of the model, one slot per instance of the model however many submesh records share it.
+		// The late phase has its own records after the early ones, with their instance ranges in the second half of the visible instance region.
+		void* _drawStagingData;
+		VkDeviceSize _drawRegionSize;
+		VkDeviceSize _drawCommandOffset;
+		VkDeviceSize _lateDrawCommandOffset;
+		VkDeviceSize _drawDataOffset;
+		VkBuffer _drawStagingBuffer;
+		FHEAllocation _drawStagingBufferAllocation;
+		VkBuffer _drawBuffer;
+		FHEAllocation _drawBufferAllocation;
+		VkDeviceSize _visibleInstanceRegionSize;
+		VkBuffer _visibleInstanceBuffer;
+		FHEAllocation _visibleInstanceBufferAllocation;
+		// Whether each instance passed the late phase, a region per frame in flight that the next frame reads
+		uint32_t _instanceCount;
+		VkBuffer _instanceVisibilityBuffer;
+		FHEAllocation _instanceVisibilityBufferAllocation;
+		// A host visible CullStatistics per frame in flight, read back once the frame's fence signaled
+		VkDeviceSize _cullStatisticsRegionSize;
+		VkBuffer _cullStatisticsBuffer;
+		FHEAllocation _cullStatisticsBufferAllocation;
+		CullStatistics _cullStatistics;
+		// Without it only the early phase runs, in _singleRenderPass, and draws everything inside the frustum. Changed through SetOcclusionCulling.
+		bool _occlusionCulling;
 
 		std::vector<VkBuffer> _uniformBuffers;
-		std::vector<VkDeviceMemory> _uniformBuffersMemory;
+		std::vector<FHEAllocation> _uniformBuffersAllocation;
 		std::vector<void*> _uniformBuffersMapped;
 
 		// TODO: Create attachment image struct, potentially with some of the helper functions moved to that file instead of here.
 		VkImage _depthImage;
-		VkDeviceMemory _depthImageMemory;
+		FHEAllocation _depthImageAllocation;
 		VkImageView _depthImageView;
 
 		VkImage _colorImage;
-		VkDeviceMemory _colorImageMemory;
+		FHEAllocation _colorImageAllocation;
 		VkImageView _colorImageView;
 
+		// Single-sampled depth the early pass resolves into, the source of the depth pyramid
+		VkImage _depthResolveImage;
+		FHEAllocation _depthResolveImageAllocation;
+		VkImageView _depthResolveImageView;
+
+		// Farthest depth of the early pass, level 0 at half the frame's resolution. Always in VK_IMAGE_LAYOUT_GENERAL, as every level is
+		// written as a storage image and then sampled for the next one. Each level is built with its own descriptor set.
+		VkImage _depthPyramid;
+		FHEAllocation _depthPyramidAllocation;
+		VkImageView _depthPyramidView;
+		std::vector<VkImageView> _depthPyramidLevelViews;
+		VkExtent2D _depthPyramidExtent;
+		VkSampler _depthPyramidSampler;
+		VkDescriptorSetLayout _depthPyramidSetLayout;
+		VkDescriptorPool _depthPyramidDescriptorPool;
+		std::vector<VkDescriptorSet> _depthPyramidSets;
+		VkPipelineLayout _depthPyramidPipelineLayout;
+		VkPipeline _depthPyramidPipeline;
+
 		VkDebugUtilsMessengerEXT _debugMessenger;
 
+		VkSampleCountFlagBits _maxMsaaSamples;
 		VkSampleCountFlagBits _msaaSamples = VK_SAMPLE_COUNT_1_BIT;
 
 		// TODO: Move into separate timing class. Potentially move the semaphores and fences there as well?
@@ -122,9 +289,44 @@ extern "C"
 		const static bool VALIDATION_LAYERS_ENABLED = IS_DEBUGGING_TERNARY(true, false);
 		const static bool RENDER_ONLY_FIRST_INSTANCE = false;
 		const static std::vector<const char*> DEVICE_EXTENSIONS;
+		// Soft and hard limits per FHEMemoryCategory, streamed textures are the only ones that can give memory back
+		const static std::array<MemoryBudget, FHE_MEMORY_CATEGORY_COUNT> MEMORY_BUDGETS;
 		const static uint32_t MAX_FRAMES_IN_FLIGHT = 2;
+		// Highest MSAA sample count used unless SetMaxMsaaSamples says otherwise, the attachments grow linearly with it
+		const static VkSampleCountFlagBits DEFAULT_MAX_MSAA_SAMPLES = VK_SAMPLE_COUNT_4_BIT;
+		// Frames rendered before the benchmarks start timing, enough for the initial uploads to settle
+		const static uint32_t BENCHMARK_WARMUP_FRAMES = 120;
+		// Fewer draws than this per slice are not worth handing to another thread
+		const static uint32_t MIN_DRAWS_PER_RECORDING_SLICE = 256;
+		// Records per frame in flight, a draw being one submesh of one model with all its instances
+		const static uint32_t MAX_INDIRECT_DRAWS = 16384;
+		// Matches local_size in depthpyramid.comp
+		const static uint32_t DEPTH_PYRAMID_GROUP_SIZE = 8;
+		// Matches local_size in animate.comp
+		const static uint32_t ANIMATION_GROUP_SIZE = 64;
+		// Draws sharing a pipeline and an index type, one per vertex layout and 16 or 32-bit indices
+		const static uint32_t DRAW_BUCKET_COUNT = FHE_VERTEX_LAYOUT_COUNT * 2;
+		// Buffer offsets of copies into images must be multiples of 4 as well as of the texel block size
+		const static VkDeviceSize TEXTURE_COPY_OFFSET_ALIGNMENT = 4;
+		const static VkDeviceSize GEOMETRY_STAGING_ALIGNMENT = 4;
+		// Every upload goes through this one persistently mapped buffer instead of allocating its own
+		const static VkDeviceSize STAGING_RING_SIZE = 64ull * 1024 * 1024;
+		// Streamed geometry is copied into the ring on the main thread, this bounds the cost per frame
+		const static VkDeviceSize MAX_STAGED_GEOMETRY_PER_FRAME = 16ull * 1024 * 1024;
+		// Seconds between the staging throughput reports
+		const static uint32_t STAGING_THROUGHPUT_INTERVAL = 1;
+		// Streamed textures load their levels up to this size up front, finer ones follow once visible
+		const static uint32_t TEXTURE_STREAMING_INITIAL_EXTENT = 128;
+		const static uint32_t MAX_TEXTURE_RESIDENCY_CHANGES = 2;
+		// Size of the bindless texture array at binding 2, bounds the number of textures loaded at once
+		const static uint32_t MAX_BINDLESS_TEXTURES = 4096;
 		const static uint32_t FISH_WIDTH_COUNT = 11;
 		const static uint32_t FISH_DEPTH_COUNT = 9;
+		// Spin of every fish around its own y axis
+		const static int32_t FISH_DEGREES_PER_SECOND = -180;
+		// Initial arena sizes, they double whenever an upload does not fit
+		const static VkDeviceSize GEOMETRY_ARENA_VERTEX_SIZE = 16ull * 1024 * 1024;
+		const static VkDeviceSize GEOMETRY_ARENA_INDEX_SIZE = 8ull * 1024 * 1024;
 		const static std::string SHADER_PATH;
 		const static std::string MODEL_PATH;
 		const static std::string TEXTURE_PATH;
@@ -143,28 +345,41 @@ extern "C"
 		void CreateSurface();
 		void CreateInstance();
 		void CreateLogicalDevice(const QueueFamilyIndices& indices);
-		void CreateSwapChain(const QueueFamilyIndices& indices);
+		void CreateSwapChain();
 		void CreateImageViews();
 		void CreateRenderPass();
 		void CreateDescriptorSetLayout();
 		void CreateGraphicsPipeline();
+		void CreateCullPipeline();
+		void CreateDepthPyramidPipeline();
+		void CreateAnimationPipeline();
 		void CreateFrameBuffers();
+		void CreateStagingRing();
 		void CreateCommandPool(const QueueFamilyIndices& queueFamilyIndices);
+		void CreatePresentAcquireCommandBuffers();
 		void CreateDepthResources();
 		void CreateColorResources();
+		void CreateDepthResolveResources();
+		// TRANSIENT_ATTACHMENT unless occlusion culling stores the multisampled attachments between its passes
+		[[nodiscard]] VkImageUsageFlags GetMultisampledAttachmentUsage() const;
+		void CreateDepthPyramid();
 		void CreateTextures();
+		void CreateDefaultTexture();
 		void LoadModels();
 		void SetupCamera();
-		void CreateVertexBuffer();
-		void CreateIndexBuffer();
+		void CreateGeometryArena();
 		void CreateTransformBuffer();
+		void CreateDrawBuffer();
 		void CreateUniformBuffers();
 		void CreateDescriptorPool();
 		void CreateDescriptorSets();
 		void CreateCommandBuffers();
+		void CreateRecordingCommandBuffers();
 		void CreateSyncObjects();
 
 		void RecreateSwapChain();
+		// Rebuilds the multisampled attachments for the new mode and has every command buffer recorded again
+		void SetOcclusionCulling(const bool& occlusionCulling);
 
 
 		static void PopulateDebugMessengerCreateInfo(VkDebugUtilsMessengerCreateInfoEXT& createInfo);
@@ -179,43 +394,91 @@ extern "C"
 		[[nodiscard]] SwapChainSupportDetails QuerySwapChainSupport(VkPhysicalDevice device) const;
 
 		[[nodiscard]] VkShaderModule CreateShaderModule(const std::vector<char>& shaderCode) const;
-		void CreateBuffer(const VkDeviceSize& size, const VkBufferUsageFlags& usage, const VkMemoryPropertyFlags& properties, VkBuffer& buffer, VkDeviceMemory& bufferMemory) const;
-		void CopyBuffer(const VkBuffer& srcBuffer, const VkBuffer& dstBuffer, const VkDeviceSize& size) const;
+		void CreateBuffer(const VkDeviceSize& size, const VkBufferUsageFlags& usage, const VkMemoryPropertyFlags& properties, VkBuffer& buffer, FHEAllocation& bufferAllocation, const FHEMemoryCategory& category, const VkSharingMode& sharingMode = VK_SHARING_MODE_EXCLUSIVE, const FHEMemoryLifetime& lifetime = FHE_MEMORY_LIFETIME_PERSISTENT) const;
+		// CopyBuffer, CopyBufferToImage and TransitionImageLayout only record into the open upload batch, SubmitUploads sends it
+		void CopyBuffer(const VkBuffer& srcBuffer, const VkBuffer& dstBuffer, const VkDeviceSize& size, const VkDeviceSize& srcOffset = 0, const VkDeviceSize& dstOffset = 0) const;
+		void RequestModelGeometry(Model& model, const std::string& filePath);
+		void PlaceModelGeometry(Model& model);
+		void FreeModelGeometry(Model& model);
+		[[nodiscard]] VkDeviceSize AllocateGeometry(VkBuffer& buffer, FHEAllocation& bufferAllocation, RangeAllocator& arena, const VkDeviceSize& size, const VkDeviceSize& alignment, const VkBufferUsageFlags& usage);
+		void GrowGeometryBuffer(VkBuffer& buffer, FHEAllocation& bufferAllocation, RangeAllocator& arena, const VkDeviceSize& newSize, const VkBufferUsageFlags& usage);
 		void CopyBufferToImage(const VkBuffer& buffer, const VkImage& image, const uint32_t& width, const uint32_t& height) const;
-		void CopyTransformsToDevice();
-		void CreateImage(const uint32_t& width, const uint32_t& height, const uint32_t& mipLevels, const VkSampleCountFlagBits& numSample, const VkFormat& format, const VkImageTiling& tiling, const VkImageUsageFlags& usage, const VkMemoryPropertyFlags& properties, VkImage& image, VkDeviceMemory& imageMemory) const;
-		void CreateImageView(const VkImage& image, const VkFormat& format, const VkImageAspectFlags& aspectFlags, const uint32_t& mipLevels, VkImageView& imageView) const;
-		// TODO: Make parameters aside from the first 3 into a struct to simplify signature
-		void LoadTexture(std::string filePath, VkImageView& targetView, ktxVulkanTexture& targetTexture, const VkImageTiling& tiling = VK_IMAGE_TILING_OPTIMAL, const VkImageUsageFlags& usage = VK_IMAGE_USAGE_SAMPLED_BIT, const VkImageLayout& layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, const ktxTextureCreateFlagBits& createFlags = KTX_TEXTURE_CREATE_NO_FLAGS) const;
+		// Animates every instance into this frame's transform region
+		void RecordAnimation(const VkCommandBuffer& commandBuffer) const;
+		// Copies the counts and the first drawCount records of this frame's region and makes them visible to the indirect draws
+		void RecordDrawCopy(const VkCommandBuffer& commandBuffer, const uint32_t& drawCount) const;
+		// Fills in the instances of the first drawCount records of this frame for phase 0 (early) or 1 (late)
+		void RecordCulling(const VkCommandBuffer& commandBuffer, const uint32_t& drawCount, const uint32_t& phase) const;
+		void RecordDepthPyramid(const VkCommandBuffer& commandBuffer) const;
+		// Points every frame's set at the current depth pyramid, which is rebuilt with the attachments
+		void WriteDepthPyramidDescriptors();
+		void CreateImage(const uint32_t& width, const uint32_t& height, const uint32_t& mipLevels, const VkSampleCountFlagBits& numSample, const VkFormat& format, const VkImageTiling& tiling, const VkImageUsageFlags& usage, const VkMemoryPropertyFlags& properties, VkImage& image, FHEAllocation& imageAllocation, const FHEMemoryCategory& category, const VkMemoryPropertyFlags& preferredProperties = 0) const;
+		void CreateImageView(const VkImage& image, const VkFormat& format, const VkImageAspectFlags& aspectFlags, const uint32_t& mipLevels, VkImageView& imageView, const uint32_t& baseMipLevel = 0) const;
+		void LoadTextures(const std::vector<std::string>& filePaths, const std::vector<FHEImage*>& targets);
 		void TransitionImageLayout(const VkImage& image, const VkFormat& format, const VkImageLayout& oldLayout, const VkImageLayout& newLayout, const uint32_t& mipLevels) const;
 		void CreateSampler(FHEImage& image) const;
 
-		void BeginSingleTimeCommand(VkCommandBuffer& commandBuffer) const;
-		void EndSingleTimeCommands(const VkCommandBuffer& commandBuffer) const;
+		// Everything staged through the ring has to be submitted before the geometry path closes the next ring batch
+		[[nodiscard]] uint64_t SubmitUploads();
+		void WaitForUploads(const uint64_t& value);
 
 		[[nodiscard]] QueueFamilyIndices FindQueueFamilies(const VkPhysicalDevice& physicalDevice) const;
 		static void GetUniqueQueueFamilyIndices(const QueueFamilyIndices& indices, std::vector<uint32_t>& queueFamilyIndices);
+		[[nodiscard]] bool NeedsPresentOwnershipTransfer() const;
+		[[nodiscard]] bool NeedsGeometryOwnershipTransfer() const;
 		[[nodiscard]] int32_t RateDeviceSuitability(VkPhysicalDevice physicalDevice) const;
 		[[nodiscard]] static bool CheckDeviceExtensionSupport(VkPhysicalDevice device);
 		void SelectPhysicalDevice();
-		[[nodiscard]] uint32_t FindMemoryType(const uint32_t& typeFilter, const VkMemoryPropertyFlags& properties) const;
 		[[nodiscard]] VkFormat FindSupportedFormat(const std::vector<VkFormat>& candidates, const VkImageTiling& tiling, VkFormatFeatureFlags features) const;
 		[[nodiscard]] VkFormat FindDepthFormat() const;
 		[[nodiscard]] static bool HasStencilComponent(const VkFormat& format);
-		[[nodiscard]] VkSampleCountFlagBits GetMaxUsableSampleCount() const;
+		[[nodiscard]] VkSampleCountFlagBits GetUsableSampleCount() const;
+		[[nodiscard]] uint32_t GetSupportedTextureCompression(const VkPhysicalDeviceFeatures& supportedFeatures) const;
 #pragma endregion
 
 #pragma region In Loop
+		void ProcessStreamedGeometry();
+		[[nodiscard]] uint64_t RecordGeometryAcquires(const VkCommandBuffer& commandBuffer);
+		[[nodiscard]] bool HasGeometryAcquiresReady() const;
+		void ReleaseCompletedTransfers();
+		void ReleaseCompletedUploads();
+		void ReleaseCompletedFrames();
+		void StageTextureLevel(ktxTexture* source, const uint32_t& level, const VkImage& image, const uint32_t& mipLevel);
+		// Alignment of every level of source inside the staging ring
+		[[nodiscard]] static VkDeviceSize GetTextureStagingAlignment(ktxTexture* source);
+		void FlushStagingRing();
+		void WaitForStagingSpace();
+		[[nodiscard]] bool EvictMemory(const FHEMemoryCategory& category, const VkDeviceSize& size);
+		[[nodiscard]] const FHEImage* FindLeastRecentlyUsedTexture() const;
+		void UpdateTextureStreaming();
+		void EstimateTextureLevels();
+		void BeginTextureResidencyChange(FHEImage& target, TextureStreamState& stream, const uint32_t& residentLevel);
+		void FinishTextureResidencyChanges();
+		void RegisterTexture(FHEImage& texture);
+		void WriteTextureDescriptors(const uint32_t& frameIndex);
 		void RecordCommandBuffer(const VkCommandBuffer& commandBuffer, const uint32_t& imageIndex);
+		// Writes the draw records of drawList[first, last) from firstDraw on and their visible instance ranges from firstVisibleInstance on, then records their indirect draws into a secondary command buffer for each of the two render passes
+		void RecordDrawSlice(const VkCommandBuffer& earlyCommandBuffer, const VkCommandBuffer& commandBuffer, const uint32_t& imageIndex, const std::vector<const Model*>& drawList, const size_t& first, const size_t& last, const uint32_t& slice, const uint32_t& firstDraw, const uint32_t& firstVisibleInstance) const;
+		// Records one vkCmdDrawIndexedIndirectCount per non-empty bucket of the slice, reading the records at recordOffset within the frame's region
+		void RecordIndirectDraws(const VkCommandBuffer& commandBuffer, const VkRenderPass& renderPass, const uint32_t& imageIndex, const uint32_t& slice, const std::array<uint32_t, DRAW_BUCKET_COUNT>& bucketStarts, const std::array<uint32_t, DRAW_BUCKET_COUNT>& bucketCounts, const VkDeviceSize& recordOffset) const;
+		void ReadCullStatistics();
+		[[nodiscard]] static uint32_t GetDrawBucket(const Model& model);
+		// Instances culling tests for every record of the model
+		[[nodiscard]] uint32_t GetDrawInstanceCount(const Model& model) const;
 		void DrawFrame();
 		void UpdateUniformBuffer();
 		void MainLoop();
 #pragma endregion
 
 #pragma region Cleanup
+		void StopStreaming();
 		void CleanupSwapChain() const;
+		void CleanupCommandBuffers();
+		void CleanupMultisampledAttachments() const;
+		void CleanupAttachments() const;
+		void CleanupDepthPyramid();
 		void CleanupModels() const;
-		void Cleanup() const;
+		void Cleanup();
 #pragma endregion
 
 #pragma region Extension Functions